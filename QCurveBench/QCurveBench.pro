@@ -0,0 +1,16 @@
+#-------------------------------------------------
+#
+# Benchmarks for the QCurveWidget sources
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    framebench \
+    syncserver \
+    syncdriver \
+    linesbench \
+    renderbench \
+    evalfuzz \
+    codegenround
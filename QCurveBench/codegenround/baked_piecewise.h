@@ -0,0 +1,278 @@
+// Baked from a curve of 48 points by QCurveWidget.
+// Generated code: bake the curve again instead of editing it.
+#ifndef BAKED_PIECEWISE_H
+#define BAKED_PIECEWISE_H
+
+namespace baked_piecewise {
+
+constexpr int Count = 176;
+
+// Piece k covers (Breaks[k], Breaks[k + 1]]; the first one Breaks[0] too.
+constexpr float Breaks[Count + 1] = {
+    0.25f, 0.34375f, 0.390625f, 0.4375f, 0.484375f, 0.5078125f,
+    0.53125f, 0.578125f, 0.6015625f, 0.625f, 1.125f, 1.28125f,
+    1.4375f, 1.515625f, 1.59375f, 1.6328125f, 1.671875f, 1.7109375f,
+    1.73046875f, 1.75f, 2.0f, 2.375f, 2.875f, 3.03125f,
+    3.109375f, 3.1875f, 3.265625f, 3.3046875f, 3.34375f, 3.3828125f,
+    3.421875f, 3.4609375f, 3.5f, 3.75f, 3.84375f, 3.9375f,
+    3.984375f, 4.03125f, 4.0546875f, 4.078125f, 4.1015625f, 4.125f,
+    4.625f, 4.78125f, 4.859375f, 4.9375f, 5.015625f, 5.09375f,
+    5.1328125f, 5.171875f, 5.25f, 5.5f, 5.59375f, 5.640625f,
+    5.6875f, 5.734375f, 5.7578125f, 5.78125f, 5.828125f, 5.875f,
+    6.375f, 7.0f, 7.25f, 7.296875f, 7.34375f, 7.390625f,
+    7.4375f, 7.484375f, 7.53125f, 7.578125f, 7.625f, 8.125f,
+    8.4375f, 8.59375f, 8.671875f, 8.75f, 9.0f, 9.09375f,
+    9.140625f, 9.1875f, 9.234375f, 9.2578125f, 9.28125f, 9.3046875f,
+    9.328125f, 9.33984375f, 9.3515625f, 9.375f, 9.875f, 10.03125f,
+    10.109375f, 10.1875f, 10.265625f, 10.34375f, 10.3828125f, 10.421875f,
+    10.5f, 10.75f, 11.125f, 11.625f, 11.78125f, 11.9375f,
+    12.015625f, 12.09375f, 12.1328125f, 12.171875f, 12.2109375f, 12.2304688f,
+    12.25f, 12.5f, 12.875f, 13.375f, 13.53125f, 13.6875f,
+    13.765625f, 13.84375f, 13.921875f, 14.0f, 14.25f, 14.4375f,
+    14.484375f, 14.53125f, 14.578125f, 14.6015625f, 14.625f, 15.125f,
+    15.75f, 16.0f, 16.09375f, 16.140625f, 16.1875f, 16.234375f,
+    16.28125f, 16.328125f, 16.375f, 16.875f, 17.03125f, 17.1875f,
+    17.265625f, 17.34375f, 17.3828125f, 17.421875f, 17.4414062f, 17.4609375f,
+    17.4707031f, 17.4804688f, 17.5f, 17.75f, 17.796875f, 17.84375f,
+    17.890625f, 17.9375f, 17.984375f, 18.03125f, 18.078125f, 18.125f,
+    18.625f, 18.78125f, 18.9375f, 19.015625f, 19.09375f, 19.1328125f,
+    19.171875f, 19.25f, 19.5f, 19.875f, 20.375f, 20.53125f,
+    20.609375f, 20.6875f, 20.765625f, 20.8046875f, 20.84375f, 20.8828125f,
+    20.921875f, 20.9609375f, 21.0f,
+};
+
+constexpr unsigned char Degrees[Count] = {
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 1, 3, 3, 3, 3, 3, 3, 3, 3, 3, 1, 0, 1, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3, 1, 3, 3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 3,
+    3, 3, 1, 3, 3, 3, 3, 3, 3, 3, 3, 1, 0, 1, 3, 3, 3, 3, 3, 3, 3, 3, 1, 3,
+    3, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 1, 3, 3, 3, 3, 3, 3, 3, 3,
+    1, 0, 1, 3, 3, 3, 3, 3, 3, 3, 3, 3, 1, 3, 0, 3, 3, 3, 3, 3, 3, 1, 3, 3,
+    3, 3, 3, 3, 1, 0, 1, 3, 3, 3, 3, 3, 3, 3, 1, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 1, 3, 3, 3, 3, 3, 3, 3, 1, 0, 1, 3, 3,
+    3, 3, 3, 3, 3, 3, 3, 3,
+};
+
+// Piece k in u = x - Breaks[k], constant term first.
+constexpr float Coefficients[Count][4] = {
+    { -2.5f, 17.9887199f, 0.625488281f, -17.2460938f },
+    { -0.822270393f, 17.629427f, -4.55810547f, -59.4166679f },
+    { -0.0120260715f, 16.7876568f, -12.0253906f, -150.114578f },
+    { 0.733011007f, 14.626977f, -32.420166f, -338.989594f },
+    { 1.3125f, 9.33854198f, -83.3027344f, -324.916656f },
+    { 1.48142934f, 4.91973639f, -107.638672f, 38.7916679f },
+    { 1.5381074f, -0.0155194597f, -106.046875f, 503.598969f },
+    { 1.35623586f, -6.64714289f, -34.90625f, 334.541656f },
+    { 1.18557596f, -7.74155426f, -11.6992188f, 178.125f },
+    { 1.0f, -4.0f, 0.0f, 0.0f },
+    { -1.0f, 4.44483042f, -0.0129343318f, 0.272405148f },
+    { -0.3047719f, 4.4630661f, 0.0733333528f, 1.05173552f },
+    { 0.398384571f, 4.56692028f, 0.58659184f, 3.88492322f },
+    { 0.760607958f, 4.7367301f, 1.25273299f, 13.2736549f },
+    { 1.14464045f, 5.18667507f, 4.50289345f, 45.4064331f },
+    { 1.35682225f, 5.76340961f, 8.7390604f, 139.323929f },
+    { 1.60359454f, 7.14315557f, 21.8108139f, 493.800781f },
+    { 1.94533753f, 11.1075506f, 91.8303452f, -90.3063736f },
+    { 2.19663954f, 14.5478325f, 77.3764038f, -1381.5907f },
+    { 2.5f, -8.0f, 0.0f, 0.0f },
+    { -1.5f, 0.0f, 0.0f, 0.0f },
+    { -1.5f, 7.0f, 0.0f, 0.0f },
+    { 2.0f, -6.99781275f, -0.0730833486f, 1.38151062f },
+    { 0.910077572f, -6.91558886f, 0.615840733f, 4.01331186f },
+    { 0.375469685f, -6.74198246f, 1.45920205f, 9.48860836f },
+    { -0.137816906f, -6.32782936f, 3.3226428f, 26.6576977f },
+    { -0.599187374f, -5.30553436f, 9.98160267f, 65.3640289f },
+    { -0.787308097f, -4.21624279f, 17.3107605f, 125.221291f },
+    { -0.918127179f, -2.27694631f, 32.0352287f, 211.364761f },
+    { -0.945590198f, 1.17560363f, 60.2177162f, 127.041817f },
+    { -0.800210953f, 6.39564705f, 75.4206619f, -319.907349f },
+    { -0.454366148f, 10.820981f, 32.6311951f, -303.997833f },
+    { 0.0f, -8.0f, 0.0f, 0.0f },
+    { -2.0f, 11.1991158f, 0.0495605469f, -1.62109375f },
+    { -0.950983047f, 11.1597996f, -0.221435547f, -6.97851562f },
+    { 0.0875518322f, 10.923934f, -2.24584961f, -28.416666f },
+    { 0.591749668f, 10.5063887f, -5.10498047f, -102.135414f },
+    { 1.0625f, 9.3266983f, -20.6005859f, -310.25f },
+    { 1.26578391f, 7.83926153f, -43.2890625f, -519.708313f },
+    { 1.41904616f, 5.00086975f, -88.9560547f, 250.375f },
+    { 1.49061251f, 1.27898157f, -58.7626953f, 908.041687f },
+    { -0.5f, 0.0f, 0.0f, 0.0f },
+    { -0.5f, -1.14499295f, 0.0713256523f, -1.22550893f },
+    { -0.681838751f, -1.21653879f, -0.54225713f, -4.04914045f },
+    { -0.782121301f, -1.37981915f, -1.38160634f, -10.2671099f },
+    { -0.903248072f, -1.79491305f, -3.54179358f, -26.7374935f },
+    { -1.07784247f, -2.84068942f, -10.6642218f, -37.5636597f },
+    { -1.38277233f, -5.17405701f, -18.8828621f, 25.2813263f },
+    { -1.61219001f, -6.52795076f, -15.4780588f, 59.3321114f },
+    { -1.88726926f, -7.48088121f, -7.44253922f, 35.942585f },
+    { -2.5f, 14.0f, 0.0f, 0.0f },
+    { 1.0f, -9.99394512f, -0.33605957f, 9.28059864f },
+    { 0.0677609444f, -9.80047226f, 2.45507812f, 31.984375f },
+    { -0.382947445f, -9.34717846f, 6.47363281f, 80.8541641f },
+    { -0.798544407f, -8.18375397f, 17.4570312f, 182.53125f },
+    { -1.125f, -5.33616638f, 44.8583984f, 174.875f },
+    { -1.2231735f, -2.95678449f, 57.9599609f, -20.916666f },
+    { -1.26090407f, -0.299334198f, 57.1025391f, -271.177094f },
+    { -1.1773963f, 3.29055023f, 16.8786621f, -135.296875f },
+    { -1.0f, 7.0f, 0.0f, 0.0f },
+    { 0.5f, 0.0f, 0.0f, 0.0f },
+    { 0.5f, -8.0f, 0.0f, 0.0f },
+    { -1.5f, 13.3318176f, 0.173339844f, -14.03125f },
+    { -0.876135349f, 13.2496872f, -1.57666016f, -37.25f },
+    { -0.262357235f, 12.8456001f, -6.63574219f, -83.390625f },
+    { 0.316610813f, 11.6783342f, -20.0024414f, -73.6145859f },
+    { 0.8125f, 9.34879684f, -30.3525391f, 73.578125f },
+    { 1.19161057f, 6.99287176f, -18.3623047f, 83.3854141f },
+    { 1.487643f, 5.8102622f, -6.81030273f, 37.1822929f },
+    { 1.74886465f, 5.41108942f, -1.80004883f, 14.036458f },
+    { 2.0f, -4.0f, 0.0f, 0.0f },
+    { 0.0f, -3.00194764f, 0.0310851373f, -0.165215194f },
+    { -0.940114975f, -3.04194689f, 0.0209438968f, -2.74043131f },
+    { -1.42536175f, -3.24774122f, -1.73120642f, -10.627883f },
+    { -1.69472575f, -3.70287442f, -4.11126995f, 19.0966854f },
+    { 1.5f, 0.0f, 0.0f, 0.0f },
+    { 1.5f, -11.197238f, -0.155029297f, 5.08854151f },
+    { 0.453089237f, -11.0872698f, 1.37353516f, 14.177083f },
+    { -0.0621483326f, -10.8603821f, 3.18310547f, 32.59375f },
+    { -0.560877562f, -10.3324003f, 7.06005859f, 89.2916641f },
+    { -1.02049923f, -9.06362438f, 20.3935547f, 221.041672f },
+    { -1.21887958f, -7.72880316f, 34.9375f, 452.958344f },
+    { -1.375f, -5.31250238f, 64.7460938f, 975.041687f },
+    { -1.45139241f, -0.637547791f, 136.038086f, 1633.70837f },
+    { -1.37057364f, 8.40905285f, 254.273438f, 386.333344f },
+    { -1.23648918f, 14.4930267f, 268.523438f, -2003.0f },
+    { -1.03299642f, 19.9803963f, 184.675293f, -2853.625f },
+    { -0.5f, -4.0f, 0.0f, 0.0f },
+    { -2.5f, 7.99751091f, 0.0831096172f, -1.4290731f },
+    { -1.25381136f, 7.9140172f, -0.632614195f, -4.7221303f },
+    { -0.641641617f, 7.72357368f, -1.61313665f, -11.9661608f },
+    { -0.0537891388f, 7.23924732f, -4.13193798f, -31.1924534f },
+    { 0.471683979f, 6.01916456f, -12.4405222f, -43.8335876f },
+    { 0.845098794f, 3.29695439f, -22.0315704f, 29.5252399f },
+    { 0.942028403f, 1.71737075f, -18.0569134f, 69.210907f },
+    { 0.985685825f, 0.605632782f, -8.68261528f, 41.9295959f },
+    { 1.0f, -8.0f, 0.0f, 0.0f },
+    { 2.5f, 0.0f, 0.0f, 0.0f },
+    { 2.5f, -4.0f, 0.0f, 0.0f },
+    { 0.5f, -4.44403601f, -0.0138521483f, 0.293056339f },
+    { -0.193600893f, -4.42434883f, 0.0783189908f, 1.13523412f },
+    { -0.878662705f, -4.31254053f, 0.63141644f, 4.18597937f },
+    { -1.20973003f, -4.12968206f, 1.34929264f, 14.2933779f },
+    { -1.51731038f, -3.64510012f, 4.84900045f, 48.8943329f },
+    { -1.64938378f, -3.02402067f, 9.41125965f, 150.043961f },
+    { -1.74420583f, -1.53815925f, 23.4898472f, 531.763977f },
+    { -1.73675191f, 2.73130655f, 98.8811646f, -96.8478241f },
+    { -1.64640749f, 6.43610144f, 83.3308411f, -1487.91248f },
+    { -1.5f, 14.0f, 0.0f, 0.0f },
+    { 2.0f, -5.33333635f, 2.28881836e-05f, -4.06901054e-05f },
+    { -2.0f, 0.0f, 0.0f, 0.0f },
+    { -2.0f, 5.00034714f, -0.0116469581f, 0.218819201f },
+    { -1.21814537f, 5.01506758f, 0.0450224876f, 0.992626429f },
+    { -0.429655313f, 5.10612297f, 0.524968445f, 4.20671654f },
+    { -0.0255293846f, 5.27262688f, 1.27076614f, 14.5427246f },
+    { 0.401085258f, 5.7432332f, 5.19313622f, 31.8881493f },
+    { 0.896677196f, 7.10862732f, 12.3337221f, -57.2894936f },
+    { 1.5f, -8.0f, 0.0f, 0.0f },
+    { -0.5f, -4.80420828f, 0.112091064f, -1.01765954f },
+    { -1.40355659f, -4.87886572f, -0.641845703f, -8.11979198f },
+    { -1.63450003f, -4.99818945f, -1.45751953f, -29.197916f },
+    { -1.875f, -5.34963989f, -4.43359375f, -122.5625f },
+    { -2.1481297f, -6.57120752f, -25.4121094f, 71.4166641f },
+    { -2.31518221f, -7.63456726f, -16.7910156f, 259.5f },
+    { -2.5f, 7.0f, 0.0f, 0.0f },
+    { -1.0f, 0.0f, 0.0f, 0.0f },
+    { -1.0f, 14.0f, 0.0f, 0.0f },
+    { 2.5f, -7.99653244f, -0.192260742f, 5.3046875f },
+    { 1.75300622f, -7.88597727f, 1.40283203f, 18.276041f },
+    { 1.3883158f, -7.62697077f, 3.69970703f, 46.1979179f },
+    { 1.04368901f, -6.96216202f, 9.97607422f, 104.296875f },
+    { 0.75f, -5.35621786f, 27.753418f, 51.3489571f },
+    { 0.565197706f, -2.45676231f, 32.6297607f, -154.953125f },
+    { 0.505773544f, -0.405408859f, 9.64550781f, -77.3203125f },
+    { 0.5f, -4.0f, 0.0f, 0.0f },
+    { -1.5f, 8.88775635f, 0.0375770703f, -0.778512537f },
+    { -0.113340378f, 8.8358078f, -0.207688019f, -2.99696565f },
+    { 1.2507515f, 8.54028034f, -1.66811025f, -11.0707684f },
+    { 1.90250063f, 8.05705643f, -3.56741476f, -37.7631454f },
+    { 2.49217749f, 6.77631712f, -12.8127775f, -129.272095f },
+    { 2.72962141f, 5.13495016f, -24.8748131f, -396.513824f },
+    { 2.86861539f, 1.31364036f, -74.8414078f, -1048.42114f },
+    { 2.85791135f, -2.83410311f, -137.699066f, -1707.41675f },
+    { 2.7373085f, -10.1589823f, -241.29892f, -852.09967f },
+    { 2.61429405f, -15.0906687f, -268.988434f, 1574.18323f },
+    { 2.44273758f, -19.8668995f, -220.220963f, 3931.9646f },
+    { 0.0f, 0.0f, 0.0f, 0.0f },
+    { 0.0f, -13.3302765f, -0.348632812f, 28.09375f },
+    { -0.622729182f, -13.1661768f, 3.16088867f, 74.3958359f },
+    { -1.22528589f, -12.3578835f, 13.2729492f, 166.765625f },
+    { -1.75822115f, -10.0235062f, 40.013916f, 147.109375f },
+    { -2.125f, -5.36423731f, 60.7041016f, -147.145828f },
+    { -2.25822115f, -0.65243274f, 36.7260742f, -166.791672f },
+    { -2.22528601f, 1.71278632f, 13.6220703f, -74.3854141f },
+    { -2.1227293f, 2.51113129f, 3.6015625f, -28.09375f },
+    { -2.0f, 7.0f, 0.0f, 0.0f },
+    { 1.5f, -2.00068498f, 0.0229116715f, -0.43548879f },
+    { 1.1862911f, -2.03014851f, -0.0899979472f, -1.98510373f },
+    { 0.859310627f, -2.21224737f, -1.04995048f, -8.41250896f },
+    { 0.676059008f, -2.54527736f, -2.54083204f, -29.0908527f },
+    { 0.447829604f, -3.49148083f, -10.1169701f, -66.7387009f },
+    { 0.292028427f, -4.58174467f, -19.017437f, -40.0993271f },
+    { 0.0816456079f, -6.21725893f, -24.6672592f, 114.577347f },
+    { -0.5f, -8.0f, 0.0f, 0.0f },
+    { 1.0f, 0.0f, 0.0f, 0.0f },
+    { 1.0f, -4.0f, 0.0f, 0.0f },
+    { -1.0f, 9.13914108f, 0.123610362f, -2.113832f },
+    { 0.422945023f, 9.01592731f, -0.932678163f, -6.98507881f },
+    { 1.11829102f, 8.73476601f, -2.37995911f, -17.6763535f },
+    { 1.77773976f, 8.01982689f, -6.09885645f, -46.0519981f },
+    { 2.34510493f, 6.20891047f, -17.7898388f, -72.2475739f },
+    { 2.55618906f, 4.49306345f, -26.8465137f, -45.8311958f },
+    { 2.68800306f, 2.20028281f, -32.5239716f, 43.6002464f },
+    { 2.72692275f, -0.131476983f, -26.6563892f, 102.180328f },
+    { 2.68720293f, -1.74920797f, -14.2323065f, 81.687973f },
+    { 2.6020267f, -2.4934535f, -4.72842741f, 43.433403f },
+};
+
+template <int Degree>
+constexpr float piece(const float* c, float u);
+
+template <>
+constexpr float piece<0>(const float* c, float)
+{
+    return c[0];
+}
+
+template <>
+constexpr float piece<1>(const float* c, float u)
+{
+    return c[0] + c[1] * u;
+}
+
+template <>
+constexpr float piece<3>(const float* c, float u)
+{
+    return c[0] + u * (c[1] + u * (c[2] + u * c[3]));
+}
+
+// First k in [low, high] with Breaks[k] >= x.
+constexpr int find(float x, int low, int high)
+{
+    return low < high ? (Breaks[(low + high) / 2] < x ? find(x, (low + high) / 2 + 1, high)
+                                                      : find(x, low, (low + high) / 2))
+                      : low;
+}
+
+constexpr float at(int k, float x)
+{
+    return Degrees[k] == 0 ? piece<0>(Coefficients[k], x - Breaks[k]) :
+           Degrees[k] == 1 ? piece<1>(Coefficients[k], x - Breaks[k]) :
+                             piece<3>(Coefficients[k], x - Breaks[k]);
+}
+
+constexpr float value(float x)
+{
+    return x >= Breaks[0] && x <= Breaks[Count] ? at(find(x, 1, Count) - 1, x) : 0.0f;
+}
+
+} // namespace baked_piecewise
+
+#endif // BAKED_PIECEWISE_H
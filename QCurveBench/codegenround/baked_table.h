@@ -0,0 +1,51 @@
+// Baked from a curve of 48 points by QCurveWidget.
+// Generated code: bake the curve again instead of editing it.
+#ifndef BAKED_TABLE_H
+#define BAKED_TABLE_H
+
+namespace baked_table {
+
+constexpr int Samples = 97;
+constexpr float Left = 0.25f;
+constexpr float Right = 21.0f;
+// (Samples - 1) / (Right - Left); 0 when the curve has a single x.
+constexpr float Scale = 4.62650585f;
+
+constexpr float Table[Samples] = {
+    -2.5f, 1.11742342f, 0.770833254f, -0.09375f, -0.958333492f, -0.083637476f,
+    0.910268426f, 2.39583302f, 0.666666985f, -1.5f, -1.24479222f, 0.268229723f,
+    1.78125f, 0.712575912f, -0.653300285f, -0.0936585888f, -1.66666603f, -0.0551421642f,
+    -0.5f, -0.5f, -0.5f, -0.691372871f, -1.04928005f, -2.27129483f,
+    0.125f, -0.503388882f, -1.02082419f, 0.4765625f, 1.98958445f, 0.5f,
+    0.5f, 0.5f, -0.833332062f, 0.224341869f, 1.86093998f, 1.23958397f,
+    0.375f, -0.367275596f, -1.01930547f, -1.72390854f, 1.5f, 0.251517057f,
+    -1.37057364f, -1.17708206f, -2.04166794f, -1.68839502f, -0.0161726475f, 0.975728571f,
+    0.0f, 2.5f, 2.5f, 1.90625f, 1.04166794f, 0.141301274f,
+    -0.811092019f, -1.66488755f, -0.0416622162f, 1.62499976f, 0.472223938f, -2.0f,
+    -2.0f, -1.700495f, -0.615041733f, 0.53895992f, 0.833335876f, -0.73753655f,
+    -1.79300785f, -1.75260639f, -0.239581108f, -1.0f, -1.0f, -1.0f,
+    -0.125f, 2.27089119f, 0.697323799f, 0.15625f, -0.708335876f, -1.33797121f,
+    0.574230194f, 2.36423206f, 0.0f, -0.104157925f, -2.24697399f, -1.54427528f,
+    -0.03125f, 1.48177528f, 1.06930625f, 0.570991993f, -0.666671753f, -2.39582825f,
+    1.0f, 0.822914124f, -0.0416641235f, -0.90625f, 0.750073195f, 2.45193505f,
+    2.5f,
+};
+
+constexpr float lerp(int k, float f)
+{
+    return Table[k] + (Table[k + 1] - Table[k]) * (f - k);
+}
+
+constexpr float sample(float f)
+{
+    return lerp(f < Samples - 1 ? static_cast<int>(f) : Samples - 2, f);
+}
+
+constexpr float value(float x)
+{
+    return x >= Left && x <= Right ? sample((x - Left) * Scale) : 0.0f;
+}
+
+} // namespace baked_table
+
+#endif // BAKED_TABLE_H
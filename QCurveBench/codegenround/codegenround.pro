@@ -0,0 +1,42 @@
+#-------------------------------------------------
+#
+# Round trip of the baked C++ headers
+#
+# baked_piecewise.h and baked_table.h are CurveCodegen output for the
+# curve in main.cpp, compiled in and compared to CurveLines::getValue.
+# After a change to the generator, bake them again and rebuild:
+#   ./codegenround --write
+#
+#-------------------------------------------------
+
+QT       += core
+
+TARGET = codegenround
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+DEFINES += CODEGEN_DIR=\\\"$$PWD\\\"
+
+CURVE_DIR = $$PWD/../../QCurveWidget
+INCLUDEPATH += $$CURVE_DIR
+
+SOURCES += \
+        main.cpp \
+    $$CURVE_DIR/curvelines.cpp \
+    $$CURVE_DIR/curvefile.cpp \
+    $$CURVE_DIR/curveoverlay.cpp \
+    $$CURVE_DIR/curvesnapshot.cpp \
+    $$CURVE_DIR/curvestream.cpp \
+    $$CURVE_DIR/curvecodegen.cpp
+
+HEADERS += \
+    baked_piecewise.h \
+    baked_table.h \
+    $$CURVE_DIR/curvelines.h \
+    $$CURVE_DIR/curvefile.h \
+    $$CURVE_DIR/curveoverlay.h \
+    $$CURVE_DIR/curvesnapshot.h \
+    $$CURVE_DIR/curvestream.h \
+    $$CURVE_DIR/curvecodegen.h
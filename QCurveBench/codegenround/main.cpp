@@ -0,0 +1,188 @@
+#include <cstdio>
+#include <cmath>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include "curvelines.h"
+#include "curvecodegen.h"
+#include "baked_piecewise.h"
+#include "baked_table.h"
+
+const float Tolerance = 1e-4f;
+const int Samples = 97;
+// Float slack on top of the fit tolerance, in units of the value's size.
+const float YUlps = 64;
+
+// Everything below has to fold at compile time.
+static_assert(baked_piecewise::value(-100.0f) == 0.0f, "outside the curve is 0");
+static_assert(baked_table::value(-100.0f) == 0.0f, "outside the curve is 0");
+constexpr float FoldedPiecewise = baked_piecewise::value(3.0f);
+constexpr float FoldedTable = baked_table::value(3.0f);
+
+// Fixed curve with every point type, dyadic values only, so baking it
+// gives the same text on every build.
+static QVector<CurvePoint> makeRoundCurve()
+{
+    QVector<CurvePoint> points;
+    float x = 0;
+    for (int i = 0; i < 48; i++)
+    {
+        x += 0.25f + (i % 4) * 0.125f;
+        const float y = ((i * 7) % 11) * 0.5f - 2.5f;
+        CurvePoint::PointType type = i % 5 == 0 ? CurvePoint::Default : i % 2 ? CurvePoint::Curve : CurvePoint::Line;
+        CurvePoint point(x, y, type);
+        point.pos2 = QVector2D(x - 0.0625f * (i % 3 + 1), y + ((i * 5) % 7 - 3) * 0.5f);
+        points.append(point);
+    }
+    return points;
+}
+
+static QString bakedPath(const char *name)
+{
+    return QDir(CODEGEN_DIR).filePath(QString("%1.h").arg(name));
+}
+
+// The compiled-in headers are only worth checking while they are what the
+// generator writes today.
+static bool checkFresh(const char *name, const QByteArray& header)
+{
+    QFile file(bakedPath(name));
+    if (file.open(QIODevice::ReadOnly) && file.readAll() == header)
+    {
+        return true;
+    }
+    printf("%s is stale: run with --write and rebuild\n", name);
+    return false;
+}
+
+static QVector<float> makeProbes(CurveLines& lines)
+{
+    // Every point, one ulp to either side, the middle of every segment and
+    // a dense sweep, plus a little outside both ends.
+    QVector<float> probes;
+    const int n = lines.pointsSize();
+    const float first = lines.pointAt(0).pos.x();
+    const float last = lines.pointAt(n - 1).pos.x();
+    for (int i = 0; i < n; i++)
+    {
+        const float x = lines.pointAt(i).pos.x();
+        probes << x << std::nextafter(x, -INFINITY) << std::nextafter(x, INFINITY);
+        if (i > 0)
+        {
+            probes << (x + lines.pointAt(i - 1).pos.x()) / 2;
+        }
+    }
+    for (int k = 0; k <= 10000; k++)
+    {
+        probes << first + (last - first) * k / 10000;
+    }
+    probes << first - 1 << last + 1;
+    return probes;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Round trip of the baked C++ headers against CurveLines.");
+    parser.addHelpOption();
+    QCommandLineOption writeOption("write", "Bake the headers again into the source directory.");
+    parser.addOption(writeOption);
+    parser.process(a);
+
+    CurveLines lines;
+    lines.setPoints(makeRoundCurve());
+    QString error;
+    const QByteArray piecewise = CurveCodegen::generate(lines, "baked_piecewise", CurveCodegen::Piecewise,
+                                                        Tolerance, Samples, &error);
+    const QByteArray table = CurveCodegen::generate(lines, "baked_table", CurveCodegen::Table,
+                                                    Tolerance, Samples, &error);
+    if (piecewise.isEmpty() || table.isEmpty())
+    {
+        printf("bake failed: %s\n", error.toLatin1().constData());
+        return 1;
+    }
+    if (parser.isSet(writeOption))
+    {
+        bool ok = CurveCodegen::write(lines, bakedPath("baked_piecewise"), "baked_piecewise",
+                                      CurveCodegen::Piecewise, Tolerance, Samples, &error)
+                && CurveCodegen::write(lines, bakedPath("baked_table"), "baked_table",
+                                       CurveCodegen::Table, Tolerance, Samples, &error);
+        printf(ok ? "baked into %s\n" : "write failed: %s\n",
+               ok ? CODEGEN_DIR : error.toLatin1().constData());
+        return ok ? 0 : 1;
+    }
+
+    int failed = 0;
+    failed += !checkFresh("baked_piecewise", piecewise);
+    failed += !checkFresh("baked_table", table);
+    if (qAbs(FoldedPiecewise - lines.getValue(3.0f)) > Tolerance)
+    {
+        printf("folded piecewise value(3) = %.9g, curve %.9g\n", static_cast<double>(FoldedPiecewise),
+               static_cast<double>(lines.getValue(3.0f)));
+        failed++;
+    }
+
+    // Piecewise against the curve itself.
+    const QVector<float> probes = makeProbes(lines);
+    float worst = 0;
+    for (float x : probes)
+    {
+        const float expected = lines.getValue(x);
+        const float baked = baked_piecewise::value(x);
+        const float error = qAbs(baked - expected);
+        worst = qMax(worst, error);
+        if (error > Tolerance + YUlps * FLT_EPSILON * qMax(1.0f, qAbs(expected)))
+        {
+            printf("piecewise value(%.9g) = %.9g, curve %.9g\n", static_cast<double>(x),
+                   static_cast<double>(baked), static_cast<double>(expected));
+            failed++;
+        }
+    }
+    printf("piecewise: %d probes, %d pieces, worst error %.3g\n", probes.size(), baked_piecewise::Count,
+           static_cast<double>(worst));
+
+    // The table holds the curve at its sample points and interpolates
+    // between neighbouring samples.
+    worst = 0;
+    for (int k = 0; k < baked_table::Samples; k++)
+    {
+        const float x = static_cast<float>(baked_table::Left + (static_cast<double>(baked_table::Right) - baked_table::Left)
+                                           * k / (baked_table::Samples - 1));
+        const float expected = lines.getValue(k == baked_table::Samples - 1 ? baked_table::Right : x);
+        const float error = qAbs(baked_table::Table[k] - expected);
+        worst = qMax(worst, error);
+        if (error > YUlps * FLT_EPSILON * qMax(1.0f, qAbs(expected)))
+        {
+            printf("table sample %d = %.9g, curve %.9g\n", k, static_cast<double>(baked_table::Table[k]),
+                   static_cast<double>(expected));
+            failed++;
+        }
+    }
+    for (float x : probes)
+    {
+        const float baked = baked_table::value(x);
+        if (!(x >= baked_table::Left && x <= baked_table::Right))
+        {
+            failed += baked != 0.0f;
+            continue;
+        }
+        const float f = (x - baked_table::Left) * baked_table::Scale;
+        const int k = qBound(0, static_cast<int>(f), baked_table::Samples - 2);
+        const float low = qMin(baked_table::Table[k], baked_table::Table[k + 1]);
+        const float high = qMax(baked_table::Table[k], baked_table::Table[k + 1]);
+        const float slack = YUlps * FLT_EPSILON * qMax(1.0f, qMax(qAbs(low), qAbs(high)));
+        if (baked < low - slack || baked > high + slack)
+        {
+            printf("table value(%.9g) = %.9g, outside samples %d and %d\n", static_cast<double>(x),
+                   static_cast<double>(baked), k, k + 1);
+            failed++;
+        }
+    }
+    printf("table: %d samples, worst sample error %.3g, folded value(3) = %.9g\n", baked_table::Samples,
+           static_cast<double>(worst), static_cast<double>(FoldedTable));
+    printf("%d failing\n", failed);
+    return failed ? 1 : 0;
+}
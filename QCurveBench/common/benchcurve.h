@@ -0,0 +1,30 @@
+#ifndef BENCHCURVE_H
+#define BENCHCURVE_H
+
+#include <QRandomGenerator>
+#include "curvelines.h"
+
+// Deterministic synthetic curve shared by the benchmarks: sorted x with
+// jittered spacing, a random walk in y and a random mix of point types.
+inline QVector<CurvePoint> makeBenchCurve(int count, quint32 seed = 1)
+{
+    QRandomGenerator random(seed + static_cast<quint32>(count));
+    QVector<CurvePoint> points;
+    points.reserve(count);
+    float x = 0;
+    float y = 0;
+    for (int i = 0; i < count; i++)
+    {
+        x += 0.01f + static_cast<float>(random.generateDouble()) * 0.01f;
+        y += static_cast<float>(random.generateDouble()) - 0.5f;
+        CurvePoint point(x, y, CurvePoint::PointType(random.bounded(3)));
+        if (i > 0)
+        {
+            point.pos2 = (point.pos + points.last().pos) / 2;
+        }
+        points.append(point);
+    }
+    return points;
+}
+
+#endif // BENCHCURVE_H
@@ -0,0 +1,39 @@
+#-------------------------------------------------
+#
+# Differential fuzzing of the CurveLines query paths
+#
+# Every fast path is compared to a double precision reference evaluator on
+# random curves, and the other operations to plain definitions of what
+# they should return; failures are shrunk and printed as a C++ reproducer.
+#   ./evalfuzz --iterations 10000 --seed 1
+#
+#-------------------------------------------------
+
+QT       += core
+
+TARGET = evalfuzz
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+CURVE_DIR = $$PWD/../../QCurveWidget
+INCLUDEPATH += $$CURVE_DIR $$PWD/../common
+
+SOURCES += \
+        main.cpp \
+    $$CURVE_DIR/curvelines.cpp \
+    $$CURVE_DIR/curveexpr.cpp \
+    $$CURVE_DIR/curvefile.cpp \
+    $$CURVE_DIR/curveoverlay.cpp \
+    $$CURVE_DIR/curvesnapshot.cpp \
+    $$CURVE_DIR/curvestream.cpp
+
+HEADERS += \
+    $$CURVE_DIR/curvelines.h \
+    $$CURVE_DIR/curveexpr.h \
+    $$CURVE_DIR/curvefile.h \
+    $$CURVE_DIR/curveoverlay.h \
+    $$CURVE_DIR/curvesnapshot.h \
+    $$CURVE_DIR/curvestream.h
@@ -0,0 +1,1086 @@
+#include <cstdio>
+#include <algorithm>
+#include <functional>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QRandomGenerator>
+#include <QDir>
+#include "curvelines.h"
+#include "curvefile.h"
+#include "curvesnapshot.h"
+#include "curveexpr.h"
+
+// Error bounds of the fast paths against the double precision reference.
+// The fast paths work in float, so a query x is only known to about XUlps
+// of the segment's x magnitude: the reference y is taken over that x range,
+// widened by YUlps of the segment's y magnitude for the float cubic.
+const float XUlps = 8;
+const float YUlps = 64;
+
+static QString MappedPath;
+
+struct FuzzPath
+{
+    const char *name;
+    std::function<void(CurveLines&, const QVector<float>&, QVector<float>&)> run;
+};
+
+struct FuzzFailure
+{
+    QString path;
+    float x;
+    float y;
+    double low;
+    double high;
+};
+
+// Operations checked against a plain definition rather than getValue():
+// each one gets its own copy of the curve, since most of them edit it.
+struct FuzzCheck
+{
+    const char *name;
+    std::function<void(CurveLines&, const QVector<CurvePoint>&, const QVector<float>&, QVector<FuzzFailure>&)> run;
+};
+
+static double referenceX(const CurvePoint& point, const CurvePoint& pointd, double t)
+{
+    double A = point.pos.x();
+    double B = pointd.pos.x();
+    double C = point.pos2.x();
+    return (((B - A) * t + 3 * (A - C)) * t + 3 * (C - A)) * t + A;
+}
+
+static double referenceY(const CurvePoint& point, const CurvePoint& pointd, double t)
+{
+    double A = point.pos.y();
+    double B = pointd.pos.y();
+    double C = point.pos2.y();
+    return (((B - A) * t + 3 * (A - C)) * t + 3 * (C - A)) * t + A;
+}
+
+// Plain definition of CurveLines::getValue: the first segment in index
+// order whose x range holds x, the value solved in double precision.
+static int referenceSegment(const QVector<CurvePoint>& points, float x)
+{
+    for (int i = 1; i < points.size(); i++)
+    {
+        float x0 = points[i-1].pos.x();
+        float x1 = points[i].pos.x();
+        if (qMin(x0, x1) <= x && x <= qMax(x0, x1))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Bisection for the first t at which g(t) is no longer below value (or
+// above it when upper is set), g being x(t) oriented to rise with t.
+static double referenceT(const CurvePoint& point, const CurvePoint& pointd, double value, bool upper)
+{
+    const double sign = referenceX(point, pointd, 1) >= referenceX(point, pointd, 0) ? 1 : -1;
+    double low = 0;
+    double high = 1;
+    for (int k = 0; k < 100; k++)
+    {
+        double mid = (low + high) / 2;
+        double g = sign * referenceX(point, pointd, mid);
+        if (upper ? g <= sign * value : g < sign * value)
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return upper ? high : low;
+}
+
+// Range of y over the part of segment i whose x lies in [x0, x1]. For a
+// curve that is y(t) over the matching t interval, including the turning
+// points of y(t) inside it.
+static void referenceRange(const QVector<CurvePoint>& points, int i, double x0, double x1,
+                           double& low, double& high)
+{
+    const CurvePoint& point = points[i];
+    const CurvePoint& pointd = points[i-1];
+    low = high = point.pos.y();
+    if (point.type == CurvePoint::Line && point.pos.x() != pointd.pos.x())
+    {
+        double ax = point.pos.x();
+        double ox = static_cast<double>(pointd.pos.x()) - ax;
+        double t0 = qBound(0.0, (x0 - ax) / ox, 1.0);
+        double t1 = qBound(0.0, (x1 - ax) / ox, 1.0);
+        double oy = static_cast<double>(pointd.pos.y()) - point.pos.y();
+        double y0 = point.pos.y() + oy * t0;
+        double y1 = point.pos.y() + oy * t1;
+        low = qMin(y0, y1);
+        high = qMax(y0, y1);
+    }
+    else if (point.type == CurvePoint::Curve)
+    {
+        bool rising = referenceX(point, pointd, 1) >= referenceX(point, pointd, 0);
+        double t0 = referenceT(point, pointd, rising ? x0 : x1, false);
+        double t1 = referenceT(point, pointd, rising ? x1 : x0, true);
+        QVector<double> ts;
+        ts << t0 << t1;
+        // y'(t) / 3 = (B - A) t^2 + 2 (A - C) t + (C - A)
+        double a = static_cast<double>(pointd.pos.y()) - point.pos.y();
+        double b = 2 * (static_cast<double>(point.pos.y()) - point.pos2.y());
+        double c = static_cast<double>(point.pos2.y()) - point.pos.y();
+        if (a == 0)
+        {
+            if (b != 0)
+            {
+                ts << -c / b;
+            }
+        }
+        else if (b * b - 4 * a * c >= 0)
+        {
+            double root = sqrt(b * b - 4 * a * c);
+            ts << (-b - root) / (2 * a) << (-b + root) / (2 * a);
+        }
+        low = DBL_MAX;
+        high = -DBL_MAX;
+        for (double t : ts)
+        {
+            if (t >= t0 && t <= t1)
+            {
+                double y = referenceY(point, pointd, t);
+                low = qMin(low, y);
+                high = qMax(high, y);
+            }
+        }
+    }
+}
+
+static bool referenceCheck(const QVector<CurvePoint>& points, float x, float y, double& low, double& high)
+{
+    int i = referenceSegment(points, x);
+    if (i < 0)
+    {
+        low = high = (points.size() == 1 && points[0].pos.x() == x) ? points[0].pos.y() : 0;
+        return y == low;
+    }
+    const CurvePoint& point = points[i];
+    const CurvePoint& pointd = points[i-1];
+    float xs = qMax(qMax(qAbs(point.pos.x()), qAbs(pointd.pos.x())), qMax(qAbs(point.pos2.x()), 1.0f));
+    float ys = qMax(qMax(qAbs(point.pos.y()), qAbs(pointd.pos.y())), qMax(qAbs(point.pos2.y()), 1.0f));
+    double dx = static_cast<double>(XUlps * FLT_EPSILON * xs);
+    double dy = static_cast<double>(YUlps * FLT_EPSILON * ys);
+    referenceRange(points, i, x - dx, x + dx, low, high);
+    low -= dy;
+    high += dy;
+    return y >= low && y <= high;
+}
+
+static QVector<FuzzPath> fuzzPaths()
+{
+    QVector<FuzzPath> paths;
+    paths.append({ "getValue", [](CurveLines& lines, const QVector<float>& xs, QVector<float>& ys)
+    {
+        for (int k = 0; k < xs.size(); k++)
+        {
+            ys[k] = lines.getValue(xs[k]);
+        }
+    }});
+    paths.append({ "getValues", [](CurveLines& lines, const QVector<float>& xs, QVector<float>& ys)
+    {
+        lines.getValues(xs.constData(), ys.data(), xs.size());
+    }});
+    paths.append({ "snapshot", [](CurveLines& lines, const QVector<float>& xs, QVector<float>& ys)
+    {
+        lines.publishSnapshot()->getValues(xs.constData(), ys.data(), xs.size());
+    }});
+    return paths;
+}
+
+static bool sameValue(float a, float b)
+{
+    return a == b || (qIsNaN(a) && qIsNaN(b));
+}
+
+static void addFailure(QVector<FuzzFailure>& failures, const char *name, float x, float y, double low, double high)
+{
+    FuzzFailure failure = { QString(name), x, y, low, high };
+    failures.append(failure);
+}
+
+// A composite hands back its cached batch only while no leaf below it
+// changed: the batch is checked after an edit on each leaf, and after one
+// leaf moves on while the other goes away.
+static void checkComposite(CurveLines& lines, const QVector<CurvePoint>& points, const QVector<float>& all,
+                           QVector<FuzzFailure>& failures)
+{
+    // A NaN never compares equal, so with one among the x's every batch
+    // would miss the cache and nothing stale could come back.
+    QVector<float> probes;
+    for (float x : all)
+    {
+        if (!qIsNaN(x))
+        {
+            probes.append(x);
+        }
+    }
+    QScopedPointer<CurveLines> other(new CurveLines);
+    other->onCurve(points);
+    CurveExprPtr expr = CurveExpr::add(CurveExpr::scale(CurveExpr::curve(&lines), 2, 1),
+                                       CurveExpr::curve(other.data()));
+    for (int stage = 0; stage < 3; stage++)
+    {
+        if (stage == 1)
+        {
+            other->selectPoints();
+            other->moveTouchPoint(QVector2D(0, 1), CurveLines::Y_Axis);
+            other->releasePoints();
+        }
+        else if (stage == 2)
+        {
+            // Two steps on one leaf as the other drops to version 0: a sum
+            // of the leaf versions would come back to the one cached.
+            lines.selectPoints();
+            lines.moveTouchPoint(QVector2D(0, 1), CurveLines::Y_Axis);
+            lines.moveTouchPoint(QVector2D(0, 1), CurveLines::Y_Axis);
+            lines.releasePoints();
+            other.reset();
+        }
+        QVector<float> ys = expr->evaluate(probes);
+        QVector<float> as(probes.size());
+        QVector<float> bs(probes.size(), 0.0f);
+        lines.publishSnapshot()->getValues(probes.constData(), as.data(), probes.size());
+        if (other)
+        {
+            other->publishSnapshot()->getValues(probes.constData(), bs.data(), probes.size());
+        }
+        for (int k = 0; k < probes.size(); k++)
+        {
+            const float expected = as[k] * 2 + 1 + bs[k];
+            if (!sameValue(ys[k], expected))
+            {
+                addFailure(failures, "composite", probes[k], ys[k], expected, expected);
+                return;
+            }
+        }
+    }
+}
+
+static double referenceDX(const CurvePoint& point, const CurvePoint& pointd, double t)
+{
+    double A = point.pos.x();
+    double B = pointd.pos.x();
+    double C = point.pos2.x();
+    return (3 * (B - A) * t + 6 * (A - C)) * t + 3 * (C - A);
+}
+
+// Area of segment i over the part of [lo, hi] it covers on a sorted curve:
+// closed forms for lines and steps, Gauss-Legendre over y(t) x'(t) for a
+// curve, between the t's bisected for lo and hi.
+static double referenceArea(const QVector<CurvePoint>& points, int i, double lo, double hi)
+{
+    const CurvePoint& point = points[i];
+    const CurvePoint& pointd = points[i-1];
+    const double x0 = pointd.pos.x();
+    const double x1 = point.pos.x();
+    lo = qMax(lo, x0);
+    hi = qMin(hi, x1);
+    if (!(lo < hi))
+    {
+        return 0;
+    }
+    if (point.type == CurvePoint::Line)
+    {
+        const double y0 = pointd.pos.y();
+        const double slope = (static_cast<double>(point.pos.y()) - y0) / (x1 - x0);
+        return (hi - lo) * (2 * y0 + slope * (lo - x0 + hi - x0)) / 2;
+    }
+    if (point.type != CurvePoint::Curve)
+    {
+        return (hi - lo) * point.pos.y();
+    }
+    const double nodes[] = { -0.9061798459386640, -0.5384693101056831, 0.0, 0.5384693101056831, 0.9061798459386640 };
+    const double weights[] = { 0.2369268850561891, 0.4786286704993665, 0.5688888888888889, 0.4786286704993665, 0.2369268850561891 };
+    const double t0 = referenceT(point, pointd, lo, false);
+    const double t1 = referenceT(point, pointd, hi, false);
+    double area = 0;
+    for (int k = 0; k < 5; k++)
+    {
+        const double t = (t0 + t1) / 2 + (t1 - t0) / 2 * nodes[k];
+        area += weights[k] * referenceY(point, pointd, t) * referenceDX(point, pointd, t);
+    }
+    return area * (t1 - t0) / 2;
+}
+
+// integral() on sorted curves against the segment by segment reference.
+// The bound follows the float inputs: every segment's area is known to
+// YUlps of its size, and the two partial ends to XUlps of the x's.
+static void checkIntegral(CurveLines& lines, const QVector<CurvePoint>& points, const QVector<float>& probes,
+                          QVector<FuzzFailure>& failures)
+{
+    double size = 0;
+    float xs = 0;
+    float ys = 0;
+    for (int i = 0; i < points.size(); i++)
+    {
+        const CurvePoint& point = points[i];
+        if (i > 0 && point.pos.x() < points[i-1].pos.x())
+        {
+            return;
+        }
+        float high = qMax(qAbs(point.pos.y()), point.type == CurvePoint::Curve ? qAbs(point.pos2.y()) : 0.0f);
+        if (i > 0)
+        {
+            high = qMax(high, qAbs(points[i-1].pos.y()));
+            size += (static_cast<double>(point.pos.x()) - points[i-1].pos.x()) * high;
+        }
+        xs = qMax(xs, qAbs(point.pos.x()));
+        ys = qMax(ys, high);
+    }
+    const double bound = YUlps * FLT_EPSILON * size + 2 * XUlps * FLT_EPSILON * static_cast<double>(xs) * ys;
+    const int pairs = qMin(32, probes.size());
+    for (int k = 0; k < pairs; k++)
+    {
+        const float x0 = probes[k * probes.size() / pairs];
+        const float x1 = probes[(k * probes.size() / pairs + probes.size() / 2) % probes.size()];
+        if (qIsNaN(x0) || qIsNaN(x1))
+        {
+            continue;
+        }
+        double reference = 0;
+        for (int i = 1; i < points.size(); i++)
+        {
+            reference += referenceArea(points, i, qMin(x0, x1), qMax(x0, x1));
+        }
+        reference = x0 <= x1 ? reference : -reference;
+        const double area = lines.integral(x0, x1);
+        if (!(qAbs(area - reference) <= bound))
+        {
+            addFailure(failures, "integral", x0, static_cast<float>(area), reference - bound, reference + bound);
+            return;
+        }
+    }
+}
+
+// The path crossings() walks, as points in segment order: lines straight,
+// curves sampled from pointd (t = 1) to point (t = 0), and steps as the
+// jump at the previous x followed by the level run. A leading step has
+// nothing to jump from: getValue() at the first x is already its level.
+static QVector<QPointF> referencePath(const QVector<CurvePoint>& points)
+{
+    QVector<QPointF> path;
+    const bool step = points[1].type != CurvePoint::Line && points[1].type != CurvePoint::Curve;
+    path.append(QPointF(points[0].pos.x(), (step ? points[1] : points[0]).pos.y()));
+    for (int i = 1; i < points.size(); i++)
+    {
+        const CurvePoint& point = points[i];
+        const CurvePoint& pointd = points[i-1];
+        if (point.type == CurvePoint::Curve)
+        {
+            for (int s = 1; s <= 64; s++)
+            {
+                const double t = 1 - s / 64.0;
+                path.append(QPointF(referenceX(point, pointd, t), referenceY(point, pointd, t)));
+            }
+        }
+        else
+        {
+            if (point.type != CurvePoint::Line)
+            {
+                path.append(QPointF(pointd.pos.x(), point.pos.y()));
+            }
+            path.append(QPointF(point.pos.x(), point.pos.y()));
+        }
+    }
+    return path;
+}
+
+// Whether segment i reaches y within dy somewhere over [x - dx, x + dx],
+// counting a vertical line and the jump into a step past the first point
+// as covering their span.
+static bool referenceReaches(const QVector<CurvePoint>& points, int i, double x, double y, double dx, double dy)
+{
+    const CurvePoint& point = points[i];
+    const CurvePoint& pointd = points[i-1];
+    double left = qMin(point.pos.x(), pointd.pos.x());
+    double right = qMax(point.pos.x(), pointd.pos.x());
+    if (point.type == CurvePoint::Curve)
+    {
+        left = qMin(left, static_cast<double>(point.pos2.x()));
+        right = qMax(right, static_cast<double>(point.pos2.x()));
+    }
+    if (x + dx < left || x - dx > right)
+    {
+        return false;
+    }
+    double low;
+    double high;
+    const bool jump = point.type == CurvePoint::Line ? point.pos.x() == pointd.pos.x()
+                                                     : point.type != CurvePoint::Curve && i > 1 && qAbs(x - pointd.pos.x()) <= dx;
+    if (jump)
+    {
+        low = qMin(point.pos.y(), pointd.pos.y());
+        high = qMax(point.pos.y(), pointd.pos.y());
+    }
+    else
+    {
+        referenceRange(points, i, x - dx, x + dx, low, high);
+    }
+    return y >= low - dy && y <= high + dy;
+}
+
+// crossings() at the levels of the points, their control points and the
+// midpoints between them, so the t = 0 and t = 1 rules at shared ends get
+// exercised. Along the reference path, every run from a point clearly on
+// one side of y to one clearly on the other needs a crossing inside its x
+// range, and a spread of the crossings reported has to lie where a
+// segment reaches y.
+static void checkCrossings(CurveLines& lines, const QVector<CurvePoint>& points, const QVector<float>&,
+                           QVector<FuzzFailure>& failures)
+{
+    if (points.size() < 2)
+    {
+        return;
+    }
+    float xs = 0;
+    float ys = 0;
+    for (const CurvePoint& point : points)
+    {
+        xs = qMax(xs, qMax(qAbs(point.pos.x()), qAbs(point.pos2.x())));
+        ys = qMax(ys, qMax(qAbs(point.pos.y()), qAbs(point.pos2.y())));
+    }
+    const double dx = static_cast<double>(XUlps * FLT_EPSILON * xs);
+    const double dy = static_cast<double>(YUlps * FLT_EPSILON * ys);
+    const QVector<QPointF> path = referencePath(points);
+    QVector<float> levels;
+    const int count = qMin(8, points.size());
+    for (int k = 0; k < count; k++)
+    {
+        const int j = k * points.size() / count;
+        levels << points[j].pos.y() << points[j].pos2.y();
+        if (j > 0)
+        {
+            levels << (points[j].pos.y() + points[j-1].pos.y()) / 2;
+        }
+    }
+    for (float y : levels)
+    {
+        const QVector<float> found = lines.crossings(y);
+        const int checked = qMin(16, found.size());
+        for (int k = 0; k < checked; k++)
+        {
+            const float x = found[k * found.size() / checked];
+            bool reaches = false;
+            for (int i = 1; i < points.size() && !reaches; i++)
+            {
+                reaches = referenceReaches(points, i, x, y, dx, dy);
+            }
+            if (!reaches)
+            {
+                addFailure(failures, "crossings (stray)", y, x, y, y);
+                return;
+            }
+        }
+        int side = 0;
+        int last = 0;
+        int changes = 0;
+        for (int k = 0; k < path.size(); k++)
+        {
+            const double f = path[k].y() - y;
+            const int s = f > dy ? 1 : f < -dy ? -1 : 0;
+            if (s == 0)
+            {
+                continue;
+            }
+            if (side && s != side)
+            {
+                double low = path[last].x();
+                double high = low;
+                for (int j = last + 1; j <= k; j++)
+                {
+                    low = qMin(low, path[j].x());
+                    high = qMax(high, path[j].x());
+                }
+                bool hit = false;
+                for (float x : found)
+                {
+                    hit = hit || (x >= low - dx && x <= high + dx);
+                }
+                if (!hit)
+                {
+                    addFailure(failures, "crossings (missed)", y, static_cast<float>(found.size()), low, high);
+                    return;
+                }
+                changes++;
+            }
+            side = s;
+            last = k;
+        }
+        if (found.size() < changes)
+        {
+            addFailure(failures, "crossings (count)", y, static_cast<float>(found.size()), changes, changes);
+            return;
+        }
+    }
+}
+
+// Where hitSegment() and splitSegment() put t on segment i: lines and
+// curves as evaluate() runs them, a step along its level run.
+static QPointF referenceAt(const CurvePoint& point, const CurvePoint& pointd, double t)
+{
+    if (point.type == CurvePoint::Curve)
+    {
+        return QPointF(referenceX(point, pointd, t), referenceY(point, pointd, t));
+    }
+    const double x = point.pos.x() + (static_cast<double>(pointd.pos.x()) - point.pos.x()) * t;
+    if (point.type == CurvePoint::Line)
+    {
+        return QPointF(x, point.pos.y() + (static_cast<double>(pointd.pos.y()) - point.pos.y()) * t);
+    }
+    return QPointF(x, point.pos.y());
+}
+
+static double referenceMagnitude(const CurvePoint& point, const CurvePoint& pointd)
+{
+    return qMax(qMax(qMax(qAbs(point.pos.x()), qAbs(point.pos.y())), qMax(qAbs(pointd.pos.x()), qAbs(pointd.pos.y()))),
+                qMax(qAbs(point.pos2.x()), qAbs(point.pos2.y())));
+}
+
+static double referenceDistance(const QPointF& a, const QPointF& b)
+{
+    return std::hypot(a.x() - b.x(), a.y() - b.y());
+}
+
+// Distance from pos to segment i: exact for lines and steps, the closest of
+// 512 samples for a curve, which can only overshoot.
+static double referenceNearest(const QVector<CurvePoint>& points, int i, const QPointF& pos)
+{
+    const CurvePoint& point = points[i];
+    const CurvePoint& pointd = points[i-1];
+    if (point.type == CurvePoint::Curve)
+    {
+        double best = DBL_MAX;
+        for (int s = 0; s <= 512; s++)
+        {
+            best = qMin(best, referenceDistance(referenceAt(point, pointd, s / 512.0), pos));
+        }
+        return best;
+    }
+    const QPointF a = referenceAt(point, pointd, 0);
+    const QPointF b = referenceAt(point, pointd, 1);
+    const double dx = b.x() - a.x();
+    const double dy = b.y() - a.y();
+    const double length = dx * dx + dy * dy;
+    const double t = length > 0 ? qBound(0.0, ((pos.x() - a.x()) * dx + (pos.y() - a.y()) * dy) / length, 1.0) : 0.0;
+    return referenceDistance(QPointF(a.x() + dx * t, a.y() + dy * t), pos);
+}
+
+// hitSegment() with no distance limit returns a point on the segment it
+// names, at its t, and no farther from pos than the closest point of any
+// segment.
+static void checkHit(CurveLines& lines, const QVector<CurvePoint>& points, const QVector<float>& probes,
+                     QVector<FuzzFailure>& failures)
+{
+    if (points.size() < 2)
+    {
+        return;
+    }
+    double magnitude = 0;
+    for (int i = 1; i < points.size(); i++)
+    {
+        magnitude = qMax(magnitude, referenceMagnitude(points[i], points[i-1]));
+    }
+    const int count = qMin(16, probes.size());
+    for (int k = 0; k < count; k++)
+    {
+        const float x = probes[k * probes.size() / count];
+        if (!qIsFinite(x) || qAbs(x) == FLT_MAX)
+        {
+            continue;
+        }
+        const QVector2D pos(x, points[k % points.size()].pos2.y());
+        const QPointF at = pos.toPointF();
+        const double bound = YUlps * FLT_EPSILON * qMax(magnitude, qMax(qAbs(at.x()), qAbs(at.y())));
+        float t = 0;
+        QVector2D nearest;
+        const int segment = lines.hitSegment(pos, FLT_MAX, t, nearest);
+        if (segment < 1 || segment >= points.size())
+        {
+            addFailure(failures, "hitSegment (none)", x, segment, 1, points.size() - 1);
+            return;
+        }
+        const QPointF onSegment = referenceAt(points[segment], points[segment-1], t);
+        if (referenceDistance(onSegment, nearest.toPointF()) > bound)
+        {
+            addFailure(failures, "hitSegment (off segment)", x, t, onSegment.x(), onSegment.y());
+            return;
+        }
+        double reference = DBL_MAX;
+        for (int i = 1; i < points.size(); i++)
+        {
+            reference = qMin(reference, referenceNearest(points, i, at));
+        }
+        const double distance = referenceDistance(nearest.toPointF(), at);
+        if (distance > reference + bound)
+        {
+            addFailure(failures, "hitSegment (not nearest)", x, static_cast<float>(distance), 0, reference + bound);
+            return;
+        }
+    }
+}
+
+static bool samePoints(CurveLines& lines, const QVector<CurvePoint>& points)
+{
+    if (lines.pointsSize() != points.size())
+    {
+        return false;
+    }
+    for (int i = 0; i < points.size(); i++)
+    {
+        const CurvePoint point = lines.pointAt(i);
+        if (point.type != points[i].type || point.pos != points[i].pos || point.pos2 != points[i].pos2)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static QVector<CurvePoint> currentPoints(CurveLines& lines)
+{
+    QVector<CurvePoint> points;
+    for (int i = 0; i < lines.pointsSize(); i++)
+    {
+        points.append(lines.pointAt(i));
+    }
+    return points;
+}
+
+// splitSegment() puts the new point on the old segment at t and keeps both
+// ends. Line and step halves keep every value; curve halves keep the
+// midpoint of each half. Undo gives back the original points exactly, and
+// redo the split ones.
+static void checkSplit(CurveLines& lines, const QVector<CurvePoint>& points, const QVector<float>& probes,
+                       QVector<FuzzFailure>& failures)
+{
+    const int count = qMin(8, points.size() - 1);
+    for (int k = 0; k < count; k++)
+    {
+        const int i = 1 + k * (points.size() - 1) / count;
+        const float t = (2 * k + 1) / 16.0f;
+        const CurvePoint& point = points[i];
+        const CurvePoint& pointd = points[i-1];
+        const double bound = YUlps * FLT_EPSILON * referenceMagnitude(point, pointd);
+        if (lines.splitSegment(i, t) != i || lines.pointsSize() != points.size() + 1
+                || lines.pointAt(i - 1).pos != pointd.pos || lines.pointAt(i + 1).pos != point.pos)
+        {
+            addFailure(failures, "splitSegment (ends)", t, i, i, i);
+            return;
+        }
+        const CurvePoint inserted = lines.pointAt(i);
+        const QPointF at = referenceAt(point, pointd, t);
+        if (referenceDistance(inserted.pos.toPointF(), at) > bound)
+        {
+            addFailure(failures, "splitSegment (point)", t, inserted.pos.y(), at.y(), at.y());
+            return;
+        }
+        if (point.type == CurvePoint::Curve)
+        {
+            const QPointF near = referenceAt(lines.pointAt(i + 1), inserted, 0.5);
+            const QPointF far = referenceAt(inserted, pointd, 0.5);
+            if (referenceDistance(near, referenceAt(point, pointd, t / 2.0)) > bound
+                    || referenceDistance(far, referenceAt(point, pointd, (1.0 + t) / 2.0)) > bound)
+            {
+                addFailure(failures, "splitSegment (midpoints)", t, i, i, i);
+                return;
+            }
+        }
+        else if (point.type != CurvePoint::Line || point.pos.x() != pointd.pos.x())
+        {
+            // At a vertical line getValue() reads the end of the first
+            // segment holding x, which a split moves up the jump; the
+            // path itself stays the same.
+            for (float x : probes)
+            {
+                double low;
+                double high;
+                const float y = lines.getValue(x);
+                if (!referenceCheck(points, x, y, low, high))
+                {
+                    addFailure(failures, "splitSegment (value)", x, y, low, high);
+                    return;
+                }
+            }
+        }
+        const QVector<CurvePoint> split = currentPoints(lines);
+        if (!lines.undo() || !samePoints(lines, points))
+        {
+            addFailure(failures, "splitSegment (undo)", t, i, i, i);
+            return;
+        }
+        if (!lines.redo() || !samePoints(lines, split) || !lines.undo())
+        {
+            addFailure(failures, "splitSegment (redo)", t, i, i, i);
+            return;
+        }
+    }
+}
+
+// Scaling by a power of two and back is exact, so transformPoints() has to
+// give the original points back. Then a run of edits over probe-bounded
+// selections: undo has to walk back through every one of them to the
+// original points, and redo forward again to the last ones.
+static void checkEdits(CurveLines& lines, const QVector<CurvePoint>& points, const QVector<float>& probes,
+                       QVector<FuzzFailure>& failures)
+{
+    QVector<QVector<CurvePoint>> states;
+    states.append(points);
+    lines.selectPoints();
+    if (lines.transformPoints(QVector2D(2.0f, 0.5f), QVector2D()))
+    {
+        states.append(currentPoints(lines));
+    }
+    if (lines.transformPoints(QVector2D(0.5f, 2.0f), QVector2D()))
+    {
+        states.append(currentPoints(lines));
+    }
+    if (!samePoints(lines, points))
+    {
+        addFailure(failures, "transformPoints (round trip)", 2.0f, 0.5f, 0.5f, 2.0f);
+        return;
+    }
+
+    QVector<float> xs;
+    for (float x : probes)
+    {
+        if (qIsFinite(x))
+        {
+            xs.append(x);
+        }
+    }
+    const int count = qMin(10, xs.size() - 1);
+    for (int k = 0; k < count; k++)
+    {
+        const float lo = qMin(xs[k], xs[k + 1]);
+        const float hi = qMax(xs[k], xs[k + 1]);
+        lines.releasePoints();
+        lines.touchPoints(QRectF(QPointF(lo, -FLT_MAX), QPointF(hi, FLT_MAX)));
+        int changed = 0;
+        switch (k % 6)
+        {
+        case 0:
+            changed = lines.moveTouchPoint(QVector2D(hi - lo, 1.0f), CurveLines::XY_Axis);
+            break;
+        case 1:
+            changed = lines.transformPoints(QVector2D(1.5f, -0.75f), QVector2D(lo, 0.0f), QVector2D(0.0f, 1.0f));
+            break;
+        case 2:
+            changed = lines.quantizePoints(QVector2D((hi - lo) / 4, 0.125f), QVector2D(lo, 0.0f));
+            break;
+        case 3:
+            lines.insertPoint(CurvePoint(hi, lo));
+            changed = 1;
+            break;
+        case 4:
+            changed = lines.clampPoints(QRectF(QPointF(lo, -0.5), QPointF(hi, 0.5)));
+            break;
+        default:
+            changed = lines.deleteTouchPoint();
+            break;
+        }
+        if (changed)
+        {
+            states.append(currentPoints(lines));
+        }
+    }
+    lines.releasePoints();
+
+    for (int i = states.size() - 1; i > 0; i--)
+    {
+        if (!lines.undo() || !samePoints(lines, states[i - 1]))
+        {
+            addFailure(failures, "undo (round trip)", i, states[i - 1].size(), states.size(), states.size());
+            return;
+        }
+    }
+    if (lines.undo())
+    {
+        addFailure(failures, "undo (past the first edit)", 0, 0, states.size(), states.size());
+        return;
+    }
+    for (int i = 1; i < states.size(); i++)
+    {
+        if (!lines.redo() || !samePoints(lines, states[i]))
+        {
+            addFailure(failures, "redo (round trip)", i, states[i].size(), states.size(), states.size());
+            return;
+        }
+    }
+    if (lines.redo())
+    {
+        addFailure(failures, "redo (past the last edit)", 0, 0, states.size(), states.size());
+    }
+}
+
+static QVector<FuzzCheck> fuzzChecks()
+{
+    QVector<FuzzCheck> checks;
+    checks.append({ "composite", checkComposite });
+    checks.append({ "integral", checkIntegral });
+    checks.append({ "crossings", checkCrossings });
+    checks.append({ "hitSegment", checkHit });
+    checks.append({ "splitSegment", checkSplit });
+    checks.append({ "edits", checkEdits });
+    return checks;
+}
+
+// Sorted x with occasional repeats most of the time, since that is what the
+// binary search and the batch cursor are built for; the rest is unsorted.
+static QVector<CurvePoint> makeFuzzCurve(QRandomGenerator& random)
+{
+    const int n = random.bounded(8) ? 1 + random.bounded(40) : 1 + random.bounded(2000);
+    const bool sorted = random.bounded(5) != 0;
+    const float scale = powf(10.0f, static_cast<float>(random.bounded(7.0) - 3.0));
+    QVector<CurvePoint> points;
+    points.reserve(n);
+    float x = static_cast<float>(random.generateDouble() - 0.5) * scale;
+    for (int i = 0; i < n; i++)
+    {
+        if (sorted)
+        {
+            x += random.bounded(10) ? static_cast<float>(random.generateDouble()) * scale : 0.0f;
+        }
+        else
+        {
+            x = static_cast<float>(random.generateDouble() - 0.5) * 10 * scale;
+        }
+        float y = static_cast<float>(random.generateDouble() - 0.5) * scale;
+        CurvePoint point(x, y, CurvePoint::PointType(random.bounded(3)));
+        if (i > 0)
+        {
+            // Keeping pos2.x between the anchors makes x(t) monotonic, so
+            // every x has a single y and the paths are comparable at all.
+            float lambda = random.bounded(4) ? static_cast<float>(random.generateDouble())
+                                             : static_cast<float>(random.bounded(2));
+            point.pos2.setX(point.pos.x() + (points.last().pos.x() - point.pos.x()) * lambda);
+            point.pos2.setY(static_cast<float>(random.generateDouble() - 0.5) * 2 * scale);
+        }
+        points.append(point);
+    }
+    return points;
+}
+
+static QVector<float> makeProbes(QRandomGenerator& random, const QVector<CurvePoint>& points)
+{
+    QVector<float> xs;
+    float low = FLT_MAX;
+    float high = -FLT_MAX;
+    for (int i = 0; i < points.size(); i++)
+    {
+        float x = points[i].pos.x();
+        low = qMin(low, x);
+        high = qMax(high, x);
+        xs.append(x);
+        xs.append(nextafterf(x, FLT_MAX));
+        xs.append(nextafterf(x, -FLT_MAX));
+        if (i > 0)
+        {
+            xs.append((x + points[i-1].pos.x()) / 2);
+        }
+    }
+    float span = high - low;
+    for (int k = 0; k < 64; k++)
+    {
+        xs.append(low - span * 0.1f + static_cast<float>(random.generateDouble()) * span * 1.2f);
+    }
+    xs.append(std::nanf(""));
+    xs.append(FLT_MAX);
+    xs.append(-FLT_MAX);
+    return xs;
+}
+
+static QVector<FuzzFailure> runPaths(const QVector<FuzzPath>& paths, const QVector<CurvePoint>& points,
+                                     const QVector<float>& probes)
+{
+    // Every path sees the probes in ascending order and in the scattered
+    // order they were generated in, so cursors and resets both get covered.
+    QVector<float> ascending = probes;
+    std::sort(ascending.begin(), ascending.end(), [](float a, float b)
+    {
+        return a < b || (!qIsNaN(a) && qIsNaN(b));
+    });
+    const QVector<float> orders[] = { probes, ascending };
+
+    // The same paths run on the points in memory and read from a mapping.
+    QVector<FuzzFailure> failures;
+    CurveLines lines[2];
+    lines[0].onCurve(points);
+    if (!CurveFile::write(MappedPath, points) || !lines[1].open(MappedPath))
+    {
+        FuzzFailure failure = { QStringLiteral("open (mapped)"), 0, 0, 0, 0 };
+        failures.append(failure);
+        return failures;
+    }
+    for (const FuzzPath& path : paths)
+    {
+        for (int storage = 0; storage < 2; storage++)
+        {
+            for (const QVector<float>& xs : orders)
+            {
+                QVector<float> ys(xs.size());
+                path.run(lines[storage], xs, ys);
+                for (int k = 0; k < xs.size(); k++)
+                {
+                    FuzzFailure failure;
+                    if (!referenceCheck(points, xs[k], ys[k], failure.low, failure.high))
+                    {
+                        failure.path = QString(path.name) + (storage ? " (mapped)" : "");
+                        failure.x = xs[k];
+                        failure.y = ys[k];
+                        failures.append(failure);
+                    }
+                }
+            }
+        }
+    }
+    static const QVector<FuzzCheck> checks = fuzzChecks();
+    for (const FuzzCheck& check : checks)
+    {
+        for (int storage = 0; storage < 2; storage++)
+        {
+            CurveLines copy;
+            if (storage)
+            {
+                copy.open(MappedPath);
+            }
+            else
+            {
+                copy.onCurve(points);
+            }
+            QVector<FuzzFailure> found;
+            check.run(copy, points, probes, found);
+            for (FuzzFailure& failure : found)
+            {
+                failure.path += storage ? " (mapped)" : "";
+                failures.append(failure);
+            }
+        }
+    }
+    return failures;
+}
+
+// Greedy delta debugging: drop runs of items, halving the run length,
+// and keep every removal after which the case still fails.
+template<typename T>
+static QVector<T> shrinkRuns(QVector<T> items, const std::function<bool(const QVector<T>&)>& fails)
+{
+    for (int chunk = qMax(1, items.size() / 2); chunk >= 1; chunk /= 2)
+    {
+        for (int start = 0; start < items.size() && items.size() > 1; )
+        {
+            QVector<T> candidate = items;
+            candidate.remove(start, qMin(chunk, candidate.size() - start));
+            if (fails(candidate))
+            {
+                items = candidate;
+            }
+            else
+            {
+                start += chunk;
+            }
+        }
+    }
+    return items;
+}
+
+// Batch paths carry a cursor from one probe to the next, so a failure may
+// need the probes before it: points and probes are shrunk in turn.
+static void shrink(const QVector<FuzzPath>& paths, QVector<CurvePoint>& points, QVector<float>& probes)
+{
+    points = shrinkRuns<CurvePoint>(points, [&](const QVector<CurvePoint>& candidate)
+    {
+        return !runPaths(paths, candidate, probes).isEmpty();
+    });
+    for (int i = 0; i < points.size(); i++)
+    {
+        if (points[i].type != CurvePoint::Line)
+        {
+            QVector<CurvePoint> candidate = points;
+            candidate[i].type = CurvePoint::Line;
+            if (!runPaths(paths, candidate, probes).isEmpty())
+            {
+                points = candidate;
+            }
+        }
+    }
+    probes = shrinkRuns<float>(probes, [&](const QVector<float>& candidate)
+    {
+        return !runPaths(paths, points, candidate).isEmpty();
+    });
+}
+
+static void printReproducer(const QVector<CurvePoint>& points, const QVector<float>& probes,
+                            const FuzzFailure& failure)
+{
+    const char *types[] = { "Default", "Line", "Curve" };
+    printf("  probes:");
+    for (float x : probes)
+    {
+        printf(" %.9g", static_cast<double>(x));
+    }
+    printf("\n");
+    printf("  %s(%.9g) = %.9g, reference [%.17g, %.17g]\n", failure.path.toLatin1().constData(),
+           static_cast<double>(failure.x), static_cast<double>(failure.y), failure.low, failure.high);
+    printf("  QVector<CurvePoint> points;\n");
+    for (const CurvePoint& point : points)
+    {
+        printf("  points.append(CurvePoint(%.9gf, %.9gf, CurvePoint::%s));"
+               " points.last().pos2 = QVector2D(%.9gf, %.9gf);\n",
+               static_cast<double>(point.pos.x()), static_cast<double>(point.pos.y()),
+               types[qBound(0, static_cast<int>(point.type), 2)],
+               static_cast<double>(point.pos2.x()), static_cast<double>(point.pos2.y()));
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Differential fuzzing of the CurveLines query paths against a reference evaluator.");
+    parser.addHelpOption();
+    QCommandLineOption iterationsOption("iterations", "Random curves to check.", "count", "2000");
+    QCommandLineOption seedOption("seed", "First random seed.", "seed", "1");
+    parser.addOption(iterationsOption);
+    parser.addOption(seedOption);
+    parser.process(a);
+
+    const int iterations = parser.value(iterationsOption).toInt();
+    const quint32 seed = parser.value(seedOption).toUInt();
+    const QVector<FuzzPath> paths = fuzzPaths();
+    MappedPath = QDir::temp().filePath(QString("evalfuzz-%1.crv").arg(QCoreApplication::applicationPid()));
+
+    int failed = 0;
+    qint64 probed = 0;
+    for (int k = 0; k < iterations; k++)
+    {
+        QRandomGenerator random(seed + static_cast<quint32>(k));
+        QVector<CurvePoint> points = makeFuzzCurve(random);
+        QVector<float> probes = makeProbes(random, points);
+        probed += probes.size() * paths.size() * 4;
+
+        QVector<FuzzFailure> failures = runPaths(paths, points, probes);
+        if (failures.isEmpty())
+        {
+            continue;
+        }
+        failed++;
+        printf("seed %u: %d mismatches on %d points\n", seed + static_cast<quint32>(k),
+               failures.size(), points.size());
+        shrink(paths, points, probes);
+        printReproducer(points, probes, runPaths(paths, points, probes).first());
+        fflush(stdout);
+    }
+    QFile::remove(MappedPath);
+    printf("%d curves, %lld queries, %d failing\n", iterations, probed, failed);
+    return failed ? 1 : 0;
+}
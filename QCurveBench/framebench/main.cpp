@@ -0,0 +1,66 @@
+#include <cstdio>
+#include <QElapsedTimer>
+#include "curveframe.h"
+#include "benchcurve.h"
+
+static double runEncode(const QJsonObject& message, const QVector<CurvePoint>& points,
+                        CurveFrame::Encoding encoding, int threshold, QByteArray& frame)
+{
+    QElapsedTimer timer;
+    timer.start();
+    frame = CurveFrame::encode(message, points, encoding, threshold);
+    return timer.nsecsElapsed() / 1e6;
+}
+
+static double runDecode(const QByteArray& frame, QVector<CurvePoint>& points)
+{
+    QJsonObject message;
+    QElapsedTimer timer;
+    timer.start();
+    CurveFrame::decode(frame, message, points);
+    return timer.nsecsElapsed() / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    Q_UNUSED(argc);
+    Q_UNUSED(argv);
+
+    const int counts[] = { 1000, 100000, 1000000 };
+    const CurveFrame::Encoding encodings[] = { CurveFrame::Json, CurveFrame::Zlib, CurveFrame::Delta };
+
+    QJsonArray zoom;
+    zoom.append(100.0);
+    QJsonObject message;
+    message["zoom"] = zoom;
+
+    printf("points,encoding,bytes,ratio,encode_ms,decode_ms,lossless\n");
+    for (int count : counts)
+    {
+        QVector<CurvePoint> points = makeBenchCurve(count);
+        QByteArray json;
+        runEncode(message, points, CurveFrame::Json, 0, json);
+        for (CurveFrame::Encoding encoding : encodings)
+        {
+            // Threshold 0 forces compression so the ratio column is meaningful
+            // even for the smallest curve.
+            QByteArray frame;
+            double encodeTime = runEncode(message, points, encoding, 0, frame);
+            QVector<CurvePoint> decoded;
+            double decodeTime = runDecode(frame, decoded);
+
+            bool lossless = decoded.size() == points.size();
+            for (int i = 0; lossless && i < points.size(); i++)
+            {
+                lossless = decoded[i].type == points[i].type &&
+                        decoded[i].pos == points[i].pos && decoded[i].pos2 == points[i].pos2;
+            }
+
+            printf("%d,%s,%d,%.3f,%.3f,%.3f,%s\n", count,
+                   CurveFrame::encodingName(encoding).toLatin1().constData(),
+                   frame.size(), static_cast<double>(json.size()) / frame.size(),
+                   encodeTime, decodeTime, lossless ? "yes" : "no");
+        }
+    }
+    return 0;
+}
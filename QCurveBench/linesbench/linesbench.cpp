@@ -0,0 +1,448 @@
+#include <QtTest>
+#include "curvelines.h"
+#include "curveexport.h"
+#include "curvesnapshot.h"
+#include "curveexpr.h"
+#include "benchcurve.h"
+
+class LinesBench : public QObject
+{
+    Q_OBJECT
+
+private:
+    void addSizes();
+    void load(CurveLines& lines, int count);
+    QRectF window(CurveLines& lines, float fraction);
+
+private slots:
+    void insertPoint_data();
+    void insertPoint();
+    void insertBatch_data();
+    void insertBatch();
+    void streamPoint_data();
+    void streamPoint();
+    void getValue_data();
+    void getValue();
+    void cursorSweep_data();
+    void cursorSweep();
+    void integral_data();
+    void integral();
+    void crossings_data();
+    void crossings();
+    void hitSegment_data();
+    void hitSegment();
+    void composite_data();
+    void composite();
+    void evaluate_data();
+    void evaluate();
+    void touchPoints_data();
+    void touchPoints();
+    void findTouchPoint_data();
+    void findTouchPoint();
+    void moveTouchPoint_data();
+    void moveTouchPoint();
+    void transformPoints_data();
+    void transformPoints();
+    void deleteTouchPoint_data();
+    void deleteTouchPoint();
+    void updatePoints_data();
+    void updatePoints();
+    void exportSamples_data();
+    void exportSamples();
+};
+
+void LinesBench::addSizes()
+{
+    int limit = qEnvironmentVariableIsSet("LINESBENCH_MAX_POINTS") ?
+                qEnvironmentVariableIntValue("LINESBENCH_MAX_POINTS") : 10000000;
+    QTest::addColumn<int>("count");
+    for (int count = 10; count <= limit; count *= 10)
+    {
+        QTest::newRow(QByteArray::number(count).constData()) << count;
+    }
+}
+
+void LinesBench::load(CurveLines &lines, int count)
+{
+    lines.onCurve(makeBenchCurve(count));
+}
+
+QRectF LinesBench::window(CurveLines &lines, float fraction)
+{
+    float x0 = lines.firstPoint().pos.x();
+    float x1 = lines.lastPoint().pos.x();
+    float width = (x1 - x0) * fraction;
+    float center = (x0 + x1) / 2;
+    return QRectF(center - width / 2, -1e9, width, 2e9);
+}
+
+void LinesBench::insertPoint_data()
+{
+    addSizes();
+}
+
+void LinesBench::insertPoint()
+{
+    QFETCH(int, count);
+    CurveLines lines;
+    load(lines, count);
+    float x = lines.lastPoint().pos.x();
+    QBENCHMARK {
+        x += 0.01f;
+        lines.insertPoint(CurvePoint(x, 0.0f, CurvePoint::Line));
+    }
+}
+
+void LinesBench::insertBatch_data()
+{
+    addSizes();
+}
+
+void LinesBench::insertBatch()
+{
+    QFETCH(int, count);
+    CurveLines lines;
+    load(lines, count);
+    float x = lines.lastPoint().pos.x();
+    QBENCHMARK {
+        // A thousand inserts, one stats pass and one updateCurve
+        CurveLinesBatch batch(lines);
+        for (int i = 0; i < 1000; i++)
+        {
+            x += 0.01f;
+            lines.insertPoint(CurvePoint(x, 0.0f, CurvePoint::Line));
+        }
+    }
+}
+
+void LinesBench::streamPoint_data()
+{
+    addSizes();
+}
+
+void LinesBench::streamPoint()
+{
+    // Full ring: every append drops the oldest point
+    QFETCH(int, count);
+    CurveLines lines;
+    load(lines, count);
+    lines.setStreaming(count);
+    float x = lines.lastPoint().pos.x();
+    QBENCHMARK {
+        x += 0.01f;
+        lines.streamPoint(CurvePoint(x, 0.0f, CurvePoint::Line));
+    }
+}
+
+void LinesBench::getValue_data()
+{
+    addSizes();
+}
+
+void LinesBench::getValue()
+{
+    QFETCH(int, count);
+    CurveLines lines;
+    load(lines, count);
+    float x0 = lines.firstPoint().pos.x();
+    float span = lines.lastPoint().pos.x() - x0;
+    int k = 0;
+    float sum = 0;
+    QBENCHMARK {
+        // Golden-ratio stride: spread queries without a random generator
+        float f = (k++) * 0.6180339887f;
+        sum += lines.getValue(x0 + span * (f - floorf(f)));
+    }
+    QVERIFY(qIsFinite(sum));
+}
+
+void LinesBench::cursorSweep_data()
+{
+    addSizes();
+}
+
+void LinesBench::cursorSweep()
+{
+    // The playback access pattern: small steps forward, wrapping at the end.
+    QFETCH(int, count);
+    CurveLines lines;
+    load(lines, count);
+    CurveCursor cursor;
+    cursor.reset(lines.publishSnapshot());
+    float x0 = lines.firstPoint().pos.x();
+    float span = lines.lastPoint().pos.x() - x0;
+    float step = span / 100000;
+    float x = x0;
+    float sum = 0;
+    QBENCHMARK {
+        x = x + step > x0 + span ? x0 : x + step;
+        sum += cursor.value(x);
+    }
+    QVERIFY(qIsFinite(sum));
+}
+
+void LinesBench::integral_data()
+{
+    addSizes();
+}
+
+void LinesBench::integral()
+{
+    // One point moved per query, as while dragging with the tips shown
+    QFETCH(int, count);
+    CurveLines lines;
+    load(lines, count);
+    float x0 = lines.firstPoint().pos.x();
+    float span = lines.lastPoint().pos.x() - x0;
+    lines.integral(x0, x0 + span);
+    lines.touchPoints(QVector2D(lines.pointAt(count / 2).pos), 100.0f);
+    lines.pointsDragSize();
+    double sum = 0;
+    QBENCHMARK {
+        lines.moveDragPoint(QVector2D(0, 0.001f), CurveLines::Y_Axis);
+        sum += lines.integral(x0 + span * 0.25f, x0 + span * 0.75f);
+    }
+    QVERIFY(qIsFinite(sum));
+}
+
+void LinesBench::crossings_data()
+{
+    addSizes();
+}
+
+void LinesBench::crossings()
+{
+    // First time the curve reaches the moved point's level, one point moved
+    // per query.
+    QFETCH(int, count);
+    CurveLines lines;
+    load(lines, count);
+    lines.crossings(0);
+    lines.touchPoints(QVector2D(lines.pointAt(count / 2).pos), 100.0f);
+    lines.pointsDragSize();
+    int found = 0;
+    QBENCHMARK {
+        lines.moveDragPoint(QVector2D(0, 0.001f), CurveLines::Y_Axis);
+        found += lines.crossings(lines.pointAt(count / 2).pos.y(), 1).size();
+    }
+    QVERIFY(found > 0);
+}
+
+void LinesBench::hitSegment_data()
+{
+    addSizes();
+}
+
+void LinesBench::hitSegment()
+{
+    // The cursor walking along the curve, 8 pixels of reach at the
+    // default zoom.
+    QFETCH(int, count);
+    CurveLines lines;
+    load(lines, count);
+    float x0 = lines.firstPoint().pos.x();
+    float span = lines.lastPoint().pos.x() - x0;
+    float step = span / 1000;
+    float x = x0;
+    int found = 0;
+    QBENCHMARK {
+        x = x + step > x0 + span ? x0 : x + step;
+        float t;
+        QVector2D nearest;
+        found += lines.hitSegment(QVector2D(x, lines.getValue(x) + 0.02f), 0.08f, t, nearest) > 0;
+    }
+    QVERIFY(found > 0);
+}
+
+void LinesBench::composite_data()
+{
+    addSizes();
+}
+
+void LinesBench::composite()
+{
+    // A frame's worth of x's through a * 0.5 + b shifted. Only b changes
+    // per frame, so the a branch comes out of its cache.
+    QFETCH(int, count);
+    CurveLines a;
+    CurveLines b;
+    load(a, count);
+    load(b, count);
+    CurveExprPtr expr = CurveExpr::add(CurveExpr::scale(CurveExpr::curve(&a), 0.5f),
+                                       CurveExpr::shift(CurveExpr::curve(&b), 1.0f));
+    float x0 = a.firstPoint().pos.x();
+    float span = a.lastPoint().pos.x() - x0;
+    QVector<float> xs(1920);
+    for (int k = 0; k < xs.size(); k++)
+    {
+        xs[k] = x0 + span * k / (xs.size() - 1);
+    }
+    QVector<float> ys;
+    QBENCHMARK {
+        b.insertPoint(CurvePoint(b.lastPoint().pos.x() + 0.01f, 0.0f, CurvePoint::Line));
+        ys = expr->evaluate(xs);
+    }
+    QCOMPARE(ys.size(), xs.size());
+}
+
+void LinesBench::evaluate_data()
+{
+    addSizes();
+}
+
+void LinesBench::evaluate()
+{
+    QFETCH(int, count);
+    CurveLines lines;
+    load(lines, count);
+    int k = 0;
+    float sum = 0;
+    QBENCHMARK {
+        int i = 1 + (k * 7919) % (count - 1);
+        float t = (k % 64) / 64.0f;
+        sum += lines.evaluate(i, t).y();
+        k++;
+    }
+    QVERIFY(qIsFinite(sum));
+}
+
+void LinesBench::touchPoints_data()
+{
+    addSizes();
+}
+
+void LinesBench::touchPoints()
+{
+    QFETCH(int, count);
+    CurveLines lines;
+    load(lines, count);
+    QRectF rect = window(lines, 0.01f);
+    QBENCHMARK {
+        lines.touchPoints(rect);
+    }
+}
+
+void LinesBench::findTouchPoint_data()
+{
+    addSizes();
+}
+
+void LinesBench::findTouchPoint()
+{
+    QFETCH(int, count);
+    CurveLines lines;
+    load(lines, count);
+    QVector2D pos(lines.currentPoint(count / 2).pos);
+    QBENCHMARK {
+        lines.findTouchPoint(pos);
+    }
+}
+
+void LinesBench::moveTouchPoint_data()
+{
+    addSizes();
+}
+
+void LinesBench::moveTouchPoint()
+{
+    QFETCH(int, count);
+    CurveLines lines;
+    load(lines, count);
+    lines.touchPoints(window(lines, 0.01f));
+    QVector2D offset(0.0f, 0.001f);
+    QBENCHMARK {
+        lines.moveTouchPoint(offset, CurveLines::XY_Axis);
+    }
+}
+
+void LinesBench::transformPoints_data()
+{
+    addSizes();
+}
+
+void LinesBench::transformPoints()
+{
+    // Half the curve stretched and shrunk back about its middle, one undo
+    // step per call.
+    QFETCH(int, count);
+    CurveLines lines;
+    load(lines, count);
+    QRectF rect = window(lines, 0.5f);
+    lines.touchPoints(rect);
+    QVector2D pivot(rect.center());
+    bool up = true;
+    QBENCHMARK {
+        lines.transformPoints(QVector2D(1.0f, up ? 1.25f : 0.8f), pivot);
+        up = !up;
+    }
+}
+
+void LinesBench::deleteTouchPoint_data()
+{
+    addSizes();
+}
+
+void LinesBench::deleteTouchPoint()
+{
+    QFETCH(int, count);
+    CurveLines lines;
+    load(lines, count);
+    QBENCHMARK {
+        // One point per iteration; refill so the curve never runs dry
+        if (lines.pointsSize() < 2)
+        {
+            load(lines, count);
+        }
+        lines.currentPoint(lines.pointsSize() / 2).touch = true;
+        lines.deleteTouchPoint();
+    }
+}
+
+void LinesBench::updatePoints_data()
+{
+    addSizes();
+}
+
+void LinesBench::updatePoints()
+{
+    QFETCH(int, count);
+    CurveLines lines;
+    load(lines, count);
+    QBENCHMARK {
+        lines.updatePoints();
+    }
+}
+
+void LinesBench::exportSamples_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("threads");
+    for (int format = CurveExport::Float32; format <= CurveExport::Zlib; format++)
+    {
+        for (int threads = 1; threads <= QThread::idealThreadCount(); threads *= 2)
+        {
+            QTest::newRow(QStringLiteral("%1/%2 threads").arg(format == CurveExport::Zlib ? "zlib" : "float32")
+                          .arg(threads).toLatin1().constData()) << format << threads;
+        }
+    }
+}
+
+void LinesBench::exportSamples()
+{
+    QFETCH(int, format);
+    QFETCH(int, threads);
+    CurveLines lines;
+    load(lines, 100000);
+    QString path = QDir::temp().filePath(QStringLiteral("linesbench-%1.smp").arg(QCoreApplication::applicationPid()));
+    QString error;
+    QBENCHMARK {
+        QVERIFY2(CurveExport::write(lines, path, lines.firstPoint().pos.x(), lines.lastPoint().pos.x(),
+                                    16 * CurveExport::ChunkSamples, CurveExport::Format(format), threads, &error),
+                 qPrintable(error));
+    }
+    QFile::remove(path);
+}
+
+QTEST_GUILESS_MAIN(LinesBench)
+
+#include "linesbench.moc"
@@ -0,0 +1,44 @@
+#-------------------------------------------------
+#
+# QBENCHMARK suite for the CurveLines hot paths
+#
+# Machine readable results:
+#   ./linesbench -o linesbench.xml,xml
+#   ./linesbench -o linesbench.csv,csv
+# LINESBENCH_MAX_POINTS caps the curve size (default 10000000).
+#
+#-------------------------------------------------
+
+QT       += core gui testlib
+
+TARGET = linesbench
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+CURVE_DIR = $$PWD/../../QCurveWidget
+INCLUDEPATH += $$CURVE_DIR $$PWD/../common
+
+SOURCES += \
+        linesbench.cpp \
+    $$CURVE_DIR/curvelines.cpp \
+    $$CURVE_DIR/curvefile.cpp \
+    $$CURVE_DIR/curveoverlay.cpp \
+    $$CURVE_DIR/curvesnapshot.cpp \
+    $$CURVE_DIR/curvestream.cpp \
+    $$CURVE_DIR/curveexpr.cpp \
+    $$CURVE_DIR/curveframe.cpp \
+    $$CURVE_DIR/curveexport.cpp
+
+HEADERS += \
+    ../common/benchcurve.h \
+    $$CURVE_DIR/curvelines.h \
+    $$CURVE_DIR/curvefile.h \
+    $$CURVE_DIR/curveoverlay.h \
+    $$CURVE_DIR/curvesnapshot.h \
+    $$CURVE_DIR/curvestream.h \
+    $$CURVE_DIR/curveexpr.h \
+    $$CURVE_DIR/curveframe.h \
+    $$CURVE_DIR/curveexport.h
@@ -0,0 +1,169 @@
+#include <cstdio>
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QImage>
+#include "qcurveeditwidget.h"
+#include "benchcurve.h"
+
+struct RenderTimes
+{
+    double frame;
+    double grid;
+    double curves;
+    double dots;
+    double text;
+};
+
+static qint64 elapsed(QElapsedTimer& timer)
+{
+    qint64 ns = timer.nsecsElapsed();
+    timer.restart();
+    return ns;
+}
+
+static RenderTimes measure(QCurveEditWidget& widget, const QSize& size, int frames)
+{
+    RenderTimes times = { 0, 0, 0, 0, 0 };
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    QElapsedTimer timer;
+    for (int i = 0; i < frames; i++)
+    {
+        timer.start();
+        widget.render(&image);
+        times.frame += elapsed(timer);
+
+        image.fill(QColor(38, 38, 38));
+        QPainter painter(&image);
+        timer.restart();
+        widget.drawGrid(painter);
+        times.grid += elapsed(timer);
+        widget.drawTips(painter);
+        times.text += elapsed(timer);
+        widget.drawCurves(painter);
+        times.curves += elapsed(timer);
+        widget.drawDots(painter);
+        times.dots += elapsed(timer);
+        widget.drawLabels(painter);
+        times.text += elapsed(timer);
+    }
+    double scale = 1e6 * frames;
+    times.frame /= scale;
+    times.grid /= scale;
+    times.curves /= scale;
+    times.dots /= scale;
+    times.text /= scale;
+    return times;
+}
+
+static int countDiff(const QImage& a, const QImage& b)
+{
+    if (a.size() != b.size())
+    {
+        return a.width() * a.height();
+    }
+    QImage x = a.convertToFormat(QImage::Format_ARGB32);
+    QImage y = b.convertToFormat(QImage::Format_ARGB32);
+    int diff = 0;
+    for (int row = 0; row < x.height(); row++)
+    {
+        const QRgb* p = reinterpret_cast<const QRgb*>(x.constScanLine(row));
+        const QRgb* q = reinterpret_cast<const QRgb*>(y.constScanLine(row));
+        for (int col = 0; col < x.width(); col++)
+        {
+            if (p[col] != q[col])
+            {
+                diff++;
+            }
+        }
+    }
+    return diff;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Offscreen QCurveEditWidget paint benchmark with golden image checks.");
+    parser.addHelpOption();
+    QCommandLineOption goldenOption("golden", "Directory holding the golden images.", "dir");
+    QCommandLineOption updateOption("update", "Write the golden images instead of comparing.");
+    QCommandLineOption framesOption("frames", "Frames averaged per configuration.", "frames", "20");
+    QCommandLineOption toleranceOption("tolerance", "Differing pixels allowed per image.", "pixels", "0");
+    parser.addOption(goldenOption);
+    parser.addOption(updateOption);
+    parser.addOption(framesOption);
+    parser.addOption(toleranceOption);
+    parser.process(a);
+
+    const int counts[] = { 100, 1000, 10000 };
+    const float scales[] = { 20.0f, 100.0f, 500.0f };
+    const QSize sizes[] = { QSize(640, 480), QSize(1280, 720), QSize(1920, 1080) };
+    const int frames = qMax(1, parser.value(framesOption).toInt());
+    const int tolerance = parser.value(toleranceOption).toInt();
+    QDir golden(parser.value(goldenOption));
+    if (parser.isSet(goldenOption) && parser.isSet(updateOption))
+    {
+        golden.mkpath(".");
+    }
+
+    QCurveEditWidget widget;
+    widget.setAttribute(Qt::WA_DontShowOnScreen);
+    widget.show();
+
+    int failures = 0;
+    printf("points,scale,width,height,frame_ms,grid_ms,curves_ms,dots_ms,text_ms,golden\n");
+    for (int count : counts)
+    {
+        widget.clearCurveLines();
+        for (const CurvePoint& point : makeBenchCurve(count))
+        {
+            widget.addCurveLine(point);
+        }
+        float center = widget.getCurveLines()->getValue(widget.getCurveLines()->lastPoint().pos.x() / 2);
+
+        for (const QSize& size : sizes)
+        {
+            widget.resize(size);
+            for (float scale : scales)
+            {
+                // Look at the middle of the curve, mid-way up the window
+                float x = widget.getCurveLines()->lastPoint().pos.x() / 2;
+                widget.setView(scale, QVector2D(size.width() / 2 - x * scale, size.height() / 2 + center * scale));
+                RenderTimes times = measure(widget, size, frames);
+
+                QString status = "-";
+                if (parser.isSet(goldenOption))
+                {
+                    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+                    widget.render(&image);
+                    QString name = golden.filePath(QString("n%1_s%2_%3x%4.png")
+                                                   .arg(count).arg(static_cast<double>(scale))
+                                                   .arg(size.width()).arg(size.height()));
+                    if (parser.isSet(updateOption))
+                    {
+                        status = image.save(name) ? "written" : "write-failed";
+                    }
+                    else
+                    {
+                        int diff = countDiff(image, QImage(name));
+                        status = diff <= tolerance ? "match" : QString("diff:%1").arg(diff);
+                        failures += diff > tolerance;
+                    }
+                }
+
+                printf("%d,%g,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%s\n", count, static_cast<double>(scale),
+                       size.width(), size.height(), times.frame, times.grid, times.curves,
+                       times.dots, times.text, status.toLatin1().constData());
+                fflush(stdout);
+            }
+        }
+    }
+    return failures ? 1 : 0;
+}
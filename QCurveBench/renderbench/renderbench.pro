@@ -0,0 +1,44 @@
+#-------------------------------------------------
+#
+# Offscreen paint benchmark and golden image check for QCurveEditWidget
+#
+#   ./renderbench --golden goldens --update   record reference images
+#   ./renderbench --golden goldens            time and compare against them
+#
+# Goldens depend on the fonts of the machine that recorded them.
+#
+#-------------------------------------------------
+
+QT       += core gui widgets
+
+TARGET = renderbench
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+CURVE_DIR = $$PWD/../../QCurveWidget
+INCLUDEPATH += $$CURVE_DIR $$PWD/../common
+
+SOURCES += \
+        main.cpp \
+    $$CURVE_DIR/curvelines.cpp \
+    $$CURVE_DIR/curvefile.cpp \
+    $$CURVE_DIR/curveoverlay.cpp \
+    $$CURVE_DIR/curvesnapshot.cpp \
+    $$CURVE_DIR/curvestream.cpp \
+    $$CURVE_DIR/curveexpr.cpp \
+    $$CURVE_DIR/curveset.cpp \
+    $$CURVE_DIR/qcurveeditwidget.cpp
+
+HEADERS += \
+    ../common/benchcurve.h \
+    $$CURVE_DIR/curvelines.h \
+    $$CURVE_DIR/curvefile.h \
+    $$CURVE_DIR/curveoverlay.h \
+    $$CURVE_DIR/curvesnapshot.h \
+    $$CURVE_DIR/curvestream.h \
+    $$CURVE_DIR/curveexpr.h \
+    $$CURVE_DIR/curveset.h \
+    $$CURVE_DIR/qcurveeditwidget.h
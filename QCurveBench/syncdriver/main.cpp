@@ -0,0 +1,200 @@
+#include <cstdio>
+#include <algorithm>
+#include <functional>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QHash>
+#include "qcurvesocketwidget.h"
+#include "benchcurve.h"
+
+const int SettleTimeout = 10000;
+
+struct SyncRun
+{
+    QString scenario;
+    int points;
+    int edits;
+};
+
+static double percentile(const QVector<qint64>& sorted, double p)
+{
+    if (sorted.isEmpty())
+    {
+        return 0;
+    }
+    int index = qBound(0, static_cast<int>(p * (sorted.size() - 1) + 0.5), sorted.size() - 1);
+    return sorted[index] / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays synthetic edit streams through QCurveCenterData against syncserver.");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Comma separated curve sizes.", "sizes", "10,100,1000,10000,100000,1000000");
+    QCommandLineOption scenariosOption("scenarios", "Comma separated scenarios (drag, insert, zoom).", "scenarios", "drag,insert,zoom");
+    parser.addOption(sizesOption);
+    parser.addOption(scenariosOption);
+    parser.process(a);
+
+    QVector<SyncRun> runs;
+    for (const QString& scenario : parser.value(scenariosOption).split(","))
+    {
+        for (const QString& size : parser.value(sizesOption).split(","))
+        {
+            SyncRun run;
+            run.scenario = scenario;
+            run.points = size.toInt();
+            // Keep the serialized volume per run roughly constant
+            run.edits = qBound(5, 2000000 / qMax(1, run.points), 200);
+            runs.append(run);
+        }
+    }
+
+    CurveLines lines;
+    QCurveCenterData data;
+    QObject::connect(&lines, &CurveLines::updateCurve, &data, &QCurveCenterData::onCurve);
+
+    QElapsedTimer clock;
+    clock.start();
+    // Edit time of every frame sent during the current run, by the seq its
+    // ack echoes. Acks for anything else (the setup frames, or a previous
+    // run that timed out) are not in here and are dropped.
+    QHash<qint64, qint64> sent;
+    QVector<qint64> latencies;
+    QObject::connect(&data, &QCurveCenterData::remoteAck, [&](const QJsonObject &ack){
+        qint64 seq = static_cast<qint64>(ack["seq"].toDouble(-1));
+        if (sent.contains(seq))
+        {
+            latencies.append(clock.nsecsElapsed() - sent.take(seq));
+        }
+    });
+
+    int current = 0;
+    int edit = 0;
+    qint64 startFrames = 0;
+    qint64 startBytes = 0;
+    qint64 startTime = 0;
+    qint64 settleTime = 0;
+    QTimer step;
+    step.setInterval(0);
+
+    std::function<void()> startRun = [&](){
+        const SyncRun& run = runs[current];
+        QVector<CurvePoint> points = makeBenchCurve(run.points);
+        lines.onCurve(points);
+        data.onCurve(points);
+        data.onZoom(100.0f, QPoint(400, 300), QRect(0, 0, 800, 600));
+        if (run.scenario == "drag" && run.points)
+        {
+            float x0 = lines.firstPoint().pos.x();
+            float x1 = lines.lastPoint().pos.x();
+            float width = (x1 - x0) * 0.01f;
+            float center = (x0 + x1) / 2;
+            lines.releasePoints();
+            lines.touchPoints(QRectF(center - width / 2, -FLT_MAX / 2, width, FLT_MAX));
+            lines.pointsDragSize();
+        }
+        sent.clear();
+        latencies.clear();
+        edit = 0;
+        settleTime = 0;
+        QCurveRemoteStats stats = data.remoteStats();
+        startFrames = stats.frames;
+        startBytes = stats.bytes;
+        startTime = clock.nsecsElapsed();
+    };
+
+    QObject::connect(&step, &QTimer::timeout, [&](){
+        const SyncRun& run = runs[current];
+        if (edit < run.edits)
+        {
+            qint64 frames = data.remoteStats().frames;
+            qint64 editTime = clock.nsecsElapsed();
+            if (run.scenario == "drag")
+            {
+                lines.moveDragPoint(QVector2D(0.001f, 0.01f), CurveLines::XY_Axis);
+            }
+            else if (run.scenario == "insert")
+            {
+                for (int i = 0; i < 10; i++)
+                {
+                    float x = lines.pointsSize() ? lines.lastPoint().pos.x() + 0.01f : 0.0f;
+                    lines.insertPoint(CurvePoint(x, static_cast<float>(i), CurvePoint::Line));
+                }
+            }
+            else
+            {
+                float scale = 100.0f * (1.0f + 0.5f * sinf(edit * 0.3f));
+                data.onZoom(scale, QPoint(400 + edit, 300), QRect(0, 0, 800, 600));
+            }
+            if (data.remoteStats().frames > frames)
+            {
+                sent.insert(data.remoteSeq(), editTime);
+            }
+            edit++;
+            return;
+        }
+
+        if (!settleTime)
+        {
+            settleTime = clock.nsecsElapsed();
+        }
+        bool settled = sent.isEmpty();
+        if (!settled && (clock.nsecsElapsed() - settleTime) / 1000000 < SettleTimeout)
+        {
+            return;
+        }
+
+        QCurveRemoteStats stats = data.remoteStats();
+        double seconds = (clock.nsecsElapsed() - startTime) / 1e9;
+        qint64 frames = stats.frames - startFrames;
+        qint64 bytes = stats.bytes - startBytes;
+        std::sort(latencies.begin(), latencies.end());
+        printf("%s,%d,%d,%lld,%lld,%.1f,%.0f,%.3f,%.3f,%.3f,%.3f\n",
+               run.scenario.toLatin1().constData(), run.points, run.edits,
+               frames, static_cast<qint64>(latencies.size()),
+               seconds > 0 ? frames / seconds : 0.0, seconds > 0 ? bytes / seconds : 0.0,
+               percentile(latencies, 0.5), percentile(latencies, 0.9),
+               percentile(latencies, 0.99), percentile(latencies, 1.0));
+        fflush(stdout);
+
+        if (++current >= runs.size())
+        {
+            step.stop();
+            data.remoteDisconnect();
+            a.quit();
+            return;
+        }
+        startRun();
+    });
+
+    QTimer connecting;
+    connecting.setInterval(10);
+    QObject::connect(&connecting, &QTimer::timeout, [&](){
+        if (data.remoteState() != QCurveCenterData::Remote_Connected)
+        {
+            if ((clock.nsecsElapsed() / 1000000) > SettleTimeout)
+            {
+                fprintf(stderr, "no server on ws://localhost:8081, start syncserver first\n");
+                a.exit(1);
+            }
+            return;
+        }
+        connecting.stop();
+        printf("scenario,points,edits,frames,acks,frames_per_s,bytes_per_s,p50_ms,p90_ms,p99_ms,max_ms\n");
+        startRun();
+        step.start();
+    });
+
+    if (runs.isEmpty())
+    {
+        return 0;
+    }
+    data.remoteConnect();
+    connecting.start();
+    return a.exec();
+}
@@ -0,0 +1,39 @@
+#-------------------------------------------------
+#
+# Headless load generator for QCurveCenterData, run against syncserver
+#
+#-------------------------------------------------
+
+QT       += core gui widgets websockets
+
+TARGET = syncdriver
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+CURVE_DIR = $$PWD/../../QCurveWidget
+INCLUDEPATH += $$CURVE_DIR $$PWD/../common
+
+SOURCES += \
+        main.cpp \
+    $$CURVE_DIR/curvelines.cpp \
+    $$CURVE_DIR/curvefile.cpp \
+    $$CURVE_DIR/curveoverlay.cpp \
+    $$CURVE_DIR/curvesnapshot.cpp \
+    $$CURVE_DIR/curvestream.cpp \
+    $$CURVE_DIR/curveframe.cpp \
+    $$CURVE_DIR/curvehistogram.cpp \
+    $$CURVE_DIR/qcurvesocketwidget.cpp
+
+HEADERS += \
+    ../common/benchcurve.h \
+    $$CURVE_DIR/curvelines.h \
+    $$CURVE_DIR/curvefile.h \
+    $$CURVE_DIR/curveoverlay.h \
+    $$CURVE_DIR/curvesnapshot.h \
+    $$CURVE_DIR/curvestream.h \
+    $$CURVE_DIR/curveframe.h \
+    $$CURVE_DIR/curvehistogram.h \
+    $$CURVE_DIR/qcurvesocketwidget.h
@@ -0,0 +1,103 @@
+#include <cstdio>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QWebSocket>
+#include <QWebSocketServer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include "curveframe.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Stand-in curve server: acknowledges frames and records their arrival.");
+    parser.addHelpOption();
+    QCommandLineOption portOption("port", "Port to listen on.", "port", "8081");
+    QCommandLineOption encodingOption("encoding", "Encoding answered to a client hello (json, zlib, delta).", "encoding", "json");
+    QCommandLineOption logOption("log", "CSV file receiving one line per frame.", "file");
+    parser.addOption(portOption);
+    parser.addOption(encodingOption);
+    parser.addOption(logOption);
+    parser.process(a);
+
+    QFile log(parser.value(logOption));
+    QTextStream logStream(&log);
+    if(parser.isSet(logOption))
+    {
+        if(!log.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            fprintf(stderr, "cannot open %s\n", qPrintable(log.fileName()));
+            return 1;
+        }
+        logStream << "frame,received_ns,bytes\n";
+    }
+
+    QWebSocketServer server(QStringLiteral("syncserver"), QWebSocketServer::NonSecureMode);
+    quint16 port = static_cast<quint16>(parser.value(portOption).toUInt());
+    if(!server.listen(QHostAddress::Any, port))
+    {
+        fprintf(stderr, "listen on %u failed: %s\n", port, qPrintable(server.errorString()));
+        return 1;
+    }
+    fprintf(stderr, "listening on %u\n", port);
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 frames = 0;
+    qint64 bytes = 0;
+    QString encoding = parser.value(encodingOption);
+
+    QObject::connect(&server, &QWebSocketServer::newConnection, [&](){
+        while (server.hasPendingConnections())
+        {
+            QWebSocket *socket = server.nextPendingConnection();
+            QObject::connect(socket, &QWebSocket::binaryMessageReceived, [&, socket](const QByteArray &message){
+                qint64 received = clock.nsecsElapsed();
+                frames++;
+                bytes += message.size();
+                if(log.isOpen())
+                {
+                    logStream << frames << ',' << received << ',' << message.size() << '\n';
+                }
+
+                QJsonObject ack;
+                QJsonObject frame;
+                QVector<CurvePoint> points;
+                if(CurveFrame::decode(message, frame, points))
+                {
+                    ack["seq"] = frame["seq"];
+                    ack["points"] = points.size();
+                }
+                ack["frame"] = frames;
+                ack["bytes"] = message.size();
+                QJsonObject ackData;
+                ackData["ack"] = ack;
+                socket->sendTextMessage(QString::fromUtf8(QJsonDocument(ackData).toJson(QJsonDocument::Compact)));
+            });
+            QObject::connect(socket, &QWebSocket::textMessageReceived, [&, socket](const QString &message){
+                QJsonObject socketData = QJsonDocument::fromJson(message.toUtf8()).object();
+                if(socketData.contains("hello"))
+                {
+                    QJsonObject reply;
+                    reply["encoding"] = encoding;
+                    socket->sendTextMessage(QString::fromUtf8(QJsonDocument(reply).toJson(QJsonDocument::Compact)));
+                }
+            });
+            QObject::connect(socket, &QWebSocket::disconnected, [&, socket](){
+                double seconds = clock.nsecsElapsed() / 1e9;
+                fprintf(stderr, "client gone: %lld frames, %lld bytes, %.1f frames/s\n",
+                        frames, bytes, seconds > 0 ? frames / seconds : 0.0);
+                logStream.flush();
+                socket->deleteLater();
+            });
+        }
+    });
+
+    return a.exec();
+}
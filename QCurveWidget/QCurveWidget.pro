@@ -28,11 +28,35 @@ SOURCES += \
         main.cpp \
     qcurveeditwidget.cpp \
     curvelines.cpp \
+    curvefile.cpp \
+    curveoverlay.cpp \
+    curvesnapshot.cpp \
+    curvestream.cpp \
+    curveexpr.cpp \
+    curveplayer.cpp \
+    curveset.cpp \
+    curveimport.cpp \
+    curveexport.cpp \
+    curvecodegen.cpp \
+    curveframe.cpp \
+    curvehistogram.cpp \
     qcurvesocketwidget.cpp
 
 HEADERS += \
     qcurveeditwidget.h \
     curvelines.h \
+    curvefile.h \
+    curveoverlay.h \
+    curvesnapshot.h \
+    curvestream.h \
+    curveexpr.h \
+    curveplayer.h \
+    curveset.h \
+    curveimport.h \
+    curveexport.h \
+    curvecodegen.h \
+    curveframe.h \
+    curvehistogram.h \
     qcurvesocketwidget.h
 
 # Default rules for deployment.
@@ -0,0 +1,338 @@
+#include "curvecodegen.h"
+#include <QFile>
+#include "curvefile.h"
+
+// Midpoints checked against the curve before a fitted cubic is kept.
+const int FitChecks = 16;
+const int FitDepth = 20;
+const int BreaksPerLine = 6;
+const int DegreesPerLine = 24;
+
+class CodegenPiece
+{
+public:
+    CodegenPiece(float x = 0, int d = 0) :
+        x0(x), x1(x), degree(d), c{0, 0, 0, 0} {}
+
+public:
+    float x0;
+    float x1;
+    int degree;
+    float c[4];
+};
+
+static bool identifier(const QByteArray& name)
+{
+    if (name.isEmpty() || (name.at(0) >= '0' && name.at(0) <= '9'))
+    {
+        return false;
+    }
+    for (char ch : name)
+    {
+        if (!((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_'))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Shortest text that reads back as the same float.
+static QByteArray literal(float value)
+{
+    QByteArray text = QByteArray::number(static_cast<double>(value), 'g', 9);
+    if (text.indexOf('.') < 0 && text.indexOf('e') < 0)
+    {
+        text += ".0";
+    }
+    return text + 'f';
+}
+
+static float horner(const CodegenPiece& piece, float u)
+{
+    return piece.c[0] + u * (piece.c[1] + u * (piece.c[2] + u * piece.c[3]));
+}
+
+static void fitCurve(QVector<CodegenPiece>& pieces, const CurvePoint& point, const CurvePoint& pointd,
+                     float x0, float x1, float tolerance, int depth)
+{
+    // Cubic through four evenly spaced values in u = x - x0, from Newton's
+    // divided differences expanded around u = 0.
+    double u[4];
+    double y[4];
+    for (int k = 0; k < 4; k++)
+    {
+        const float x = k == 3 ? x1 : static_cast<float>(x0 + (static_cast<double>(x1) - x0) * k / 3);
+        u[k] = static_cast<double>(x) - x0;
+        y[k] = CurveLines::segmentValue(x, point, pointd);
+    }
+    CodegenPiece piece(x0, 3);
+    piece.x1 = x1;
+    if (u[0] < u[1] && u[1] < u[2] && u[2] < u[3])
+    {
+        const double d01 = (y[1] - y[0]) / u[1];
+        const double d12 = (y[2] - y[1]) / (u[2] - u[1]);
+        const double d23 = (y[3] - y[2]) / (u[3] - u[2]);
+        const double d012 = (d12 - d01) / u[2];
+        const double d123 = (d23 - d12) / (u[3] - u[1]);
+        const double d0123 = (d123 - d012) / u[3];
+        piece.c[0] = static_cast<float>(y[0]);
+        piece.c[1] = static_cast<float>(d01 - d012 * u[1] + d0123 * u[1] * u[2]);
+        piece.c[2] = static_cast<float>(d012 - d0123 * (u[1] + u[2]));
+        piece.c[3] = static_cast<float>(d0123);
+    }
+    else
+    {
+        piece.degree = 1;
+        piece.c[0] = static_cast<float>(y[0]);
+        piece.c[1] = static_cast<float>((y[3] - y[0]) / u[3]);
+    }
+
+    float worst = 0;
+    for (int k = 0; k < FitChecks; k++)
+    {
+        const float x = static_cast<float>(x0 + (static_cast<double>(x1) - x0) * (k + 0.5) / FitChecks);
+        worst = qMax(worst, qAbs(horner(piece, x - x0) - CurveLines::segmentValue(x, point, pointd)));
+    }
+    const float mid = x0 + (x1 - x0) / 2;
+    if (worst > tolerance && depth < FitDepth && mid > x0 && mid < x1)
+    {
+        fitCurve(pieces, point, pointd, x0, mid, tolerance, depth + 1);
+        fitCurve(pieces, point, pointd, mid, x1, tolerance, depth + 1);
+        return;
+    }
+    pieces.append(piece);
+}
+
+static QVector<CodegenPiece> piecewise(CurveLines& lines, float tolerance)
+{
+    QVector<CodegenPiece> pieces;
+    const int n = lines.pointsSize();
+    if (n < 2)
+    {
+        // Mirrors getValue(): a lone point has its value at its own x.
+        CodegenPiece piece(n ? lines.pointAt(0).pos.x() : 0);
+        piece.c[0] = n ? lines.pointAt(0).pos.y() : 0;
+        pieces.append(piece);
+        return pieces;
+    }
+    for (int i = 1; i < n; i++)
+    {
+        const CurvePoint point = lines.pointAt(i);
+        const CurvePoint pointd = lines.pointAt(i - 1);
+        const float x0 = pointd.pos.x();
+        const float x1 = point.pos.x();
+        if (point.type == CurvePoint::Curve && x1 > x0)
+        {
+            fitCurve(pieces, point, pointd, x0, x1, tolerance, 0);
+            continue;
+        }
+        CodegenPiece piece(x0, point.type == CurvePoint::Line && x1 > x0 ? 1 : 0);
+        piece.x1 = x1;
+        piece.c[0] = CurveLines::segmentValue(x0, point, pointd);
+        if (piece.degree == 1)
+        {
+            piece.c[1] = static_cast<float>((static_cast<double>(point.pos.y()) - pointd.pos.y()) /
+                                            (static_cast<double>(x1) - x0));
+        }
+        pieces.append(piece);
+    }
+    return pieces;
+}
+
+static QByteArray piecewiseBody(CurveLines& lines, float tolerance)
+{
+    const QVector<CodegenPiece> pieces = piecewise(lines, tolerance);
+    QByteArray breaks = "    " + literal(pieces.first().x0) + ',';
+    QByteArray degrees;
+    QByteArray coefficients;
+    for (int k = 0; k < pieces.size(); k++)
+    {
+        const CodegenPiece& piece = pieces.at(k);
+        if (!qIsFinite(piece.x1) || !qIsFinite(piece.c[0]) || !qIsFinite(piece.c[1])
+                || !qIsFinite(piece.c[2]) || !qIsFinite(piece.c[3]))
+        {
+            return QByteArray();
+        }
+        breaks += ((k + 1) % BreaksPerLine ? " " : "\n    ") + literal(piece.x1) + ',';
+        degrees += (k % DegreesPerLine ? " " : "\n    ") + QByteArray::number(piece.degree) + ',';
+        coefficients += "    { " + literal(piece.c[0]) + ", " + literal(piece.c[1]) + ", " +
+                literal(piece.c[2]) + ", " + literal(piece.c[3]) + " },\n";
+    }
+    if (!qIsFinite(pieces.first().x0))
+    {
+        return QByteArray();
+    }
+
+    QByteArray body;
+    body += "constexpr int Count = " + QByteArray::number(pieces.size()) + ";\n\n";
+    body += "// Piece k covers (Breaks[k], Breaks[k + 1]]; the first one Breaks[0] too.\n";
+    body += "constexpr float Breaks[Count + 1] = {\n" + breaks + "\n};\n\n";
+    body += "constexpr unsigned char Degrees[Count] = {" + degrees + "\n};\n\n";
+    body += "// Piece k in u = x - Breaks[k], constant term first.\n";
+    body += "constexpr float Coefficients[Count][4] = {\n" + coefficients + "};\n\n";
+    body +=
+            "template <int Degree>\n"
+            "constexpr float piece(const float* c, float u);\n"
+            "\n"
+            "template <>\n"
+            "constexpr float piece<0>(const float* c, float)\n"
+            "{\n"
+            "    return c[0];\n"
+            "}\n"
+            "\n"
+            "template <>\n"
+            "constexpr float piece<1>(const float* c, float u)\n"
+            "{\n"
+            "    return c[0] + c[1] * u;\n"
+            "}\n"
+            "\n"
+            "template <>\n"
+            "constexpr float piece<3>(const float* c, float u)\n"
+            "{\n"
+            "    return c[0] + u * (c[1] + u * (c[2] + u * c[3]));\n"
+            "}\n"
+            "\n"
+            "// First k in [low, high] with Breaks[k] >= x.\n"
+            "constexpr int find(float x, int low, int high)\n"
+            "{\n"
+            "    return low < high ? (Breaks[(low + high) / 2] < x ? find(x, (low + high) / 2 + 1, high)\n"
+            "                                                      : find(x, low, (low + high) / 2))\n"
+            "                      : low;\n"
+            "}\n"
+            "\n"
+            "constexpr float at(int k, float x)\n"
+            "{\n"
+            "    return Degrees[k] == 0 ? piece<0>(Coefficients[k], x - Breaks[k]) :\n"
+            "           Degrees[k] == 1 ? piece<1>(Coefficients[k], x - Breaks[k]) :\n"
+            "                             piece<3>(Coefficients[k], x - Breaks[k]);\n"
+            "}\n"
+            "\n"
+            "constexpr float value(float x)\n"
+            "{\n"
+            "    return x >= Breaks[0] && x <= Breaks[Count] ? at(find(x, 1, Count) - 1, x) : 0.0f;\n"
+            "}\n";
+    return body;
+}
+
+static QByteArray tableBody(CurveLines& lines, int samples)
+{
+    const int n = lines.pointsSize();
+    float left = n ? lines.pointAt(0).pos.x() : 0;
+    float right = left;
+    for (int i = 1; i < n; i++)
+    {
+        left = qMin(left, lines.pointAt(i).pos.x());
+        right = qMax(right, lines.pointAt(i).pos.x());
+    }
+    QVector<float> xs(samples);
+    for (int k = 0; k < samples; k++)
+    {
+        xs[k] = static_cast<float>(left + (static_cast<double>(right) - left) * k / (samples - 1));
+    }
+    xs[samples - 1] = right;
+    const QVector<float> ys = lines.getValues(xs);
+    const float scale = right > left ? static_cast<float>((samples - 1) / (static_cast<double>(right) - left)) : 0;
+    if (!qIsFinite(left) || !qIsFinite(right) || !qIsFinite(scale))
+    {
+        return QByteArray();
+    }
+
+    QByteArray table;
+    for (int k = 0; k < samples; k++)
+    {
+        if (!qIsFinite(ys.at(k)))
+        {
+            return QByteArray();
+        }
+        table += (k % BreaksPerLine ? " " : "\n    ") + literal(ys.at(k)) + ',';
+    }
+
+    QByteArray body;
+    body += "constexpr int Samples = " + QByteArray::number(samples) + ";\n";
+    body += "constexpr float Left = " + literal(left) + ";\n";
+    body += "constexpr float Right = " + literal(right) + ";\n";
+    body += "// (Samples - 1) / (Right - Left); 0 when the curve has a single x.\n";
+    body += "constexpr float Scale = " + literal(scale) + ";\n\n";
+    body += "constexpr float Table[Samples] = {" + table + "\n};\n\n";
+    body +=
+            "constexpr float lerp(int k, float f)\n"
+            "{\n"
+            "    return Table[k] + (Table[k + 1] - Table[k]) * (f - k);\n"
+            "}\n"
+            "\n"
+            "constexpr float sample(float f)\n"
+            "{\n"
+            "    return lerp(f < Samples - 1 ? static_cast<int>(f) : Samples - 2, f);\n"
+            "}\n"
+            "\n"
+            "constexpr float value(float x)\n"
+            "{\n"
+            "    return x >= Left && x <= Right ? sample((x - Left) * Scale) : 0.0f;\n"
+            "}\n";
+    return body;
+}
+
+QByteArray CurveCodegen::generate(CurveLines &lines, const QString &name, CurveCodegen::Mode mode,
+                                  float tolerance, int samples, QString *error)
+{
+    const QByteArray id = name.toLatin1();
+    QString problem;
+    QByteArray body;
+    if (!identifier(id))
+    {
+        problem = QStringLiteral("not a C++ identifier: ") + name;
+    }
+    else if (mode == Piecewise && !lines.pointsSorted())
+    {
+        problem = QStringLiteral("curve is not sorted by x");
+    }
+    else
+    {
+        body = mode == Table ? tableBody(lines, qMax(2, samples)) : piecewiseBody(lines, tolerance);
+        if (body.isEmpty())
+        {
+            problem = QStringLiteral("curve holds a value that is not finite");
+        }
+    }
+    if (!problem.isEmpty())
+    {
+        if (error)
+        {
+            *error = problem;
+        }
+        return QByteArray();
+    }
+
+    const QByteArray guard = id.toUpper() + "_H";
+    QByteArray header;
+    header += "// Baked from a curve of " + QByteArray::number(lines.pointsSize()) + " points by QCurveWidget.\n";
+    header += "// Generated code: bake the curve again instead of editing it.\n";
+    header += "#ifndef " + guard + "\n#define " + guard + "\n\n";
+    header += "namespace " + id + " {\n\n" + body + "\n} // namespace " + id + "\n\n";
+    header += "#endif // " + guard + "\n";
+    return header;
+}
+
+bool CurveCodegen::write(CurveLines &lines, const QString &path, const QString &name, CurveCodegen::Mode mode,
+                         float tolerance, int samples, QString *error)
+{
+    const QByteArray header = generate(lines, name, mode, tolerance, samples, error);
+    if (header.isEmpty())
+    {
+        return false;
+    }
+    // Written next to the target, so a failed bake keeps the old header.
+    QFile file(path + QStringLiteral(".part"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(header) != header.size())
+    {
+        if (error)
+        {
+            *error = file.errorString();
+        }
+        file.close();
+        file.remove();
+        return false;
+    }
+    return CurveFile::commit(file, path, error);
+}
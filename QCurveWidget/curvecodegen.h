@@ -0,0 +1,39 @@
+#ifndef CURVECODEGEN_H
+#define CURVECODEGEN_H
+
+#include "curvelines.h"
+
+// Bakes a curve into a self-contained C++11 header for targets without an
+// evaluator: no Qt, no heap, no libm. Everything in it is constexpr, so a
+// constant x folds at compile time. The header defines, in a namespace of
+// the given name:
+//   float value(float x)   what CurveLines::getValue(x) returns
+// Piecewise keeps sorted breakpoints with one polynomial in x - Breaks[k]
+// per piece: degree 0 for Default points, 1 for lines, and cubics fitted
+// to within tolerance for curve segments, whose x(t) has no closed-form
+// inverse. value() is a binary search plus a Horner step specialized by
+// degree. Table samples the curve at a fixed resolution and interpolates
+// linearly, which costs O(1) regardless of the curve but blurs steps.
+class CurveCodegen
+{
+public:
+    enum Mode{
+        Piecewise = 0x00,
+        Table = 0x01,
+    };
+
+    enum {
+        DefaultSamples = 256,
+    };
+
+public:
+    // Empty, with error set, when the curve cannot be baked: name is not
+    // an identifier, Piecewise on an unsorted curve, or a value that has no
+    // finite float literal.
+    static QByteArray generate(CurveLines& lines, const QString& name, Mode mode = Piecewise,
+                               float tolerance = 1e-4f, int samples = DefaultSamples, QString* error = nullptr);
+    static bool write(CurveLines& lines, const QString& path, const QString& name, Mode mode = Piecewise,
+                      float tolerance = 1e-4f, int samples = DefaultSamples, QString* error = nullptr);
+};
+
+#endif // CURVECODEGEN_H
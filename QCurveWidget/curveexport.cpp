@@ -0,0 +1,337 @@
+#include "curveexport.h"
+#include "curveframe.h"
+#include "curvesnapshot.h"
+#include "curvefile.h"
+#include <cstring>
+#include <QMap>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QtEndian>
+
+const char SamplesMagic[] = "CRVS";
+const int HeaderSize = 32;
+const int BuffersPerThread = 2;
+
+static void appendUInt32(QByteArray& data, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian(value, bytes);
+    data.append(reinterpret_cast<const char*>(bytes), 4);
+}
+
+static void appendUInt64(QByteArray& data, quint64 value)
+{
+    uchar bytes[8];
+    qToLittleEndian(value, bytes);
+    data.append(reinterpret_cast<const char*>(bytes), 8);
+}
+
+static quint32 floatBits(float value)
+{
+    quint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bitsFloat(quint32 bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Hands out chunk indices to the workers and collects their encoded
+// output for the writer. Workers stall once they run depth chunks ahead of
+// the last one written.
+class ExportPipeline
+{
+public:
+    ExportPipeline(int chunks, int depth) :
+        m_chunks(chunks), m_depth(depth), m_next(0), m_written(0), m_failed(false) {}
+
+public:
+    bool take(int& chunk)
+    {
+        QMutexLocker locker(&m_mutex);
+        while (!m_failed && m_next < m_chunks && m_next >= m_written + m_depth)
+        {
+            m_space.wait(&m_mutex);
+        }
+        if (m_failed || m_next >= m_chunks)
+        {
+            return false;
+        }
+        chunk = m_next++;
+        return true;
+    }
+
+    void put(int chunk, const QByteArray& data)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_done.insert(chunk, data);
+        m_ready.wakeAll();
+    }
+
+    QByteArray next()
+    {
+        QMutexLocker locker(&m_mutex);
+        while (!m_done.contains(m_written))
+        {
+            m_ready.wait(&m_mutex);
+        }
+        return m_done.take(m_written);
+    }
+
+    void written()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_written++;
+        m_space.wakeAll();
+    }
+
+    void fail()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_failed = true;
+        m_space.wakeAll();
+    }
+
+private:
+    QMutex m_mutex;
+    QWaitCondition m_space;
+    QWaitCondition m_ready;
+    QMap<int, QByteArray> m_done;
+    int m_chunks;
+    int m_depth;
+    int m_next;
+    int m_written;
+    bool m_failed;
+};
+
+class ExportWorker : public QRunnable
+{
+public:
+    ExportWorker(ExportPipeline& pipeline, const CurveSnapshot& curve, double left, double right,
+                 qint64 count, CurveExport::Format format) :
+        m_pipeline(pipeline), m_curve(curve), m_left(left), m_right(right),
+        m_count(count), m_format(format) {}
+
+public:
+    void run() override
+    {
+        int chunk;
+        while (m_pipeline.take(chunk))
+        {
+            const qint64 first = static_cast<qint64>(chunk) * CurveExport::ChunkSamples;
+            const int n = static_cast<int>(qMin<qint64>(CurveExport::ChunkSamples, m_count - first));
+            const double span = m_count > 1 ? (m_right - m_left) / (m_count - 1) : 0;
+            m_xs.resize(n);
+            m_ys.resize(n);
+            for (int k = 0; k < n; k++)
+            {
+                m_xs[k] = static_cast<float>(m_left + span * (first + k));
+            }
+            if (first + n == m_count && m_count > 1)
+            {
+                m_xs[n - 1] = static_cast<float>(m_right);
+            }
+            m_curve.getValues(m_xs.constData(), m_ys.data(), n);
+            m_pipeline.put(chunk, CurveExport::encodeChunk(m_ys.constData(), n, m_format));
+        }
+    }
+
+private:
+    ExportPipeline& m_pipeline;
+    const CurveSnapshot& m_curve;
+    double m_left;
+    double m_right;
+    qint64 m_count;
+    CurveExport::Format m_format;
+    QVector<float> m_xs;
+    QVector<float> m_ys;
+};
+
+bool CurveExport::write(CurveLines &lines, const QString &path, float left, float right, qint64 count,
+                        CurveExport::Format format, int threads, QString *error)
+{
+    QFile file(path + QStringLiteral(".part"));
+    if (count < 0 || !file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        if (error)
+        {
+            *error = count < 0 ? QStringLiteral("negative sample count") : file.errorString();
+        }
+        return false;
+    }
+    if (format == Zlib)
+    {
+        QByteArray header(SamplesMagic, 4);
+        appendUInt32(header, Version);
+        appendUInt64(header, static_cast<quint64>(count));
+        appendUInt32(header, floatBits(left));
+        appendUInt32(header, floatBits(right));
+        appendUInt32(header, ChunkSamples);
+        appendUInt32(header, 0);
+        file.write(header);
+    }
+
+    // The workers read a frozen snapshot, so lines may keep changing while
+    // they run.
+    CurveSnapshotPtr curve = lines.publishSnapshot();
+    const int chunks = static_cast<int>((count + ChunkSamples - 1) / ChunkSamples);
+    const int workers = qBound(1, threads > 0 ? threads : QThread::idealThreadCount(), qMax(1, chunks));
+    ExportPipeline pipeline(chunks, workers * BuffersPerThread);
+    QThreadPool pool;
+    pool.setMaxThreadCount(workers);
+    for (int t = 0; t < workers && chunks > 0; t++)
+    {
+        pool.start(new ExportWorker(pipeline, *curve, left, right, count, format));
+    }
+
+    bool ok = true;
+    for (int chunk = 0; chunk < chunks && ok; chunk++)
+    {
+        QByteArray data = pipeline.next();
+        ok = file.write(data) == data.size();
+        pipeline.written();
+    }
+    if (!ok)
+    {
+        pipeline.fail();
+    }
+    pool.waitForDone();
+
+    if (!ok)
+    {
+        if (error)
+        {
+            *error = file.errorString();
+        }
+        file.close();
+        file.remove();
+        return false;
+    }
+    return CurveFile::commit(file, path, error);
+}
+
+bool CurveExport::read(const QString &path, CurveExport::Format format, QVector<float> &values, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        if (error)
+        {
+            *error = file.errorString();
+        }
+        return false;
+    }
+    values.clear();
+    QByteArray data = file.readAll();
+    const uchar* in = reinterpret_cast<const uchar*>(data.constData());
+    if (format == Float32)
+    {
+        values.resize(data.size() / 4);
+        for (int k = 0; k < values.size(); k++)
+        {
+            values[k] = bitsFloat(qFromLittleEndian<quint32>(in + 4 * k));
+        }
+        return true;
+    }
+
+    QString problem;
+    if (data.size() < HeaderSize || !data.startsWith(SamplesMagic))
+    {
+        problem = QStringLiteral("not a sample file");
+    }
+    else if (qFromLittleEndian<quint32>(in + 4) != Version)
+    {
+        problem = QStringLiteral("unsupported version %1").arg(qFromLittleEndian<quint32>(in + 4));
+    }
+    const qint64 count = problem.isEmpty() ? static_cast<qint64>(qFromLittleEndian<quint64>(in + 8)) : 0;
+    int offset = HeaderSize;
+    QVector<float> chunk;
+    while (problem.isEmpty() && offset < data.size())
+    {
+        quint32 size = offset + 4 <= data.size() ? qFromLittleEndian<quint32>(in + offset) : 0;
+        if (!size || size > static_cast<quint32>(data.size() - offset - 4)
+                || !decodeChunk(data.mid(offset + 4, static_cast<int>(size)), chunk))
+        {
+            problem = QStringLiteral("corrupt chunk at byte %1").arg(offset);
+            break;
+        }
+        values += chunk;
+        offset += 4 + static_cast<int>(size);
+    }
+    if (problem.isEmpty() && values.size() != count)
+    {
+        problem = QStringLiteral("truncated sample file");
+    }
+    if (!problem.isEmpty())
+    {
+        if (error)
+        {
+            *error = problem;
+        }
+        values.clear();
+        return false;
+    }
+    return true;
+}
+
+QByteArray CurveExport::encodeChunk(const float *values, int n, CurveExport::Format format)
+{
+    if (format == Float32)
+    {
+        QByteArray data(n * 4, Qt::Uninitialized);
+        uchar* out = reinterpret_cast<uchar*>(data.data());
+        for (int k = 0; k < n; k++)
+        {
+            qToLittleEndian(floatBits(values[k]), out + 4 * k);
+        }
+        return data;
+    }
+
+    // Same transform as the delta frames: bit pattern differences of
+    // neighbouring samples, split into byte planes, then zlib.
+    QVector<quint32> deltas(n);
+    quint32 previous = 0;
+    for (int k = 0; k < n; k++)
+    {
+        quint32 bits = floatBits(values[k]);
+        deltas[k] = bits - previous;
+        previous = bits;
+    }
+    QByteArray planes(n * 4, Qt::Uninitialized);
+    CurveFrame::writePlanes(planes.data(), deltas.constData(), n);
+    QByteArray payload = qCompress(planes, 1);
+
+    QByteArray data;
+    data.reserve(4 + payload.size());
+    appendUInt32(data, static_cast<quint32>(payload.size()));
+    data.append(payload);
+    return data;
+}
+
+bool CurveExport::decodeChunk(const QByteArray &chunk, QVector<float> &values)
+{
+    // chunk is the zlib payload of one chunk, without its size prefix.
+    QByteArray planes = qUncompress(chunk);
+    if (planes.isEmpty() || planes.size() % 4)
+    {
+        return false;
+    }
+    const int n = planes.size() / 4;
+    QVector<quint32> deltas(n);
+    CurveFrame::readPlanes(planes.constData(), deltas.data(), n);
+    values.resize(n);
+    quint32 previous = 0;
+    for (int k = 0; k < n; k++)
+    {
+        previous += deltas[k];
+        values[k] = bitsFloat(previous);
+    }
+    return true;
+}
@@ -0,0 +1,33 @@
+#ifndef CURVEEXPORT_H
+#define CURVEEXPORT_H
+
+#include <QFile>
+#include "curvelines.h"
+
+// Dense uniform sampling of a curve straight to disk. The x range is cut
+// into chunks that worker threads evaluate and encode; the calling thread
+// writes them in order, with at most two chunks per worker in flight, so
+// memory stays bounded whatever the sample count.
+class CurveExport
+{
+public:
+    enum Format{
+        Float32 = 0x00,
+        Zlib = 0x01,
+    };
+
+    enum {
+        Version = 1,
+        ChunkSamples = 1 << 20,
+    };
+
+public:
+    static bool write(CurveLines& lines, const QString& path, float left, float right, qint64 count,
+                      Format format, int threads = 0, QString* error = nullptr);
+    static bool read(const QString& path, Format format, QVector<float>& values, QString* error = nullptr);
+
+    static QByteArray encodeChunk(const float* values, int n, Format format);
+    static bool decodeChunk(const QByteArray& chunk, QVector<float>& values);
+};
+
+#endif // CURVEEXPORT_H
@@ -0,0 +1,305 @@
+#include "curveexpr.h"
+#include "curvesnapshot.h"
+#include <algorithm>
+#include <cstring>
+
+CurveExpr::CurveExpr(CurveExpr::Operator op) :
+    m_op(op), m_p0(0), m_p1(0), m_version(0), m_versionA(0), m_versionB(0), m_cached(false), m_cacheVersion(0)
+{
+
+}
+
+CurveExprPtr CurveExpr::node(CurveExpr::Operator op, const CurveExprPtr &a, const CurveExprPtr &b, float p0, float p1)
+{
+    CurveExprPtr expr(new CurveExpr(op));
+    expr->m_a = a;
+    expr->m_b = b;
+    expr->m_p0 = p0;
+    expr->m_p1 = p1;
+    return expr;
+}
+
+CurveExprPtr CurveExpr::curve(CurveLines *lines)
+{
+    CurveExprPtr expr(new CurveExpr(Expr_Curve));
+    expr->m_lines = lines;
+    return expr;
+}
+
+CurveExprPtr CurveExpr::constant(float value)
+{
+    return node(Expr_Constant, CurveExprPtr(), CurveExprPtr(), value);
+}
+
+CurveExprPtr CurveExpr::add(const CurveExprPtr &a, const CurveExprPtr &b)
+{
+    return node(Expr_Add, a, b);
+}
+
+CurveExprPtr CurveExpr::subtract(const CurveExprPtr &a, const CurveExprPtr &b)
+{
+    return node(Expr_Subtract, a, b);
+}
+
+CurveExprPtr CurveExpr::multiply(const CurveExprPtr &a, const CurveExprPtr &b)
+{
+    return node(Expr_Multiply, a, b);
+}
+
+CurveExprPtr CurveExpr::minimum(const CurveExprPtr &a, const CurveExprPtr &b)
+{
+    return node(Expr_Min, a, b);
+}
+
+CurveExprPtr CurveExpr::maximum(const CurveExprPtr &a, const CurveExprPtr &b)
+{
+    return node(Expr_Max, a, b);
+}
+
+CurveExprPtr CurveExpr::clamp(const CurveExprPtr &a, float low, float high)
+{
+    return node(Expr_Clamp, a, CurveExprPtr(), qMin(low, high), qMax(low, high));
+}
+
+CurveExprPtr CurveExpr::scale(const CurveExprPtr &a, float gain, float offset)
+{
+    return node(Expr_Scale, a, CurveExprPtr(), gain, offset);
+}
+
+CurveExprPtr CurveExpr::shift(const CurveExprPtr &a, float delay, float rate)
+{
+    return node(Expr_Shift, a, CurveExprPtr(), delay, rate);
+}
+
+CurveExpr::Operator CurveExpr::op() const
+{
+    return m_op;
+}
+
+quint64 CurveExpr::version()
+{
+    // Compared as a pair rather than summed: a leaf that goes back to 0
+    // while another one moves on must not land on a sum seen before.
+    quint64 a = 0;
+    quint64 b = 0;
+    if (m_op == Expr_Curve)
+    {
+        m_snapshot = m_lines ? m_lines->publishSnapshot() : CurveSnapshotPtr();
+        a = m_snapshot ? m_snapshot->version() : 0;
+    }
+    else
+    {
+        a = m_a ? m_a->version() : 0;
+        b = m_b ? m_b->version() : 0;
+    }
+    if (m_version == 0 || a != m_versionA || b != m_versionB)
+    {
+        m_versionA = a;
+        m_versionB = b;
+        m_version++;
+    }
+    return m_version;
+}
+
+bool CurveExpr::domain(float &from, float &to)
+{
+    switch (m_op)
+    {
+    case Expr_Curve:
+    {
+        CurveSnapshotPtr curve = m_lines ? m_lines->publishSnapshot() : CurveSnapshotPtr();
+        if (!curve || !curve->size())
+        {
+            return false;
+        }
+        from = qMin(curve->pointX(0), curve->pointX(curve->size() - 1));
+        to = qMax(curve->pointX(0), curve->pointX(curve->size() - 1));
+        return true;
+    }
+    case Expr_Constant:
+        return false;
+    case Expr_Clamp:
+    case Expr_Scale:
+        return m_a->domain(from, to);
+    case Expr_Shift:
+    {
+        if (m_p1 == 0 || !m_a->domain(from, to))
+        {
+            return false;
+        }
+        float x0 = from / m_p1 + m_p0;
+        float x1 = to / m_p1 + m_p0;
+        from = qMin(x0, x1);
+        to = qMax(x0, x1);
+        return true;
+    }
+    default:
+    {
+        float from2;
+        float to2;
+        bool a = m_a->domain(from, to);
+        bool b = m_b->domain(from2, to2);
+        if (a && b)
+        {
+            from = qMin(from, from2);
+            to = qMax(to, to2);
+        }
+        else if (b)
+        {
+            from = from2;
+            to = to2;
+        }
+        return a || b;
+    }
+    }
+}
+
+float CurveExpr::value(float x)
+{
+    version();
+    return at(x);
+}
+
+QVector<float> CurveExpr::evaluate(const QVector<float> &xs)
+{
+    QVector<float> ys(xs.size());
+    evaluate(xs.constData(), ys.data(), xs.size());
+    return ys;
+}
+
+void CurveExpr::evaluate(const float *xs, float *ys, int count)
+{
+    version();
+    run(xs, ys, count);
+}
+
+void CurveExpr::run(const float *xs, float *ys, int count)
+{
+    if (m_cached && m_cacheVersion == m_version && m_cacheXs.size() == count
+            && std::equal(xs, xs + count, m_cacheXs.constData()))
+    {
+        memcpy(ys, m_cacheYs.constData(), sizeof(float) * count);
+        return;
+    }
+    compute(xs, ys, count);
+    m_cacheXs.resize(count);
+    m_cacheYs.resize(count);
+    memcpy(m_cacheXs.data(), xs, sizeof(float) * count);
+    memcpy(m_cacheYs.data(), ys, sizeof(float) * count);
+    m_cacheVersion = m_version;
+    m_cached = true;
+}
+
+void CurveExpr::compute(const float *xs, float *ys, int count)
+{
+    switch (m_op)
+    {
+    case Expr_Curve:
+        if (m_snapshot)
+        {
+            m_snapshot->getValues(xs, ys, count);
+        }
+        else
+        {
+            std::fill(ys, ys + count, 0.0f);
+        }
+        return;
+    case Expr_Constant:
+        std::fill(ys, ys + count, m_p0);
+        return;
+    case Expr_Clamp:
+        m_a->run(xs, ys, count);
+        for (int k = 0; k < count; k++)
+        {
+            ys[k] = qBound(m_p0, ys[k], m_p1);
+        }
+        return;
+    case Expr_Scale:
+        m_a->run(xs, ys, count);
+        for (int k = 0; k < count; k++)
+        {
+            ys[k] = ys[k] * m_p0 + m_p1;
+        }
+        return;
+    case Expr_Shift:
+    {
+        QVector<float> shifted(count);
+        for (int k = 0; k < count; k++)
+        {
+            shifted[k] = m_p1 * (xs[k] - m_p0);
+        }
+        m_a->run(shifted.constData(), ys, count);
+        return;
+    }
+    default:
+        break;
+    }
+
+    QVector<float> other(count);
+    m_a->run(xs, ys, count);
+    m_b->run(xs, other.data(), count);
+    const float* b = other.constData();
+    switch (m_op)
+    {
+    case Expr_Add:
+        for (int k = 0; k < count; k++)
+        {
+            ys[k] += b[k];
+        }
+        break;
+    case Expr_Subtract:
+        for (int k = 0; k < count; k++)
+        {
+            ys[k] -= b[k];
+        }
+        break;
+    case Expr_Multiply:
+        for (int k = 0; k < count; k++)
+        {
+            ys[k] *= b[k];
+        }
+        break;
+    case Expr_Min:
+        for (int k = 0; k < count; k++)
+        {
+            ys[k] = qMin(ys[k], b[k]);
+        }
+        break;
+    case Expr_Max:
+        for (int k = 0; k < count; k++)
+        {
+            ys[k] = qMax(ys[k], b[k]);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+float CurveExpr::at(float x)
+{
+    switch (m_op)
+    {
+    case Expr_Curve:
+        return m_snapshot ? m_snapshot->getValue(x) : 0;
+    case Expr_Constant:
+        return m_p0;
+    case Expr_Add:
+        return m_a->at(x) + m_b->at(x);
+    case Expr_Subtract:
+        return m_a->at(x) - m_b->at(x);
+    case Expr_Multiply:
+        return m_a->at(x) * m_b->at(x);
+    case Expr_Min:
+        return qMin(m_a->at(x), m_b->at(x));
+    case Expr_Max:
+        return qMax(m_a->at(x), m_b->at(x));
+    case Expr_Clamp:
+        return qBound(m_p0, m_a->at(x), m_p1);
+    case Expr_Scale:
+        return m_a->at(x) * m_p0 + m_p1;
+    case Expr_Shift:
+        return m_a->at(m_p1 * (x - m_p0));
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+#ifndef CURVEEXPR_H
+#define CURVEEXPR_H
+
+#include <memory>
+#include <QPointer>
+#include "curvelines.h"
+
+class CurveExpr;
+
+typedef std::shared_ptr<CurveExpr> CurveExprPtr;
+
+// A curve defined over other curves: leaves are CurveLines, the nodes above
+// them combine values point by point or move the x axis. Nothing is
+// materialized; evaluate() samples the leaves through their snapshots in
+// one batch per node. Every node keeps its last batch and hands it back
+// as long as the x's are the same and no leaf below it has published a
+// new version. Evaluate from the thread that owns the leaves.
+class CurveExpr
+{
+public:
+    enum Operator{
+        Expr_Curve = 0x00,
+        Expr_Constant = 0x01,
+        Expr_Add = 0x02,
+        Expr_Subtract = 0x03,
+        Expr_Multiply = 0x04,
+        Expr_Min = 0x05,
+        Expr_Max = 0x06,
+        Expr_Clamp = 0x07,
+        Expr_Scale = 0x08,
+        Expr_Shift = 0x09,
+    };
+
+public:
+    static CurveExprPtr curve(CurveLines* lines);
+    static CurveExprPtr constant(float value);
+    static CurveExprPtr add(const CurveExprPtr& a, const CurveExprPtr& b);
+    static CurveExprPtr subtract(const CurveExprPtr& a, const CurveExprPtr& b);
+    static CurveExprPtr multiply(const CurveExprPtr& a, const CurveExprPtr& b);
+    static CurveExprPtr minimum(const CurveExprPtr& a, const CurveExprPtr& b);
+    static CurveExprPtr maximum(const CurveExprPtr& a, const CurveExprPtr& b);
+    static CurveExprPtr clamp(const CurveExprPtr& a, float low, float high);
+    // a(x) * gain + offset
+    static CurveExprPtr scale(const CurveExprPtr& a, float gain, float offset = 0);
+    // a(rate * (x - delay))
+    static CurveExprPtr shift(const CurveExprPtr& a, float delay, float rate = 1);
+
+public:
+    Operator op() const;
+
+    // Counts this node's changes: it grows by one whenever a leaf below
+    // publishes a new snapshot or goes away, and never comes back.
+    quint64 version();
+    // Union of the leaves' extents mapped through the x operators; false
+    // when nothing below is bounded.
+    bool domain(float& from, float& to);
+
+    float value(float x);
+    QVector<float> evaluate(const QVector<float>& xs);
+    void evaluate(const float* xs, float* ys, int count);
+
+private:
+    explicit CurveExpr(Operator op);
+    static CurveExprPtr node(Operator op, const CurveExprPtr& a, const CurveExprPtr& b,
+                             float p0 = 0, float p1 = 0);
+    void run(const float* xs, float* ys, int count);
+    void compute(const float* xs, float* ys, int count);
+    float at(float x);
+
+private:
+    Operator m_op;
+    QPointer<CurveLines> m_lines;
+    CurveExprPtr m_a;
+    CurveExprPtr m_b;
+    float m_p0;
+    float m_p1;
+    CurveSnapshotPtr m_snapshot;
+    quint64 m_version;
+    // What m_version was last counted against: the children's versions,
+    // or the snapshot version of a leaf, 0 once it is gone.
+    quint64 m_versionA;
+    quint64 m_versionB;
+    bool m_cached;
+    quint64 m_cacheVersion;
+    QVector<float> m_cacheXs;
+    QVector<float> m_cacheYs;
+};
+
+#endif // CURVEEXPR_H
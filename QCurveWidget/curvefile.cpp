@@ -0,0 +1,393 @@
+#include "curvefile.h"
+#include <cstring>
+#include <climits>
+#include <QDir>
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <qt_windows.h>
+#else
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+const char FileMagic[] = "CRVM";
+const quint32 ByteOrderMark = 0x01020304;
+const quint32 SortedFlag = 0x01;
+const qint64 ArrayAlign = 64;
+
+struct CurveFileHeader
+{
+    char magic[4];
+    quint32 version;
+    quint32 headerSize;
+    quint32 byteOrder;
+    quint64 count;
+    quint64 segments;
+    quint32 pageSize;
+    quint32 pageCount;
+    quint32 flags;
+    float min;
+    float max;
+    quint32 reserved0;
+    double sum;
+    quint64 pagesOffset;
+    quint64 typesOffset;
+    quint64 xOffset;
+    quint64 yOffset;
+    quint64 x2Offset;
+    quint64 y2Offset;
+    quint64 fileSize;
+    quint64 reserved1;
+};
+
+static_assert(sizeof(CurveFileHeader) == 128, "CurveFileHeader layout");
+static_assert(sizeof(CurveFilePage) == 48, "CurveFilePage layout");
+
+static qint64 alignOffset(qint64 offset)
+{
+    return (offset + ArrayAlign - 1) & ~(ArrayAlign - 1);
+}
+
+static void layoutHeader(CurveFileHeader& header, int count)
+{
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FileMagic, 4);
+    header.version = CurveFile::Version;
+    header.headerSize = sizeof(CurveFileHeader);
+    header.byteOrder = ByteOrderMark;
+    header.count = static_cast<quint64>(count);
+    header.segments = count > 1 ? static_cast<quint64>(count - 1) : 0;
+    header.pageSize = CurveFile::PageSize;
+    header.pageCount = static_cast<quint32>((count + CurveFile::PageSize - 1) / CurveFile::PageSize);
+
+    qint64 n = count;
+    header.pagesOffset = sizeof(CurveFileHeader);
+    header.typesOffset = alignOffset(header.pagesOffset + header.pageCount * sizeof(CurveFilePage));
+    header.xOffset = alignOffset(header.typesOffset + n);
+    header.yOffset = alignOffset(header.xOffset + n * 4);
+    header.x2Offset = alignOffset(header.yOffset + n * 4);
+    header.y2Offset = alignOffset(header.x2Offset + n * 4);
+    header.fileSize = header.y2Offset + n * 4;
+}
+
+static bool syncFile(QFile& file)
+{
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return fsync(file.handle()) == 0;
+#endif
+}
+
+// Replaces to with from in one step: a crash leaves one file or the other.
+static bool replaceFile(const QString& from, const QString& to)
+{
+#ifdef Q_OS_WIN
+    return MoveFileExW(reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(from).utf16()),
+                       reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(to).utf16()),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    return ::rename(QFile::encodeName(from).constData(), QFile::encodeName(to).constData()) == 0;
+#endif
+}
+
+CurveFile::CurveFile() :
+    m_map(nullptr), m_count(0), m_sorted(true), m_min(0), m_max(0), m_sum(0),
+    m_pages(nullptr), m_pageCount(0),
+    m_types(nullptr), m_x(nullptr), m_y(nullptr), m_x2(nullptr), m_y2(nullptr)
+{
+
+}
+
+CurveFile::~CurveFile()
+{
+    close();
+}
+
+bool CurveFile::open(const QString &path)
+{
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        m_error = m_file.errorString();
+        return false;
+    }
+
+    const qint64 size = m_file.size();
+    CurveFileHeader header;
+    if (size < static_cast<qint64>(sizeof(header))
+            || m_file.read(reinterpret_cast<char*>(&header), sizeof(header)) != sizeof(header))
+    {
+        m_error = QStringLiteral("truncated header");
+        close();
+        return false;
+    }
+
+    CurveFileHeader expected;
+    layoutHeader(expected, header.count <= INT_MAX ? static_cast<int>(header.count) : 0);
+    if (memcmp(header.magic, FileMagic, 4) != 0 || header.headerSize != sizeof(header))
+    {
+        m_error = QStringLiteral("not a curve file");
+    }
+    else if (header.version != Version)
+    {
+        m_error = QStringLiteral("unsupported version %1").arg(header.version);
+    }
+    else if (header.byteOrder != ByteOrderMark)
+    {
+        m_error = QStringLiteral("foreign byte order");
+    }
+    else if (header.count > INT_MAX || header.pageSize != PageSize
+             || header.pageCount != expected.pageCount
+             || header.pagesOffset != expected.pagesOffset || header.typesOffset != expected.typesOffset
+             || header.xOffset != expected.xOffset || header.yOffset != expected.yOffset
+             || header.x2Offset != expected.x2Offset || header.y2Offset != expected.y2Offset
+             || header.fileSize != expected.fileSize || static_cast<qint64>(header.fileSize) > size)
+    {
+        m_error = QStringLiteral("corrupt layout");
+    }
+    if (!m_error.isEmpty())
+    {
+        close();
+        return false;
+    }
+
+    m_map = m_file.map(0, static_cast<qint64>(header.fileSize));
+    if (!m_map)
+    {
+        m_error = m_file.errorString();
+        close();
+        return false;
+    }
+    m_count = static_cast<int>(header.count);
+    m_sorted = header.flags & SortedFlag;
+    m_min = header.min;
+    m_max = header.max;
+    m_sum = header.sum;
+    m_pageCount = static_cast<int>(header.pageCount);
+    m_pages = reinterpret_cast<const CurveFilePage*>(m_map + header.pagesOffset);
+    m_types = m_map + header.typesOffset;
+    m_x = reinterpret_cast<const float*>(m_map + header.xOffset);
+    m_y = reinterpret_cast<const float*>(m_map + header.yOffset);
+    m_x2 = reinterpret_cast<const float*>(m_map + header.x2Offset);
+    m_y2 = reinterpret_cast<const float*>(m_map + header.y2Offset);
+    return true;
+}
+
+void CurveFile::close()
+{
+    if (m_map)
+    {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    m_file.close();
+    m_error.clear();
+    m_count = 0;
+    m_sorted = true;
+    m_min = 0;
+    m_max = 0;
+    m_sum = 0;
+    m_pages = nullptr;
+    m_pageCount = 0;
+    m_types = nullptr;
+    m_x = m_y = m_x2 = m_y2 = nullptr;
+}
+
+bool CurveFile::isOpen() const
+{
+    return m_map != nullptr;
+}
+
+QString CurveFile::fileName() const
+{
+    return m_file.fileName();
+}
+
+QString CurveFile::errorString() const
+{
+    return m_error;
+}
+
+int CurveFile::count() const
+{
+    return m_count;
+}
+
+bool CurveFile::sorted() const
+{
+    return m_sorted;
+}
+
+float CurveFile::minValue() const
+{
+    return m_min;
+}
+
+float CurveFile::maxValue() const
+{
+    return m_max;
+}
+
+double CurveFile::sum() const
+{
+    return m_sum;
+}
+
+int CurveFile::pageCount() const
+{
+    return m_pageCount;
+}
+
+const CurveFilePage &CurveFile::page(int p) const
+{
+    return m_pages[p];
+}
+
+CurvePoint CurveFile::point(int i) const
+{
+    CurvePoint point(m_x[i], m_y[i], CurvePoint::PointType(m_types[i]));
+    point.pos2 = QVector2D(m_x2[i], m_y2[i]);
+    return point;
+}
+
+float CurveFile::x(int i) const
+{
+    return m_x[i];
+}
+
+float CurveFile::y(int i) const
+{
+    return m_y[i];
+}
+
+CurveFilePage CurveFile::summarize(const CurvePoint *points, int count)
+{
+    CurveFilePage page;
+    memset(&page, 0, sizeof(page));
+    page.sorted = 1;
+    if (count <= 0)
+    {
+        return page;
+    }
+    page.left = page.low = page.minY = FLT_MAX;
+    page.right = page.high = page.maxY = -FLT_MAX;
+    page.firstX = points[0].pos.x();
+    page.lastX = points[count - 1].pos.x();
+    for (int i = 0; i < count; i++)
+    {
+        const CurvePoint& point = points[i];
+        page.left = qMin(page.left, qMin(point.pos.x(), point.pos2.x()));
+        page.right = qMax(page.right, qMax(point.pos.x(), point.pos2.x()));
+        page.low = qMin(page.low, qMin(point.pos.y(), point.pos2.y()));
+        page.high = qMax(page.high, qMax(point.pos.y(), point.pos2.y()));
+        page.minY = qMin(page.minY, point.pos.y());
+        page.maxY = qMax(page.maxY, point.pos.y());
+        page.sum += static_cast<double>(point.pos.y());
+        if (i > 0 && point.pos.x() < points[i-1].pos.x())
+        {
+            page.sorted = 0;
+        }
+    }
+    return page;
+}
+
+bool CurveFile::write(const QString &path, int count, const CurveFile::Reader &reader, QString *error)
+{
+    CurveFileHeader header;
+    layoutHeader(header, count);
+
+    // Written next to the target and renamed over it at the end, so a
+    // mapping of the old file stays valid while the new one is built.
+    QFile file(path + QStringLiteral(".part"));
+    uchar *map = nullptr;
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate)
+            || !file.resize(static_cast<qint64>(header.fileSize))
+            || !(map = file.map(0, static_cast<qint64>(header.fileSize))))
+    {
+        if (error)
+        {
+            *error = file.errorString();
+        }
+        file.remove();
+        return false;
+    }
+
+    CurveFilePage *pages = reinterpret_cast<CurveFilePage*>(map + header.pagesOffset);
+    uchar *types = map + header.typesOffset;
+    float *xs = reinterpret_cast<float*>(map + header.xOffset);
+    float *ys = reinterpret_cast<float*>(map + header.yOffset);
+    float *x2s = reinterpret_cast<float*>(map + header.x2Offset);
+    float *y2s = reinterpret_cast<float*>(map + header.y2Offset);
+
+    bool sorted = true;
+    header.min = FLT_MAX;
+    header.max = -FLT_MAX;
+    QVector<CurvePoint> chunk(PageSize);
+    for (int p = 0; p < static_cast<int>(header.pageCount); p++)
+    {
+        const int first = p * PageSize;
+        const int n = qMin(static_cast<int>(PageSize), count - first);
+        reader(first, n, chunk.data());
+        for (int i = 0; i < n; i++)
+        {
+            const CurvePoint& point = chunk[i];
+            types[first + i] = static_cast<uchar>(point.type);
+            xs[first + i] = point.pos.x();
+            ys[first + i] = point.pos.y();
+            x2s[first + i] = point.pos2.x();
+            y2s[first + i] = point.pos2.y();
+        }
+        pages[p] = summarize(chunk.constData(), n);
+        sorted = sorted && pages[p].sorted && (p == 0 || pages[p - 1].lastX <= pages[p].firstX);
+        header.min = qMin(header.min, pages[p].minY);
+        header.max = qMax(header.max, pages[p].maxY);
+        header.sum += pages[p].sum;
+    }
+    if (!count)
+    {
+        header.min = header.max = 0;
+    }
+    header.flags = sorted ? SortedFlag : 0;
+    memcpy(map, &header, sizeof(header));
+
+    // The new content has to be on disk before the rename makes it the
+    // target, or a crash in between could leave a truncated file there.
+    file.unmap(map);
+    return commit(file, path, error);
+}
+
+bool CurveFile::commit(QFile &file, const QString &path, QString *error)
+{
+    bool synced = file.error() == QFileDevice::NoError && file.flush() && syncFile(file);
+    file.close();
+    if (!synced || file.error() != QFileDevice::NoError)
+    {
+        if (error)
+        {
+            *error = file.error() != QFileDevice::NoError ? file.errorString()
+                                                           : QStringLiteral("Cannot sync %1").arg(file.fileName());
+        }
+        file.remove();
+        return false;
+    }
+    if (!replaceFile(file.fileName(), path))
+    {
+        if (error)
+        {
+            *error = QStringLiteral("Cannot replace %1").arg(path);
+        }
+        file.remove();
+        return false;
+    }
+    return true;
+}
+
+bool CurveFile::write(const QString &path, const QVector<CurvePoint> &points, QString *error)
+{
+    return write(path, points.size(), [&](int first, int count, CurvePoint *out)
+    {
+        std::copy(points.constBegin() + first, points.constBegin() + first + count, out);
+    }, error);
+}
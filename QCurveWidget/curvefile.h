@@ -0,0 +1,90 @@
+#ifndef CURVEFILE_H
+#define CURVEFILE_H
+
+#include <functional>
+#include <QFile>
+#include <QRectF>
+#include "curvelines.h"
+
+// Per page summary stored next to the point arrays, so a mapped curve knows
+// its statistics and where its points lie without reading them.
+struct CurveFilePage
+{
+    float left;
+    float right;
+    float low;
+    float high;
+    float minY;
+    float maxY;
+    float firstX;
+    float lastX;
+    double sum;
+    quint32 sorted;
+    quint32 reserved;
+};
+
+// Versioned binary curve file laid out for mmap: a fixed header, the page
+// table, then the point fields as separate 64 byte aligned arrays (types,
+// x, y, x2, y2) in host little-endian order.
+class CurveFile
+{
+public:
+    enum {
+        Version = 1,
+        PageSize = 4096,
+    };
+
+    // Called with consecutive runs of at most PageSize points to fill.
+    typedef std::function<void(int first, int count, CurvePoint *points)> Reader;
+
+public:
+    CurveFile();
+    ~CurveFile();
+
+public:
+    bool open(const QString& path);
+    void close();
+    bool isOpen() const;
+    QString fileName() const;
+    QString errorString() const;
+
+    int count() const;
+    bool sorted() const;
+    float minValue() const;
+    float maxValue() const;
+    double sum() const;
+
+    int pageCount() const;
+    const CurveFilePage& page(int p) const;
+
+    CurvePoint point(int i) const;
+    float x(int i) const;
+    float y(int i) const;
+
+    static CurveFilePage summarize(const CurvePoint *points, int count);
+    static bool write(const QString& path, int count, const Reader& reader, QString *error = nullptr);
+    static bool write(const QString& path, const QVector<CurvePoint>& points, QString *error = nullptr);
+    // Finishes a file written next to path: flushes and syncs it, closes
+    // it and moves it over path in one step, so a crash leaves either the
+    // old file or the new one. On failure the file is removed.
+    static bool commit(QFile& file, const QString& path, QString *error = nullptr);
+
+private:
+    QFile m_file;
+    uchar *m_map;
+    QString m_error;
+    int m_count;
+    bool m_sorted;
+    float m_min;
+    float m_max;
+    double m_sum;
+    const CurveFilePage *m_pages;
+    int m_pageCount;
+    const uchar *m_types;
+    const float *m_x;
+    const float *m_y;
+    const float *m_x2;
+    const float *m_y2;
+};
+
+#endif // CURVEFILE_H
@@ -0,0 +1,343 @@
+#include "curveframe.h"
+#include <cstring>
+#include <QJsonDocument>
+#include <QtEndian>
+
+const char ZlibMagic[] = "CRVZ";
+const char DeltaMagic[] = "CRVD";
+const int MagicSize = 4;
+const int PlaneCount = 4;
+
+static quint32 floatBits(float value)
+{
+    quint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bitsFloat(quint32 bits)
+{
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void appendUInt32(QByteArray& data, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian(value, bytes);
+    data.append(reinterpret_cast<const char*>(bytes), 4);
+}
+
+static quint32 readUInt32(const char* data)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(data));
+}
+
+// Byte planes put the mostly-zero high bytes of small deltas next to each
+// other, which is what lets zlib shrink them.
+void CurveFrame::writePlanes(char *out, const quint32 *values, int n)
+{
+    for (int k = 0; k < PlaneCount; k++)
+    {
+        char* plane = out + k * n;
+        for (int i = 0; i < n; i++)
+        {
+            plane[i] = static_cast<char>((values[i] >> (8 * k)) & 0xff);
+        }
+    }
+}
+
+void CurveFrame::readPlanes(const char *in, quint32 *values, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        values[i] = 0;
+    }
+    for (int k = 0; k < PlaneCount; k++)
+    {
+        const uchar* plane = reinterpret_cast<const uchar*>(in + k * n);
+        for (int i = 0; i < n; i++)
+        {
+            values[i] |= static_cast<quint32>(plane[i]) << (8 * k);
+        }
+    }
+}
+
+QByteArray CurveFrame::encode(const QJsonObject &message, const QVector<CurvePoint> &points,
+                              CurveFrame::Encoding encoding, int threshold)
+{
+    if (encoding == Delta)
+    {
+        QByteArray payload = encodeDelta(message, points);
+        QByteArray frame(DeltaMagic, MagicSize);
+        if (payload.size() >= threshold)
+        {
+            frame.append('1');
+            frame.append(qCompress(payload));
+        }
+        else
+        {
+            frame.append('0');
+            frame.append(payload);
+        }
+        return frame;
+    }
+
+    QJsonObject socketData = message;
+    socketData["points"] = toJson(points);
+    QByteArray json = QJsonDocument(socketData).toJson(QJsonDocument::Compact);
+    if (encoding == Zlib && json.size() >= threshold)
+    {
+        QByteArray frame(ZlibMagic, MagicSize);
+        frame.append(qCompress(json));
+        return frame;
+    }
+    return json;
+}
+
+bool CurveFrame::decode(const QByteArray &frame, QJsonObject &message, QVector<CurvePoint> &points)
+{
+    QByteArray json;
+    if (frame.startsWith(DeltaMagic))
+    {
+        if (frame.size() <= MagicSize)
+        {
+            return false;
+        }
+        QByteArray payload = frame.mid(MagicSize + 1);
+        if (frame.at(MagicSize) == '1')
+        {
+            payload = qUncompress(payload);
+        }
+        return decodeDelta(payload, message, points);
+    }
+    else if (frame.startsWith(ZlibMagic))
+    {
+        json = qUncompress(frame.mid(MagicSize));
+    }
+    else
+    {
+        json = frame;
+    }
+
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(json, &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject())
+    {
+        return false;
+    }
+    message = doc.object();
+    points = fromJson(message["points"].toArray());
+    message.remove("points");
+    return true;
+}
+
+QJsonArray CurveFrame::toJson(const QVector<CurvePoint> &points)
+{
+    QJsonArray pointsData;
+    for(const CurvePoint& point : points)
+    {
+        QJsonObject object;
+        object["type"] = point.type;
+        QJsonArray array;
+        array.append((double)point.pos.x());
+        array.append((double)point.pos.y());
+        object["pos"] = array;
+        QJsonArray array2;
+        array2.append((double)point.pos2.x());
+        array2.append((double)point.pos2.y());
+        object["pos2"] = array2;
+        pointsData.append(object);
+    }
+    return pointsData;
+}
+
+QVector<CurvePoint> CurveFrame::fromJson(const QJsonArray &array)
+{
+    QVector<CurvePoint> points;
+    points.reserve(array.size());
+    for(const QJsonValue& item : array)
+    {
+        CurvePoint point;
+        QJsonObject object = item.toObject();
+        point.type = CurvePoint::PointType(object["type"].toInt());
+        QJsonArray pos = object["pos"].toArray();
+        point.pos.setX((float)pos[0].toDouble());
+        point.pos.setY((float)pos[1].toDouble());
+        QJsonArray pos2 = object["pos2"].toArray();
+        point.pos2.setX((float)pos2[0].toDouble());
+        point.pos2.setY((float)pos2[1].toDouble());
+        points.append(point);
+    }
+    return points;
+}
+
+QString CurveFrame::encodingName(CurveFrame::Encoding encoding)
+{
+    switch (encoding) {
+    case Zlib:
+        return QStringLiteral("zlib");
+    case Delta:
+        return QStringLiteral("delta");
+    default:
+        return QStringLiteral("json");
+    }
+}
+
+bool CurveFrame::encodingFromName(const QString &name, CurveFrame::Encoding &encoding)
+{
+    if (name == QStringLiteral("json"))
+    {
+        encoding = Json;
+    }
+    else if (name == QStringLiteral("zlib"))
+    {
+        encoding = Zlib;
+    }
+    else if (name == QStringLiteral("delta"))
+    {
+        encoding = Delta;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+QJsonArray CurveFrame::encodingNames()
+{
+    QJsonArray names;
+    names.append(encodingName(Delta));
+    names.append(encodingName(Zlib));
+    names.append(encodingName(Json));
+    return names;
+}
+
+QByteArray CurveFrame::encodeDelta(const QJsonObject &message, const QVector<CurvePoint> &points)
+{
+    // x and pos2.x are stored as differences of their IEEE bit patterns:
+    // lossless, and small for the sorted x of a typical curve.
+    QByteArray header = QJsonDocument(message).toJson(QJsonDocument::Compact);
+    const int n = points.size();
+
+    QByteArray payload;
+    payload.reserve(8 + header.size() + n * (1 + 4 * PlaneCount));
+    appendUInt32(payload, static_cast<quint32>(header.size()));
+    payload.append(header);
+    appendUInt32(payload, static_cast<quint32>(n));
+
+    int offset = payload.size();
+    payload.resize(offset + n * (1 + 4 * PlaneCount));
+    char* out = payload.data() + offset;
+
+    QVector<quint32> values(n);
+    for (int i = 0; i < n; i++)
+    {
+        out[i] = static_cast<char>(points[i].type);
+    }
+    out += n;
+
+    quint32 previous = 0;
+    for (int i = 0; i < n; i++)
+    {
+        quint32 bits = floatBits(points[i].pos.x());
+        values[i] = bits - previous;
+        previous = bits;
+    }
+    writePlanes(out, values.constData(), n);
+    out += n * PlaneCount;
+
+    for (int i = 0; i < n; i++)
+    {
+        values[i] = floatBits(points[i].pos.y());
+    }
+    writePlanes(out, values.constData(), n);
+    out += n * PlaneCount;
+
+    previous = 0;
+    for (int i = 0; i < n; i++)
+    {
+        quint32 bits = floatBits(points[i].pos2.x());
+        values[i] = bits - previous;
+        previous = bits;
+    }
+    writePlanes(out, values.constData(), n);
+    out += n * PlaneCount;
+
+    for (int i = 0; i < n; i++)
+    {
+        values[i] = floatBits(points[i].pos2.y());
+    }
+    writePlanes(out, values.constData(), n);
+    return payload;
+}
+
+bool CurveFrame::decodeDelta(const QByteArray &payload, QJsonObject &message, QVector<CurvePoint> &points)
+{
+    if (payload.size() < 4)
+    {
+        return false;
+    }
+    const char* in = payload.constData();
+    const char* end = in + payload.size();
+
+    qint64 headerSize = readUInt32(in);
+    in += 4;
+    if (end - in < headerSize + 4)
+    {
+        return false;
+    }
+    QJsonDocument doc = QJsonDocument::fromJson(QByteArray(in, static_cast<int>(headerSize)));
+    message = doc.object();
+    in += headerSize;
+
+    qint64 n = readUInt32(in);
+    in += 4;
+    if (end - in != n * (1 + 4 * PlaneCount))
+    {
+        return false;
+    }
+
+    const int count = static_cast<int>(n);
+    points.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        points[i].type = CurvePoint::PointType(static_cast<uchar>(in[i]));
+    }
+    in += count;
+
+    QVector<quint32> values(count);
+    readPlanes(in, values.data(), count);
+    quint32 previous = 0;
+    for (int i = 0; i < count; i++)
+    {
+        previous += values[i];
+        points[i].pos.setX(bitsFloat(previous));
+    }
+    in += count * PlaneCount;
+
+    readPlanes(in, values.data(), count);
+    for (int i = 0; i < count; i++)
+    {
+        points[i].pos.setY(bitsFloat(values[i]));
+    }
+    in += count * PlaneCount;
+
+    readPlanes(in, values.data(), count);
+    previous = 0;
+    for (int i = 0; i < count; i++)
+    {
+        previous += values[i];
+        points[i].pos2.setX(bitsFloat(previous));
+    }
+    in += count * PlaneCount;
+
+    readPlanes(in, values.data(), count);
+    for (int i = 0; i < count; i++)
+    {
+        points[i].pos2.setY(bitsFloat(values[i]));
+    }
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef CURVEFRAME_H
+#define CURVEFRAME_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QJsonArray>
+#include "curvelines.h"
+
+class CurveFrame
+{
+public:
+    enum Encoding{
+        Json = 0x00,
+        Zlib = 0x01,
+        Delta = 0x02,
+    };
+
+public:
+    static QByteArray encode(const QJsonObject& message, const QVector<CurvePoint>& points,
+                             Encoding encoding, int threshold = 4096);
+    static bool decode(const QByteArray& frame, QJsonObject& message, QVector<CurvePoint>& points);
+
+    static QJsonArray toJson(const QVector<CurvePoint>& points);
+    static QVector<CurvePoint> fromJson(const QJsonArray& array);
+
+    static QString encodingName(Encoding encoding);
+    static bool encodingFromName(const QString& name, Encoding& encoding);
+    static QJsonArray encodingNames();
+
+    static void writePlanes(char* out, const quint32* values, int n);
+    static void readPlanes(const char* in, quint32* values, int n);
+
+private:
+    static QByteArray encodeDelta(const QJsonObject& message, const QVector<CurvePoint>& points);
+    static bool decodeDelta(const QByteArray& payload, QJsonObject& message, QVector<CurvePoint>& points);
+};
+
+#endif // CURVEFRAME_H
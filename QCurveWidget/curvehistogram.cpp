@@ -0,0 +1,107 @@
+#include "curvehistogram.h"
+#include <QtAlgorithms>
+
+const int SubBits = 5;
+const int SubBuckets = 1 << SubBits;
+const int BucketCount = SubBuckets + (63 - SubBits) * SubBuckets;
+
+CurveHistogram::CurveHistogram() :
+    m_count(0), m_min(0), m_max(0), m_sum(0), m_buckets(BucketCount, 0)
+{
+
+}
+
+void CurveHistogram::add(qint64 value)
+{
+    value = qMax<qint64>(0, value);
+    m_buckets[bucketIndex(value)]++;
+    m_min = m_count ? qMin(m_min, value) : value;
+    m_max = m_count ? qMax(m_max, value) : value;
+    m_sum += value;
+    m_count++;
+}
+
+void CurveHistogram::clear()
+{
+    m_count = 0;
+    m_min = 0;
+    m_max = 0;
+    m_sum = 0;
+    m_buckets.fill(0);
+}
+
+qint64 CurveHistogram::count() const
+{
+    return m_count;
+}
+
+qint64 CurveHistogram::min() const
+{
+    return m_min;
+}
+
+qint64 CurveHistogram::max() const
+{
+    return m_max;
+}
+
+double CurveHistogram::mean() const
+{
+    return m_count ? m_sum / m_count : 0;
+}
+
+qint64 CurveHistogram::percentile(double p) const
+{
+    if (!m_count)
+    {
+        return 0;
+    }
+    qint64 rank = qMax<qint64>(1, static_cast<qint64>(p / 100.0 * m_count + 0.5));
+    qint64 seen = 0;
+    for (int i = 0; i < m_buckets.size(); i++)
+    {
+        seen += m_buckets[i];
+        if (seen >= rank)
+        {
+            return qMin(bucketValue(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+void CurveHistogram::write(QTextStream &stream, const QString &name) const
+{
+    qint64 seen = 0;
+    for (int i = 0; i < m_buckets.size(); i++)
+    {
+        if (m_buckets[i])
+        {
+            seen += m_buckets[i];
+            stream << name << ',' << qMin(bucketValue(i), m_max) << ','
+                   << 100.0 * seen / m_count << ',' << m_buckets[i] << '\n';
+        }
+    }
+}
+
+int CurveHistogram::bucketIndex(qint64 value)
+{
+    if (value < SubBuckets)
+    {
+        return static_cast<int>(value);
+    }
+    int exponent = 63 - qCountLeadingZeroBits(static_cast<quint64>(value));
+    int sub = static_cast<int>((value >> (exponent - SubBits)) & (SubBuckets - 1));
+    return SubBuckets + (exponent - SubBits) * SubBuckets + sub;
+}
+
+qint64 CurveHistogram::bucketValue(int index)
+{
+    if (index < SubBuckets)
+    {
+        return index;
+    }
+    int exponent = (index - SubBuckets) / SubBuckets + SubBits;
+    qint64 sub = (index - SubBuckets) % SubBuckets;
+    qint64 width = Q_INT64_C(1) << (exponent - SubBits);
+    return ((SubBuckets + sub) << (exponent - SubBits)) + width - 1;
+}
@@ -0,0 +1,40 @@
+#ifndef CURVEHISTOGRAM_H
+#define CURVEHISTOGRAM_H
+
+#include <QVector>
+#include <QString>
+#include <QTextStream>
+
+// Log-linear latency histogram in the spirit of HdrHistogram: values are
+// grouped by power of two and split into SubBuckets linear steps, so every
+// recorded value keeps about 3% relative precision at a fixed memory cost.
+class CurveHistogram
+{
+public:
+    CurveHistogram();
+
+public:
+    void add(qint64 value);
+    void clear();
+
+    qint64 count() const;
+    qint64 min() const;
+    qint64 max() const;
+    double mean() const;
+    qint64 percentile(double p) const;
+
+    void write(QTextStream& stream, const QString& name) const;
+
+private:
+    static int bucketIndex(qint64 value);
+    static qint64 bucketValue(int index);
+
+private:
+    qint64 m_count;
+    qint64 m_min;
+    qint64 m_max;
+    double m_sum;
+    QVector<qint64> m_buckets;
+};
+
+#endif // CURVEHISTOGRAM_H
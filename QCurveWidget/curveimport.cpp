@@ -0,0 +1,447 @@
+#include "curveimport.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+#include <cstring>
+
+const qint64 ChunkSize = 1 << 20;
+const int Window = 1 << 16;
+const int NewtonSteps = 6;
+
+// Distance of p from the chord a-b: vertical while p lies over the chord,
+// to the nearest point of the chord otherwise.
+static float deviation(const QVector2D& a, const QVector2D& b, const QVector2D& p)
+{
+    float dx = b.x() - a.x();
+    float u = dx != 0 ? (p.x() - a.x()) / dx : -1;
+    if (u >= 0 && u <= 1)
+    {
+        return std::abs(a.y() + u * (b.y() - a.y()) - p.y());
+    }
+    QVector2D d = b - a;
+    float length = QVector2D::dotProduct(d, d);
+    float t = length > 0 ? qBound(0.0f, QVector2D::dotProduct(p - a, d) / length, 1.0f) : 0;
+    return (a + d * t - p).length();
+}
+
+// With the control point x halfway between the anchors the segment's x(t)
+// is A.x + (B.x - A.x) * g(t); g is strictly increasing, so Newton from
+// t = u settles in a few steps.
+static double segmentParam(double u)
+{
+    double t = u;
+    for (int k = 0; k < NewtonSteps; k++)
+    {
+        double g = 1.5 * t * (1 - t) + t * t * t;
+        double dg = 1.5 - 3 * t + 3 * t * t;
+        t = qBound(0.0, t - (g - u) / dg, 1.0);
+    }
+    return t;
+}
+
+CurveImport::CurveImport(Format format, Simplify simplify, float tolerance) :
+    m_format(format), m_simplify(simplify), m_tolerance(tolerance),
+    m_samples(0), m_skipped(0)
+{
+
+}
+
+bool CurveImport::read(QIODevice &device)
+{
+    m_buffer.clear();
+    m_points.clear();
+    m_samples = 0;
+    m_skipped = 0;
+    m_error.clear();
+
+    bool ok = m_format == Float32 ? readFloat32(device) : readCsv(device);
+    flush(true);
+    if (ok && m_points.isEmpty())
+    {
+        m_error = QStringLiteral("no samples");
+        ok = false;
+    }
+    return ok;
+}
+
+bool CurveImport::read(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        m_error = file.errorString();
+        return false;
+    }
+    return read(file);
+}
+
+QVector<CurvePoint> CurveImport::points() const
+{
+    return m_points;
+}
+
+qint64 CurveImport::samples() const
+{
+    return m_samples;
+}
+
+qint64 CurveImport::skipped() const
+{
+    return m_skipped;
+}
+
+QString CurveImport::errorString() const
+{
+    return m_error;
+}
+
+CurveImport::Format CurveImport::formatFromName(const QString &path)
+{
+    QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "f32" || suffix == "bin" || suffix == "raw")
+    {
+        return Float32;
+    }
+    return Csv;
+}
+
+bool CurveImport::readChunk(QIODevice &device, QByteArray &data, bool &end)
+{
+    // Sequential devices may have nothing buffered yet without being done.
+    QByteArray chunk = device.read(ChunkSize);
+    if (chunk.isEmpty())
+    {
+        if (device.atEnd() || !device.isReadable())
+        {
+            end = true;
+        }
+        else if (!device.waitForReadyRead(-1))
+        {
+            m_error = device.errorString();
+            return false;
+        }
+    }
+    data.append(chunk);
+    return true;
+}
+
+bool CurveImport::readCsv(QIODevice &device)
+{
+    // Lines are "x,y" or a single "y" (x is then the sample index); ',',
+    // ';', tabs and spaces all separate fields. Lines that do not parse,
+    // such as a header, are counted and skipped.
+    QByteArray data;
+    bool end = false;
+    while (!end)
+    {
+        if (!readChunk(device, data, end))
+        {
+            return false;
+        }
+
+        int start = 0;
+        int stop = end ? data.size() : data.lastIndexOf('\n') + 1;
+        while (start < stop)
+        {
+            int newline = data.indexOf('\n', start);
+            int lineEnd = (newline < 0 || newline >= stop) ? stop : newline;
+            const char* p = data.constData() + start;
+            const char* e = data.constData() + lineEnd;
+            start = lineEnd + 1;
+
+            double values[2];
+            int fields = 0;
+            bool ok = true;
+            while (p < e && ok)
+            {
+                while (p < e && (*p == ' ' || *p == '\t' || *p == '\r'))
+                {
+                    p++;
+                }
+                if (p == e || *p == '#')
+                {
+                    break;
+                }
+                const char* q = p;
+                while (q < e && *q != ',' && *q != ';' && *q != ' ' && *q != '\t' && *q != '\r')
+                {
+                    q++;
+                }
+                if (fields < 2)
+                {
+                    values[fields++] = QByteArray::fromRawData(p, static_cast<int>(q - p)).toDouble(&ok);
+                }
+                p = q;
+                while (p < e && (*p == ' ' || *p == '\t' || *p == '\r'))
+                {
+                    p++;
+                }
+                if (p < e && (*p == ',' || *p == ';'))
+                {
+                    p++;
+                }
+            }
+            if (!ok)
+            {
+                m_skipped++;
+            }
+            else if (fields == 1)
+            {
+                addSample(static_cast<float>(m_samples), static_cast<float>(values[0]));
+            }
+            else if (fields == 2)
+            {
+                addSample(static_cast<float>(values[0]), static_cast<float>(values[1]));
+            }
+        }
+        data.remove(0, stop);
+    }
+    return true;
+}
+
+bool CurveImport::readFloat32(QIODevice &device)
+{
+    // Little-endian float32 (x, y) pairs with no header.
+    QByteArray data;
+    bool end = false;
+    while (!end)
+    {
+        if (!readChunk(device, data, end))
+        {
+            return false;
+        }
+
+        int pairs = data.size() / 8;
+        const uchar* p = reinterpret_cast<const uchar*>(data.constData());
+        for (int k = 0; k < pairs; k++, p += 8)
+        {
+            quint32 bits[2] = {qFromLittleEndian<quint32>(p), qFromLittleEndian<quint32>(p + 4)};
+            float xy[2];
+            memcpy(xy, bits, sizeof(xy));
+            addSample(xy[0], xy[1]);
+        }
+        data.remove(0, pairs * 8);
+    }
+    if (!data.isEmpty())
+    {
+        m_error = QStringLiteral("truncated sample pair");
+        return false;
+    }
+    return true;
+}
+
+void CurveImport::addSample(float x, float y)
+{
+    if (!std::isfinite(x) || !std::isfinite(y))
+    {
+        m_skipped++;
+        return;
+    }
+    m_samples++;
+    if (m_simplify == Simplify_None)
+    {
+        emitPoint(CurvePoint(x, y, CurvePoint::Line));
+        return;
+    }
+    m_buffer.append(QVector2D(x, y));
+    if (m_buffer.size() >= Window)
+    {
+        flush(false);
+    }
+}
+
+void CurveImport::flush(bool final)
+{
+    if (m_buffer.isEmpty())
+    {
+        return;
+    }
+    if (m_points.isEmpty())
+    {
+        emitPoint(CurvePoint(m_buffer.first(), CurvePoint::Line));
+    }
+    if (m_simplify == Simplify_Lines)
+    {
+        simplifyLines(final);
+    }
+    else
+    {
+        simplifyCurves(final);
+    }
+}
+
+void CurveImport::simplifyLines(bool final)
+{
+    // Ramer-Douglas-Peucker over the window. Both window ends are kept, so
+    // the windows stitch together without exceeding the tolerance; the
+    // last sample stays buffered as the anchor of the next one.
+    int n = m_buffer.size();
+    QVector<char> keep(n, 0);
+    keep[0] = 1;
+    keep[n - 1] = 1;
+    QVector<QPair<int, int>> stack;
+    stack.append(qMakePair(0, n - 1));
+    while (!stack.isEmpty())
+    {
+        QPair<int, int> range = stack.takeLast();
+        float worst = m_tolerance;
+        int split = -1;
+        for (int k = range.first + 1; k < range.second; k++)
+        {
+            float d = deviation(m_buffer[range.first], m_buffer[range.second], m_buffer[k]);
+            if (d > worst)
+            {
+                worst = d;
+                split = k;
+            }
+        }
+        if (split >= 0)
+        {
+            keep[split] = 1;
+            stack.append(qMakePair(range.first, split));
+            stack.append(qMakePair(split, range.second));
+        }
+    }
+    for (int k = 1; k < n; k++)
+    {
+        if (keep[k])
+        {
+            emitPoint(CurvePoint(m_buffer[k], CurvePoint::Line));
+        }
+    }
+    m_buffer.remove(0, final ? n : n - 1);
+}
+
+void CurveImport::simplifyCurves(bool final)
+{
+    // Greedy fitting: each segment grows from its anchor as far as a line
+    // or a single-control-point Bezier stays within the tolerance. A
+    // segment still open at the window end waits for more samples, unless
+    // it already spans the whole window.
+    int n = m_buffer.size();
+    int anchor = 0;
+    while (anchor < n - 1)
+    {
+        CurvePoint point;
+        int last = fitWindow(anchor, n - 1, final || anchor == 0, point);
+        if (last < 0)
+        {
+            break;
+        }
+        emitPoint(point);
+        anchor = last;
+    }
+    m_buffer.remove(0, final ? n : anchor);
+}
+
+int CurveImport::fitWindow(int first, int last, bool final, CurvePoint &point)
+{
+    CurvePoint candidate;
+    int good = first + 1;
+    int bad = last + 1;
+    fitSegment(first, good, point);
+    for (int probe = first + 2; probe <= last; probe = qMin(last, first + 2 * (probe - first)))
+    {
+        if (!fitSegment(first, probe, candidate))
+        {
+            bad = probe;
+            break;
+        }
+        good = probe;
+        point = candidate;
+        if (probe == last)
+        {
+            break;
+        }
+    }
+    while (bad - good > 1)
+    {
+        int mid = (good + bad) / 2;
+        if (fitSegment(first, mid, candidate))
+        {
+            good = mid;
+            point = candidate;
+        }
+        else
+        {
+            bad = mid;
+        }
+    }
+    if (!final && good == last)
+    {
+        return -1;
+    }
+    return good;
+}
+
+bool CurveImport::fitSegment(int first, int last, CurvePoint &point)
+{
+    // The segment runs from the previous point B (t = 1) to the emitted
+    // point A (t = 0), matching CurveLines::evaluate().
+    const QVector2D& B = m_buffer[first];
+    const QVector2D& A = m_buffer[last];
+    point = CurvePoint(A, CurvePoint::Line);
+    point.pos2 = (A + B) / 2;
+
+    float lineError = 0;
+    bool inside = B.x() != A.x();
+    double span = static_cast<double>(B.x()) - A.x();
+    for (int k = first + 1; k < last; k++)
+    {
+        const QVector2D& p = m_buffer[k];
+        lineError = qMax(lineError, deviation(B, A, p));
+        double u = (p.x() - A.x()) / span;
+        inside = inside && u > 0 && u < 1;
+    }
+    if (lineError <= m_tolerance)
+    {
+        return true;
+    }
+    if (m_simplify != Simplify_Curves || !inside)
+    {
+        return false;
+    }
+
+    // Only the control point's y is free, so the least-squares fit of
+    // y(t) = A.y (1-t)^3 + 3t(1-t) C.y + B.y t^3 has a closed form.
+    double num = 0;
+    double den = 0;
+    for (int k = first + 1; k < last; k++)
+    {
+        const QVector2D& p = m_buffer[k];
+        double t = segmentParam((p.x() - A.x()) / span);
+        double s = 1 - t;
+        double w = 3 * t * s;
+        num += w * (p.y() - A.y() * s * s * s - B.y() * t * t * t);
+        den += w * w;
+    }
+    if (den <= 0)
+    {
+        return false;
+    }
+    double cy = num / den;
+    for (int k = first + 1; k < last; k++)
+    {
+        const QVector2D& p = m_buffer[k];
+        double t = segmentParam((p.x() - A.x()) / span);
+        double s = 1 - t;
+        double y = A.y() * s * s * s + 3 * t * s * cy + B.y() * t * t * t;
+        if (std::abs(y - p.y()) > m_tolerance)
+        {
+            return false;
+        }
+    }
+    point.type = CurvePoint::Curve;
+    point.pos2 = QVector2D(point.pos2.x(), static_cast<float>(cy));
+    return true;
+}
+
+void CurveImport::emitPoint(const CurvePoint &point)
+{
+    m_points.append(point);
+    CurvePoint& emitted = m_points.last();
+    if (emitted.pos == emitted.pos2 && m_points.size() > 1)
+    {
+        emitted.pos2 = (emitted.pos + m_points[m_points.size() - 2].pos) / 2;
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef CURVEIMPORT_H
+#define CURVEIMPORT_H
+
+#include <QIODevice>
+#include <QVector2D>
+#include "curvelines.h"
+
+// Streaming importer for dense sample data. The input is read in chunks
+// and folded into the point list as it arrives, optionally simplified so
+// that no sample ends up further than the tolerance (measured in y) from
+// the resulting curve.
+class CurveImport
+{
+public:
+    enum Format{
+        Csv = 0x00,
+        Float32 = 0x01,
+    };
+
+    enum Simplify{
+        Simplify_None = 0x00,
+        Simplify_Lines = 0x01,
+        Simplify_Curves = 0x02,
+    };
+
+public:
+    CurveImport(Format format = Csv, Simplify simplify = Simplify_None, float tolerance = 0);
+
+public:
+    bool read(QIODevice& device);
+    bool read(const QString& path);
+
+    QVector<CurvePoint> points() const;
+    qint64 samples() const;
+    qint64 skipped() const;
+    QString errorString() const;
+
+    static Format formatFromName(const QString& path);
+
+private:
+    bool readChunk(QIODevice& device, QByteArray& data, bool& end);
+    bool readCsv(QIODevice& device);
+    bool readFloat32(QIODevice& device);
+    void addSample(float x, float y);
+    void flush(bool final);
+    void simplifyLines(bool final);
+    void simplifyCurves(bool final);
+    int fitWindow(int first, int last, bool final, CurvePoint& point);
+    bool fitSegment(int first, int last, CurvePoint& point);
+    void emitPoint(const CurvePoint& point);
+
+private:
+    Format m_format;
+    Simplify m_simplify;
+    float m_tolerance;
+    QVector<QVector2D> m_buffer;
+    QVector<CurvePoint> m_points;
+    qint64 m_samples;
+    qint64 m_skipped;
+    QString m_error;
+};
+
+#endif // CURVEIMPORT_H
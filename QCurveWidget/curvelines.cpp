@@ -1,7 +1,111 @@
 #include "curvelines.h"
+#include "curveoverlay.h"
+#include "curvesnapshot.h"
+#include "curvestream.h"
+#include <atomic>
 #include <QDebug>
+#include <QMetaMethod>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
 
-CurveLines::CurveLines() : m_min(0), m_max(0), m_average(0)
+const qint64 DefaultUndoLimit = 64 << 20;
+// Segments per leaf of the bounds tree.
+const int BoundsBucket = 16;
+// Points per leaf of the stats tree.
+const int StatsBucket = 64;
+// Polyline steps a curve segment is flattened into before the exact solve.
+const int HitSteps = 16;
+// Selection transforms: fields per work unit, and the selection size
+// from which helper threads join in.
+const int TransformBlock = 1 << 14;
+const int TransformParallelMin = 1 << 16;
+
+static void transformAxis(float* values, int n, float scale, float shift, float step, float origin,
+                          float low, float high)
+{
+    // Separate plain loops, so each one vectorizes.
+    if (scale != 1.0f || shift != 0.0f)
+    {
+        for (int k = 0; k < n; k++)
+        {
+            values[k] = values[k] * scale + shift;
+        }
+    }
+    if (step > 0.0f)
+    {
+        const float inverse = 1.0f / step;
+        for (int k = 0; k < n; k++)
+        {
+            values[k] = origin + std::floor((values[k] - origin) * inverse + 0.5f) * step;
+        }
+    }
+    if (low > -FLT_MAX || high < FLT_MAX)
+    {
+        for (int k = 0; k < n; k++)
+        {
+            values[k] = qMin(qMax(values[k], low), high);
+        }
+    }
+}
+
+// Pulls blocks of selected fields off a shared counter, transforms them
+// and, for an in-memory curve, writes them straight back.
+class CurveLines::TransformTask : public QRunnable
+{
+public:
+    TransformTask(const Transform& transform, const qint32* fields, float* xs, float* ys, int count,
+                  CurvePoint* points, std::atomic<int>& next) :
+        m_transform(transform), m_fields(fields), m_xs(xs), m_ys(ys), m_count(count),
+        m_points(points), m_next(next) {}
+
+public:
+    void run() override
+    {
+        const Transform& t = m_transform;
+        const int blocks = (m_count + TransformBlock - 1) / TransformBlock;
+        int block;
+        while ((block = m_next.fetch_add(1, std::memory_order_relaxed)) < blocks)
+        {
+            const int first = block * TransformBlock;
+            const int n = qMin(TransformBlock, m_count - first);
+            transformAxis(m_xs + first, n, t.scale.x(), t.shift.x(), t.step.x(), t.origin.x(), t.low.x(), t.high.x());
+            transformAxis(m_ys + first, n, t.scale.y(), t.shift.y(), t.step.y(), t.origin.y(), t.low.y(), t.high.y());
+            if (!m_points)
+            {
+                continue;
+            }
+            for (int k = first; k < first + n; k++)
+            {
+                CurvePoint& point = m_points[m_fields[k] >> 1];
+                ((m_fields[k] & 1) ? point.pos2 : point.pos) = QVector2D(m_xs[k], m_ys[k]);
+            }
+        }
+    }
+
+private:
+    const Transform& m_transform;
+    const qint32* m_fields;
+    float* m_xs;
+    float* m_ys;
+    int m_count;
+    CurvePoint* m_points;
+    std::atomic<int>& m_next;
+};
+
+static bool samePoint(const CurvePoint& a, const CurvePoint& b)
+{
+    return a.type == b.type && a.pos == b.pos && a.pos2 == b.pos2;
+}
+
+CurveLines::CurveLines() :
+    m_updateDepth(0), m_updatePending(false),
+    m_undoBytes(0), m_undoLimit(DefaultUndoLimit), m_editGroup(0), m_batchGroup(0), m_editSealed(true),
+    m_snapshotVersion(0), m_changedFrom(0), m_changedTo(INT_MAX), m_areaFrom(0), m_areaTo(INT_MAX),
+    m_statsLeaves(0), m_statsPoints(0), m_statsFrom(0), m_statsTo(INT_MAX),
+    m_boundsLeaves(0), m_boundsSegments(0), m_boundsFrom(0), m_boundsTo(INT_MAX),
+    m_mapped(false), m_overlay(new CurveOverlay), m_streaming(false), m_stream(new CurveStream), m_streamDropped(0),
+    m_sorted(true), m_min(0), m_max(0), m_average(0)
 {
 
 }
@@ -13,144 +117,1338 @@ CurveLines::~CurveLines()
 
 void CurveLines::onCurve(const QVector<CurvePoint> &points)
 {
-    m_points = points;
+    m_overlay->close();
+    m_mapped = false;
+    if (m_streaming)
+    {
+        m_stream->assign(points);
+    }
+    else
+    {
+        m_points = points;
+    }
+    markChanged(0);
+    clearUndo();
+    updateStats();
 }
 
 int CurveLines::pointsSize()
 {
-    return m_points.size();
+    return m_mapped ? m_overlay->size() : m_streaming ? m_stream->size() : m_points.size();
 }
 
 int CurveLines::pointsTouchSize()
 {
     int count = 0;
-    for (int i = 0; i < m_points.size(); i++)
+    for (int i = nextEdited(-1); i < pointsSize(); i = nextEdited(i))
     {
-        if(m_points[i].touch)
+        CurvePoint& point = pointRef(i);
+        if(point.touch)
         {
             count++;
         }
-        if(m_points[i].touch2)
+        if(point.touch2)
         {
             count++;
         }
     }
-    return count;
+    return count;
+}
+
+int CurveLines::pointsDragSize()
+{
+    m_editSealed = true;
+    int count = 0;
+    for (int i = nextEdited(-1); i < pointsSize(); i = nextEdited(i))
+    {
+        CurvePoint& point = pointRef(i);
+        if(point.touch)
+        {
+            point.drag = true;
+            count++;
+        }
+        if(point.touch2)
+        {
+            point.drag2 = true;
+            count++;
+        }
+    }
+    return count;
+}
+
+bool CurveLines::pointsSorted()
+{
+    return m_sorted;
+}
+
+bool CurveLines::pointsMapped()
+{
+    return m_mapped;
+}
+
+bool CurveLines::pointsStreaming()
+{
+    return m_streaming;
+}
+
+bool CurveLines::open(const QString &path)
+{
+    // Like onCurve(), opening replaces the points without emitting them;
+    // nothing is read beyond the header and the page table.
+    if (!m_overlay->open(path))
+    {
+        m_error = m_overlay->errorString();
+        return false;
+    }
+    m_error.clear();
+    m_mapped = true;
+    m_points.clear();
+    m_streaming = false;
+    m_stream->setCapacity(0);
+    markChanged(0);
+    clearUndo();
+    updateStats();
+    emit updateMapped();
+    return true;
+}
+
+bool CurveLines::save(const QString &path)
+{
+    m_error.clear();
+    if (!m_mapped)
+    {
+        return CurveFile::write(path, m_streaming ? m_stream->points() : m_points, &m_error);
+    }
+    bool ok = m_overlay->save(path);
+    m_error = m_overlay->errorString();
+    m_mapped = m_overlay->isOpen();
+    markChanged(0);
+    updateStats();
+    if (m_mapped)
+    {
+        emit updateMapped();
+    }
+    return ok;
+}
+
+QString CurveLines::fileName()
+{
+    return m_overlay->fileName();
+}
+
+QString CurveLines::errorString()
+{
+    return m_error;
+}
+
+void CurveLines::setPoints(const QVector<CurvePoint> &points)
+{
+    // Bulk replacement: one stats pass and one updateCurve however many
+    // points arrive, where insertPoint() pays both per point.
+    m_overlay->close();
+    m_mapped = false;
+    if (m_streaming)
+    {
+        m_stream->assign(points);
+    }
+    else
+    {
+        m_points = points;
+    }
+    markChanged(0);
+    clearUndo();
+    updatePoints();
+}
+
+void CurveLines::insertPoint(const CurvePoint &point)
+{
+    int index = pointsSize();
+//    for (int i = 0; i < m_points.size(); i++)
+//    {
+//        if(m_points[i] == point)
+//        {
+//            m_points[i] = point;
+//            index = i;
+//            break;
+//        }
+//        else if (m_points[i] > point)
+//        {
+//            m_points.insert(i, point);
+//            index = i;
+//            break;
+//        }
+//    }
+//    if(index == m_points.size())
+//    {
+        appendPoint(point);
+//    }
+    // A full stream dropped its oldest point to make room.
+    index = qMin(index, pointsSize() - 1);
+
+    CurvePoint& inserted = pointRef(index);
+    if(inserted.pos == inserted.pos2 && index > 0)
+    {
+        QVector2D pos2 = (inserted.pos + pointAt(index - 1).pos) / 2;
+        inserted.pos2 = pos2;
+    }
+    Edit edit(Edit::Edit_Insert);
+    edit.fields.append(index);
+    recordEdit(edit);
+    updatePoints();
+}
+
+void CurveLines::selectPoints()
+{
+    m_editSealed = true;
+    for (int i = 0; i < pointsSize(); i++)
+    {
+        CurvePoint& point = pointRef(i);
+        point.drag = false;
+        point.touch = true;
+        point.drag2 = false;
+        point.touch2 = true;
+    }
+}
+
+void CurveLines::releasePoints()
+{
+    m_editSealed = true;
+    for (int i = nextEdited(-1); i < pointsSize(); i = nextEdited(i))
+    {
+        CurvePoint& point = pointRef(i);
+        point.drag = false;
+        point.touch = false;
+        point.drag2 = false;
+        point.touch2 = false;
+    }
+}
+
+void CurveLines::updatePoints()
+{
+    if (m_updateDepth > 0)
+    {
+        // Until endUpdate() the order is unknown, so lookups take the
+        // unsorted path instead of trusting a stale flag.
+        m_updatePending = true;
+        m_sorted = false;
+        return;
+    }
+    updateStats();
+    m_streamed.clear();
+    m_streamDropped = 0;
+    if (!m_mapped && !m_streaming)
+    {
+        emit updateCurve(m_points);
+    }
+    else if (m_mapped)
+    {
+        // Never copied out: that would read every page of the file into
+        // memory on each edit. Listeners read it in place instead.
+        emit updateMapped();
+    }
+    else if (isSignalConnected(QMetaMethod::fromSignal(&CurveLines::updateCurve)))
+    {
+        // The signal carries the whole curve, so a streaming one is only
+        // copied out when somebody listens.
+        QVector<CurvePoint> points;
+        points.reserve(pointsSize());
+        for (int i = 0; i < pointsSize(); i++)
+        {
+            points.append(pointAt(i));
+        }
+        emit updateCurve(points);
+    }
+}
+
+void CurveLines::beginUpdate()
+{
+    if (m_updateDepth++ == 0)
+    {
+        m_batchGroup = ++m_editGroup;
+    }
+}
+
+void CurveLines::endUpdate()
+{
+    if (m_updateDepth > 0 && --m_updateDepth == 0)
+    {
+        if (m_updatePending)
+        {
+            m_updatePending = false;
+            updatePoints();
+        }
+        else if (!m_streamed.isEmpty() || m_streamDropped)
+        {
+            flushStream();
+        }
+    }
+}
+
+bool CurveLines::updating()
+{
+    return m_updateDepth > 0;
+}
+
+bool CurveLines::undo()
+{
+    if (m_undo.isEmpty())
+    {
+        return false;
+    }
+    const quint32 group = m_undo.last().group;
+    while (!m_undo.isEmpty() && m_undo.last().group == group)
+    {
+        m_redo.append(m_undo.takeLast());
+        m_undoBytes -= m_redo.last().bytes();
+        applyEdit(m_redo.last());
+        m_undoBytes += m_redo.last().bytes();
+    }
+    trimEdits();
+    m_editSealed = true;
+    updatePoints();
+    return true;
+}
+
+bool CurveLines::redo()
+{
+    if (m_redo.isEmpty())
+    {
+        return false;
+    }
+    const quint32 group = m_redo.last().group;
+    while (!m_redo.isEmpty() && m_redo.last().group == group)
+    {
+        m_undo.append(m_redo.takeLast());
+        m_undoBytes -= m_undo.last().bytes();
+        applyEdit(m_undo.last());
+        m_undoBytes += m_undo.last().bytes();
+    }
+    trimEdits();
+    m_editSealed = true;
+    updatePoints();
+    return true;
+}
+
+bool CurveLines::canUndo()
+{
+    return !m_undo.isEmpty();
+}
+
+bool CurveLines::canRedo()
+{
+    return !m_redo.isEmpty();
+}
+
+void CurveLines::clearUndo()
+{
+    m_undo.clear();
+    m_redo.clear();
+    m_undoBytes = 0;
+    m_editSealed = true;
+}
+
+void CurveLines::setUndoLimit(qint64 bytes)
+{
+    m_undoLimit = qMax<qint64>(0, bytes);
+    trimEdits();
+}
+
+qint64 CurveLines::undoLimit()
+{
+    return m_undoLimit;
+}
+
+qint64 CurveLines::undoSize()
+{
+    return m_undoBytes;
+}
+
+qint64 CurveLines::Edit::bytes() const
+{
+    return static_cast<qint64>(sizeof(Edit)) + fields.size() * static_cast<qint64>(sizeof(qint32))
+            + values.size() * static_cast<qint64>(sizeof(QVector2D))
+            + points.size() * static_cast<qint64>(sizeof(CurvePoint));
+}
+
+void CurveLines::recordEdit(Edit &edit)
+{
+    // Stream indices move with every dropped point, so a streaming curve
+    // keeps no history.
+    if (edit.fields.isEmpty() || m_streaming)
+    {
+        return;
+    }
+    while (!m_redo.isEmpty())
+    {
+        m_undoBytes -= m_redo.takeLast().bytes();
+    }
+    // A drag step over the same fields as the previous one folds into it:
+    // the values kept there are still the ones from before the drag.
+    const bool merge = edit.drag && !m_editSealed && !m_undo.isEmpty()
+            && m_undo.last().drag && m_undo.last().fields == edit.fields;
+    m_editSealed = false;
+    if (!merge)
+    {
+        edit.group = m_updateDepth > 0 ? m_batchGroup : ++m_editGroup;
+        m_undo.append(edit);
+        m_undoBytes += edit.bytes();
+    }
+    trimEdits();
+}
+
+void CurveLines::applyEdit(Edit &edit)
+{
+    // Every edit is its own inverse once applied: moved fields swap with
+    // the kept values, inserted points are taken out and kept, kept points
+    // go back in.
+    if (edit.type == Edit::Edit_Move)
+    {
+        for (int k = 0; k < edit.fields.size(); k++)
+        {
+            CurvePoint& point = pointRef(edit.fields[k] >> 1);
+            QVector2D& pos = (edit.fields[k] & 1) ? point.pos2 : point.pos;
+            QVector2D value = pos;
+            pos = edit.values[k];
+            edit.values[k] = value;
+        }
+    }
+    else if (edit.type == Edit::Edit_Insert)
+    {
+        edit.points.reserve(edit.fields.size());
+        for (qint32 i : edit.fields)
+        {
+            edit.points.append(pointAt(i));
+        }
+        removePoints(edit.fields);
+        edit.type = Edit::Edit_Remove;
+    }
+    else
+    {
+        insertPoints(edit.fields, edit.points);
+        edit.points.clear();
+        edit.type = Edit::Edit_Insert;
+    }
+}
+
+void CurveLines::trimEdits()
+{
+    // Oldest steps go first, whole groups at a time; redo steps are only
+    // dropped once no undo step is left.
+    while (m_undoBytes > m_undoLimit && (!m_undo.isEmpty() || !m_redo.isEmpty()))
+    {
+        QList<Edit>& edits = m_undo.isEmpty() ? m_redo : m_undo;
+        const quint32 group = edits.first().group;
+        while (!edits.isEmpty() && edits.first().group == group)
+        {
+            m_undoBytes -= edits.takeFirst().bytes();
+        }
+    }
+}
+
+void CurveLines::insertPoints(const QVector<qint32> &indices, const QVector<CurvePoint> &points)
+{
+    // indices are ascending positions in the result. QVector::insert()
+    // shifts by assignment, which leaves the touch and drag flags behind,
+    // so the in-memory path rebuilds the vector instead.
+    markChanged(indices.first());
+    if (m_mapped)
+    {
+        for (int k = 0; k < indices.size(); k++)
+        {
+            m_overlay->insert(indices[k], points[k]);
+        }
+        return;
+    }
+    if (m_streaming)
+    {
+        for (int k = 0; k < indices.size(); k++)
+        {
+            if (m_stream->insert(indices[k], points[k]))
+            {
+                markChanged(0);
+            }
+        }
+        return;
+    }
+    if (indices.first() == m_points.size())
+    {
+        m_points += points;
+        return;
+    }
+    QVector<CurvePoint> result;
+    result.reserve(m_points.size() + points.size());
+    int from = 0;
+    for (int k = 0; k < indices.size(); k++)
+    {
+        int run = indices[k] - result.size();
+        result += m_points.mid(from, run);
+        from += run;
+        result.append(points[k]);
+    }
+    result += m_points.mid(from);
+    m_points = result;
+}
+
+void CurveLines::removePoints(const QVector<qint32> &indices)
+{
+    // indices are ascending positions in the current points.
+    markChanged(indices.first());
+    if (m_mapped)
+    {
+        for (int k = indices.size() - 1; k >= 0; k--)
+        {
+            m_overlay->remove(indices[k]);
+        }
+        return;
+    }
+    if (indices.first() == m_points.size() - indices.size())
+    {
+        m_points.resize(indices.first());
+        return;
+    }
+    QVector<CurvePoint> result;
+    result.reserve(m_points.size() - indices.size());
+    int from = 0;
+    for (qint32 i : indices)
+    {
+        result += m_points.mid(from, i - from);
+        from = i + 1;
+    }
+    result += m_points.mid(from);
+    m_points = result;
+}
+
+void CurveLines::updateStats()
+{
+    m_sorted = true;
+    if (m_mapped)
+    {
+        double sum = 0;
+        m_overlay->stats(m_min, m_max, sum, m_sorted);
+        m_average = pointsSize() ? static_cast<float>(sum / pointsSize()) : 0;
+    }
+    else if (m_streaming)
+    {
+        m_sorted = m_stream->sorted();
+        m_min = m_stream->min();
+        m_max = m_stream->max();
+        m_average = m_stream->average();
+    }
+    else if(m_points.size())
+    {
+        // Only the leaves an edit touched are summed again, so undoing or
+        // dragging a few points costs O(delta + log n), not a full pass.
+        updateStatsTree();
+        const Stats& stats = m_stats.at(1);
+        m_sorted = stats.unsorted == 0;
+        m_min = stats.min;
+        m_max = stats.max;
+        m_average = static_cast<float>(stats.sum / m_points.size());
+    }
+    if (m_snapshot)
+    {
+        buildSnapshot();
+    }
+}
+
+void CurveLines::updateStatsTree()
+{
+    // Leaf b holds points b * StatsBucket onwards; a point counts as
+    // unsorted when it lies left of the one before it, so a change at i
+    // also touches the order of i + 1.
+    const int points = m_points.size();
+    if (m_statsFrom > m_statsTo && m_statsPoints == points)
+    {
+        return;
+    }
+    int first = m_statsFrom;
+    int last = m_statsTo == INT_MAX || m_statsPoints != points ?
+                qMax(points, m_statsPoints) - 1 : qMin(points - 1, m_statsTo + 1);
+    const int buckets = (points + StatsBucket - 1) / StatsBucket;
+    if (buckets > m_statsLeaves)
+    {
+        int leaves = 16;
+        while (leaves < buckets)
+        {
+            leaves <<= 1;
+        }
+        m_statsLeaves = leaves;
+        m_stats = QVector<Stats>(2 * leaves);
+        first = 0;
+        last = points - 1;
+    }
+    const int leaves = m_statsLeaves;
+    const int firstBucket = first / StatsBucket;
+    const int lastBucket = qMin(last / StatsBucket, leaves - 1);
+    for (int b = firstBucket; b <= lastBucket && first <= last; b++)
+    {
+        Stats stats;
+        for (int i = b * StatsBucket; i < qMin(points, (b + 1) * StatsBucket); i++)
+        {
+            const CurvePoint& point = m_points.at(i);
+            stats.min = qMin(stats.min, point.pos.y());
+            stats.max = qMax(stats.max, point.pos.y());
+            stats.sum += point.pos.y();
+            if (i > 0 && point.pos.x() < m_points.at(i - 1).pos.x())
+            {
+                stats.unsorted++;
+            }
+        }
+        m_stats[leaves + b] = stats;
+    }
+    for (int lo = (leaves + firstBucket) >> 1, hi = (leaves + lastBucket) >> 1; lo >= 1 && first <= last; lo >>= 1, hi >>= 1)
+    {
+        for (int node = lo; node <= hi; node++)
+        {
+            Stats stats = m_stats.at(2 * node);
+            stats.unite(m_stats.at(2 * node + 1));
+            m_stats[node] = stats;
+        }
+    }
+    m_statsPoints = points;
+    m_statsFrom = INT_MAX;
+    m_statsTo = -1;
+}
+
+void CurveLines::markChanged(int from, int to)
+{
+    m_changedFrom = qMin(m_changedFrom, from);
+    m_changedTo = qMax(m_changedTo, to);
+    m_areaFrom = qMin(m_areaFrom, from);
+    m_areaTo = qMax(m_areaTo, to);
+    m_statsFrom = qMin(m_statsFrom, from);
+    m_statsTo = qMax(m_statsTo, to);
+    m_boundsFrom = qMin(m_boundsFrom, from);
+    m_boundsTo = qMax(m_boundsTo, to);
+}
+
+void CurveLines::buildSnapshot()
+{
+    if (m_snapshot && m_changedFrom > m_changedTo)
+    {
+        return;
+    }
+    // Chunks wholly outside the changed range are reused as they are; the
+    // ones inside are compared first, since pointRef() also marks flag
+    // changes, which a snapshot does not carry.
+    const CurveSnapshot* previous = m_snapshot.get();
+    std::shared_ptr<CurveSnapshot> next(new CurveSnapshot);
+    next->m_size = pointsSize();
+    next->m_sorted = m_sorted;
+    next->m_min = m_min;
+    next->m_max = m_max;
+    next->m_average = m_average;
+    bool changed = !previous || previous->m_size != next->m_size || previous->m_sorted != next->m_sorted;
+    const int chunks = (next->m_size + CurveSnapshot::ChunkSize - 1) >> CurveSnapshot::ChunkShift;
+    next->m_chunks.reserve(chunks);
+    for (int c = 0; c < chunks; c++)
+    {
+        const int start = c << CurveSnapshot::ChunkShift;
+        const int count = qMin<int>(CurveSnapshot::ChunkSize, next->m_size - start);
+        if (previous && c < previous->m_chunks.size() && previous->m_chunks.at(c).size() == count)
+        {
+            const QVector<CurvePoint>& chunk = previous->m_chunks.at(c);
+            bool same = start + count <= m_changedFrom || start > m_changedTo;
+            if (!same)
+            {
+                same = true;
+                for (int k = 0; k < count && same; k++)
+                {
+                    same = samePoint(chunk.at(k), pointAt(start + k));
+                }
+            }
+            if (same)
+            {
+                next->m_chunks.append(chunk);
+                continue;
+            }
+        }
+        changed = true;
+        if (!m_mapped && !m_streaming)
+        {
+            next->m_chunks.append(m_points.mid(start, count));
+            continue;
+        }
+        QVector<CurvePoint> chunk;
+        chunk.reserve(count);
+        for (int k = 0; k < count; k++)
+        {
+            chunk.append(pointAt(start + k));
+        }
+        next->m_chunks.append(chunk);
+    }
+    if (changed)
+    {
+        next->m_version = ++m_snapshotVersion;
+        std::atomic_store(&m_snapshot, CurveSnapshotPtr(next));
+    }
+    m_changedFrom = INT_MAX;
+    m_changedTo = -1;
+}
+
+void CurveLines::updateAreas()
+{
+    // Segment i runs from point i-1 to point i, so a changed point i
+    // touches segments i and i+1. Appends and removals renumber everything
+    // after them; Fenwick nodes below the first renumbered segment cover
+    // only earlier segments and stay as they are.
+    const int segments = qMax(0, pointsSize() - 1);
+    if (m_areaFrom > m_areaTo && m_segmentAreas.size() == segments + 1)
+    {
+        return;
+    }
+    const int first = qMax(1, m_areaFrom);
+    if (m_areaTo == INT_MAX || m_segmentAreas.size() != segments + 1)
+    {
+        const int from = m_segmentAreas.isEmpty() ? 1 : qMin(first, m_segmentAreas.size());
+        m_segmentAreas.resize(segments + 1);
+        m_areas.resize(segments + 1);
+        for (int j = from; j <= segments; j++)
+        {
+            m_segmentAreas[j] = segmentArea(j);
+            double sum = m_segmentAreas.at(j);
+            for (int step = 1; step < (j & -j); step <<= 1)
+            {
+                sum += m_areas.at(j - step);
+            }
+            m_areas[j] = sum;
+        }
+    }
+    else
+    {
+        const int last = qMin(segments, m_areaTo + 1);
+        for (int j = first; j <= last; j++)
+        {
+            const double area = segmentArea(j);
+            const double delta = area - m_segmentAreas.at(j);
+            if (delta == 0)
+            {
+                continue;
+            }
+            m_segmentAreas[j] = area;
+            for (int k = j; k <= segments; k += k & -k)
+            {
+                m_areas[k] += delta;
+            }
+        }
+    }
+    m_areaFrom = INT_MAX;
+    m_areaTo = -1;
+}
+
+void CurveLines::updateBounds()
+{
+    // Leaf b holds the box around segments b * BoundsBucket + 1 onwards,
+    // every inner node the union of its two children.
+    const int segments = qMax(0, pointsSize() - 1);
+    if (m_boundsFrom > m_boundsTo && m_boundsSegments == segments)
+    {
+        return;
+    }
+    int first = qMax(1, m_boundsFrom);
+    int last = m_boundsTo == INT_MAX || m_boundsSegments != segments ?
+                qMax(segments, m_boundsSegments) : qMin(segments, m_boundsTo + 1);
+    const int buckets = (segments + BoundsBucket - 1) / BoundsBucket;
+    if (buckets > m_boundsLeaves)
+    {
+        int leaves = 16;
+        while (leaves < buckets)
+        {
+            leaves <<= 1;
+        }
+        m_boundsLeaves = leaves;
+        m_bounds = QVector<Bounds>(2 * leaves);
+        first = 1;
+        last = segments;
+    }
+    const int leaves = m_boundsLeaves;
+    const int firstBucket = (first - 1) / BoundsBucket;
+    const int lastBucket = qMin((last - 1) / BoundsBucket, leaves - 1);
+    for (int b = firstBucket; b <= lastBucket && first <= last; b++)
+    {
+        Bounds bounds;
+        for (int j = b * BoundsBucket + 1; j <= qMin(segments, (b + 1) * BoundsBucket); j++)
+        {
+            bounds.unite(segmentBounds(pointAt(j), pointAt(j - 1)));
+        }
+        m_bounds[leaves + b] = bounds;
+    }
+    for (int lo = (leaves + firstBucket) >> 1, hi = (leaves + lastBucket) >> 1; lo >= 1 && first <= last; lo >>= 1, hi >>= 1)
+    {
+        for (int node = lo; node <= hi; node++)
+        {
+            Bounds bounds = m_bounds.at(2 * node);
+            bounds.unite(m_bounds.at(2 * node + 1));
+            m_bounds[node] = bounds;
+        }
+    }
+    m_boundsSegments = segments;
+    m_boundsFrom = INT_MAX;
+    m_boundsTo = -1;
+}
+
+void CurveLines::findCrossings(int node, float y, int limit, QVector<float> &xs)
+{
+    const Bounds& bounds = m_bounds.at(node);
+    if (xs.size() >= limit || !(bounds.low <= y && y <= bounds.high))
+    {
+        return;
+    }
+    if (node >= m_boundsLeaves)
+    {
+        const int first = (node - m_boundsLeaves) * BoundsBucket + 1;
+        for (int i = first; i < qMin(pointsSize(), first + BoundsBucket) && xs.size() < limit; i++)
+        {
+            const Bounds segment = segmentBounds(pointAt(i), pointAt(i - 1));
+            if (segment.low <= y && y <= segment.high)
+            {
+                segmentCrossings(i, y, xs);
+            }
+        }
+        if (xs.size() > limit)
+        {
+            xs.resize(limit);
+        }
+        return;
+    }
+    findCrossings(2 * node, y, limit, xs);
+    findCrossings(2 * node + 1, y, limit, xs);
+}
+
+void CurveLines::segmentCrossings(int i, float y, QVector<float> &xs)
+{
+    // Each segment answers for (x[i-1], x[i]]; the first one also for its
+    // start.
+    const CurvePoint point = pointAt(i);
+    const CurvePoint pointd = pointAt(i - 1);
+    const double x0 = pointd.pos.x();
+    const double y0 = pointd.pos.y();
+    const double x1 = point.pos.x();
+    const double y1 = point.pos.y();
+    if (point.type == CurvePoint::Line)
+    {
+        if (y0 == y1)
+        {
+            if (y == y0 && i == 1)
+            {
+                xs.append(pointd.pos.x());
+            }
+            return;
+        }
+        const double s = (y - y0) / (y1 - y0);
+        if ((s > 0 && s <= 1) || (s == 0 && i == 1))
+        {
+            xs.append(static_cast<float>(x0 + s * (x1 - x0)));
+        }
+        return;
+    }
+    else if (point.type == CurvePoint::Curve)
+    {
+        // y(t) - y as a cubic in t, roots isolated between the turning
+        // points and bisected. t runs from point (0) back to pointd (1).
+        const double cy = point.pos2.y();
+        const double c[4] = { y1 - y, 3 * (cy - y1), 3 * (y1 - cy), y0 - y1 };
+        double bounds[4] = { 0, 0, 0, 1 };
+        int count = 1;
+        const double a = 3 * c[3];
+        const double b = 2 * c[2];
+        if (a != 0)
+        {
+            const double d = b * b - 4 * a * c[1];
+            if (d > 0)
+            {
+                const double r0 = (-b - std::sqrt(d)) / (2 * a);
+                const double r1 = (-b + std::sqrt(d)) / (2 * a);
+                for (double r : { qMin(r0, r1), qMax(r0, r1) })
+                {
+                    if (r > 0 && r < 1)
+                    {
+                        bounds[count++] = r;
+                    }
+                }
+            }
+        }
+        else if (b != 0)
+        {
+            const double r = -c[1] / b;
+            if (r > 0 && r < 1)
+            {
+                bounds[count++] = r;
+            }
+        }
+        bounds[count] = 1;
+        double roots[4];
+        int found = 0;
+        for (int k = 0; k < count; k++)
+        {
+            double lo = bounds[k];
+            double hi = bounds[k + 1];
+            double flo = ((c[3] * lo + c[2]) * lo + c[1]) * lo + c[0];
+            double fhi = ((c[3] * hi + c[2]) * hi + c[1]) * hi + c[0];
+            if (flo == 0)
+            {
+                roots[found++] = lo;
+                continue;
+            }
+            if ((flo < 0) == (fhi < 0) || fhi == 0)
+            {
+                continue;
+            }
+            for (int step = 0; step < 60 && lo < hi; step++)
+            {
+                const double mid = (lo + hi) / 2;
+                const double f = ((c[3] * mid + c[2]) * mid + c[1]) * mid + c[0];
+                if ((f < 0) == (flo < 0))
+                {
+                    lo = mid;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+            roots[found++] = (lo + hi) / 2;
+        }
+        if (((c[3] + c[2]) + c[1]) + c[0] == 0)
+        {
+            roots[found++] = 1;
+        }
+        const double cx = point.pos2.x();
+        for (int k = found - 1; k >= 0; k--)
+        {
+            const double t = roots[k];
+            if (t < 1 || i == 1)
+            {
+                xs.append(static_cast<float>((((x0 - x1) * t + 3 * (x1 - cx)) * t + 3 * (cx - x1)) * t + x1));
+            }
+        }
+        return;
+    }
+    // A step holds y1 over the whole segment; only after the first point
+    // is there a value before it to jump from.
+    if (i == 1 ? y == y1 : qMin(y0, y1) <= y && y <= qMax(y0, y1) && y != y0)
+    {
+        xs.append(pointd.pos.x());
+    }
+}
+
+int CurveLines::hitSegment(const QVector2D &pos, float distance, float &t, QVector2D &nearest)
+{
+    int segment = 0;
+    if (pointsSize() < 2)
+    {
+        return segment;
+    }
+    updateBounds();
+    findHit(1, pos, distance, segment, t, nearest);
+    return segment;
+}
+
+int CurveLines::splitSegment(int i, float t)
+{
+    if (i < 1 || i >= pointsSize())
+    {
+        return -1;
+    }
+    t = qBound(0.0f, t, 1.0f);
+    const CurvePoint point = pointAt(i);
+    const CurvePoint pointd = pointAt(i - 1);
+    CurvePoint inserted(evaluate(t, point, pointd), point.type);
+    QVector2D pos2 = point.pos2;
+    if (point.type == CurvePoint::Curve)
+    {
+        // de Casteljau at t. Each half comes out with two control points of
+        // its own, and a point holds one for both. Their mean keeps the
+        // ends, the midpoint and the outer end's tangent of each half, and
+        // is the closest single control point over the rest.
+        const QVector2D& A = point.pos;
+        const QVector2D& C = point.pos2;
+        const QVector2D& B = pointd.pos;
+        const QVector2D l0 = A + (C - A) * t;
+        const QVector2D l2 = C + (B - C) * t;
+        const QVector2D m0 = l0 + (C - l0) * t;
+        const QVector2D m1 = C + (l2 - C) * t;
+        inserted.pos = m0 + (m1 - m0) * t;
+        inserted.pos2 = (m1 + l2) / 2;
+        pos2 = (l0 + m0) / 2;
+    }
+    else
+    {
+        if (point.type != CurvePoint::Line)
+        {
+            // A step holds the point's value over the whole run.
+            inserted.pos = QVector2D(point.pos.x() + (pointd.pos.x() - point.pos.x()) * t, point.pos.y());
+        }
+        inserted.pos2 = (inserted.pos + pointd.pos) / 2;
+    }
+
+    CurveLinesBatch batch(*this);
+    const int size = pointsSize();
+    insertPoints(QVector<qint32>() << i, QVector<CurvePoint>() << inserted);
+    // A full stream dropped its oldest point to make room.
+    const int index = pointsSize() > size ? i : i - 1;
+    Edit insert(Edit::Edit_Insert);
+    insert.fields.append(index);
+    recordEdit(insert);
+    if (pos2 != point.pos2)
+    {
+        Edit move(Edit::Edit_Move);
+        move.fields.append((index + 1) << 1 | 1);
+        move.values.append(point.pos2);
+        pointRef(index + 1).pos2 = pos2;
+        recordEdit(move);
+    }
+    updatePoints();
+    return index;
+}
+
+void CurveLines::findHit(int node, const QVector2D &pos, float &distance, int &segment, float &t, QVector2D &nearest)
+{
+    if (m_bounds.at(node).distance(pos) > distance)
+    {
+        return;
+    }
+    if (node >= m_boundsLeaves)
+    {
+        const int first = (node - m_boundsLeaves) * BoundsBucket + 1;
+        for (int i = first; i < qMin(pointsSize(), first + BoundsBucket); i++)
+        {
+            const CurvePoint point = pointAt(i);
+            const CurvePoint pointd = pointAt(i - 1);
+            if (segmentBounds(point, pointd).distance(pos) > distance)
+            {
+                continue;
+            }
+            float at;
+            QVector2D near;
+            const float d = segmentHit(pos, point, pointd, at, near);
+            if (d <= distance)
+            {
+                distance = d;
+                segment = i;
+                t = at;
+                nearest = near;
+            }
+        }
+        return;
+    }
+    // The nearer child first, so the other one is more often pruned.
+    const int a = 2 * node;
+    const int b = 2 * node + 1;
+    const bool swap = m_bounds.at(b).distance(pos) < m_bounds.at(a).distance(pos);
+    findHit(swap ? b : a, pos, distance, segment, t, nearest);
+    findHit(swap ? a : b, pos, distance, segment, t, nearest);
+}
+
+float CurveLines::segmentHit(const QVector2D &pos, const CurvePoint &point, const CurvePoint &pointd, float &t, QVector2D &nearest)
+{
+    if (point.type == CurvePoint::Curve)
+    {
+        // Flatten the segment, then run Newton on (B(t) - pos) . B'(t) = 0
+        // from both edges around every vertex closer than its neighbours.
+        const double ax = point.pos.x(), ay = point.pos.y();
+        const double cx = point.pos2.x(), cy = point.pos2.y();
+        const double bx = pointd.pos.x(), by = pointd.pos.y();
+        const double x3 = bx - ax, x2 = 3 * (ax - cx), x1 = 3 * (cx - ax);
+        const double y3 = by - ay, y2 = 3 * (ay - cy), y1 = 3 * (cy - ay);
+        const double px = pos.x() - ax;
+        const double py = pos.y() - ay;
+        auto squared = [&](double u) {
+            const double dx = ((x3 * u + x2) * u + x1) * u - px;
+            const double dy = ((y3 * u + y2) * u + y1) * u - py;
+            return dx * dx + dy * dy;
+        };
+        double samples[HitSteps + 1];
+        for (int k = 0; k <= HitSteps; k++)
+        {
+            samples[k] = squared(static_cast<double>(k) / HitSteps);
+        }
+        double best = 0;
+        double bestSquared = samples[0];
+        for (int k = 0; k <= HitSteps; k++)
+        {
+            if ((k > 0 && samples[k - 1] < samples[k]) || (k < HitSteps && samples[k + 1] < samples[k]))
+            {
+                continue;
+            }
+            const double vertex = static_cast<double>(k) / HitSteps;
+            for (double u : { vertex - 0.5 / HitSteps, vertex, vertex + 0.5 / HitSteps })
+            {
+                u = qBound(0.0, u, 1.0);
+                for (int step = 0; step < 8; step++)
+                {
+                    const double dx = ((x3 * u + x2) * u + x1) * u - px;
+                    const double dy = ((y3 * u + y2) * u + y1) * u - py;
+                    const double ex = (3 * x3 * u + 2 * x2) * u + x1;
+                    const double ey = (3 * y3 * u + 2 * y2) * u + y1;
+                    const double fx = 6 * x3 * u + 2 * x2;
+                    const double fy = 6 * y3 * u + 2 * y2;
+                    const double g = dx * ex + dy * ey;
+                    const double h = ex * ex + ey * ey + dx * fx + dy * fy;
+                    if (h <= 0)
+                    {
+                        break;
+                    }
+                    u = qBound(0.0, u - g / h, 1.0);
+                }
+                const double d = squared(u);
+                if (d < bestSquared)
+                {
+                    best = u;
+                    bestSquared = d;
+                }
+            }
+        }
+        t = static_cast<float>(best);
+        nearest = QVector2D(static_cast<float>(((x3 * best + x2) * best + x1) * best + ax),
+                            static_cast<float>(((y3 * best + y2) * best + y1) * best + ay));
+        return static_cast<float>(std::sqrt(bestSquared));
+    }
+    // A line from the point back to the previous one; a step runs level
+    // at the point's value.
+    const QVector2D A = point.pos;
+    const QVector2D B = point.type == CurvePoint::Line ? pointd.pos : QVector2D(pointd.pos.x(), A.y());
+    const QVector2D AB = B - A;
+    const float length = QVector2D::dotProduct(AB, AB);
+    t = length > 0 ? qBound(0.0f, QVector2D::dotProduct(pos - A, AB) / length, 1.0f) : 0.0f;
+    nearest = A + AB * t;
+    return (pos - nearest).length();
+}
+
+CurveLines::Bounds CurveLines::segmentBounds(const CurvePoint &point, const CurvePoint &pointd)
+{
+    // A step also spans the jump into it, for crossings(); a cubic stays
+    // inside the hull of its control points.
+    Bounds bounds;
+    bounds.left = qMin(point.pos.x(), pointd.pos.x());
+    bounds.right = qMax(point.pos.x(), pointd.pos.x());
+    bounds.low = qMin(point.pos.y(), pointd.pos.y());
+    bounds.high = qMax(point.pos.y(), pointd.pos.y());
+    if (point.type == CurvePoint::Curve)
+    {
+        bounds.left = qMin(bounds.left, point.pos2.x());
+        bounds.right = qMax(bounds.right, point.pos2.x());
+        bounds.low = qMin(bounds.low, point.pos2.y());
+        bounds.high = qMax(bounds.high, point.pos2.y());
+    }
+    return bounds;
+}
+
+void CurveLines::Stats::unite(const CurveLines::Stats &stats)
+{
+    min = qMin(min, stats.min);
+    max = qMax(max, stats.max);
+    sum += stats.sum;
+    unsorted += stats.unsorted;
+}
+
+void CurveLines::Bounds::unite(const CurveLines::Bounds &bounds)
+{
+    left = qMin(left, bounds.left);
+    right = qMax(right, bounds.right);
+    low = qMin(low, bounds.low);
+    high = qMax(high, bounds.high);
+}
+
+float CurveLines::Bounds::distance(const QVector2D &pos) const
+{
+    if (left > right)
+    {
+        return FLT_MAX;
+    }
+    const float dx = qMax(qMax(left - pos.x(), pos.x() - right), 0.0f);
+    const float dy = qMax(qMax(low - pos.y(), pos.y() - high), 0.0f);
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+double CurveLines::prefixArea(int i)
+{
+    double sum = 0;
+    for (; i > 0; i -= i & -i)
+    {
+        sum += m_areas.at(i);
+    }
+    return sum;
+}
+
+double CurveLines::segmentArea(int i)
+{
+    const CurvePoint point = pointAt(i);
+    const CurvePoint pointd = pointAt(i - 1);
+    if (point.type == CurvePoint::Curve)
+    {
+        // The whole sweep, t from 1 back to 0, without solving for t.
+        return -curveArea(1.0f, point, pointd);
+    }
+    return segmentArea(point.pos.x(), point, pointd);
 }
 
-int CurveLines::pointsDragSize()
+CurveSnapshotPtr CurveLines::publishSnapshot()
 {
-    int count = 0;
-    for (int i = 0; i < m_points.size(); i++)
+    if (m_updateDepth == 0 || !m_snapshot)
     {
-        if(m_points[i].touch)
-        {
-            m_points[i].drag = true;
-            count++;
-        }
-        if(m_points[i].touch2)
+        buildSnapshot();
+    }
+    return m_snapshot;
+}
+
+CurveSnapshotPtr CurveLines::snapshot() const
+{
+    return std::atomic_load(&m_snapshot);
+}
+
+void CurveLines::setStreaming(int capacity)
+{
+    QVector<CurvePoint> points;
+    if (m_streaming)
+    {
+        points = m_stream->points();
+    }
+    else if (m_mapped)
+    {
+        points.reserve(pointsSize());
+        for (int i = 0; i < pointsSize(); i++)
         {
-            m_points[i].drag2 = true;
-            count++;
+            points.append(pointAt(i));
         }
     }
-    return count;
+    else
+    {
+        points = m_points;
+    }
+    m_overlay->close();
+    m_mapped = false;
+    m_streaming = capacity > 0;
+    m_stream->setCapacity(qMax(0, capacity));
+    if (m_streaming)
+    {
+        m_stream->assign(points);
+        m_points.clear();
+    }
+    else
+    {
+        m_points = points;
+    }
+    markChanged(0);
+    clearUndo();
+    updatePoints();
 }
 
-void CurveLines::insertPoint(const CurvePoint &point)
+int CurveLines::streamCapacity()
 {
-    int index = m_points.size();
-//    for (int i = 0; i < m_points.size(); i++)
-//    {
-//        if(m_points[i] == point)
-//        {
-//            m_points[i] = point;
-//            index = i;
-//            break;
-//        }
-//        else if (m_points[i] > point)
-//        {
-//            m_points.insert(i, point);
-//            index = i;
-//            break;
-//        }
-//    }
-//    if(index == m_points.size())
-//    {
-        m_points.append(point);
-//    }
+    return m_streaming ? m_stream->capacity() : 0;
+}
 
-    if(m_points[index].pos == m_points[index].pos2 && index > 0)
+void CurveLines::streamPoint(const CurvePoint &point)
+{
+    if (!m_streaming)
     {
-        QVector2D pos2 = (m_points[index].pos + m_points[index - 1].pos) / 2;
-        m_points[index].pos2 = pos2;
+        insertPoint(point);
+        return;
     }
-    updatePoints();
+    if (m_stream->append(point))
+    {
+        markChanged(0);
+        m_streamDropped++;
+    }
+    else
+    {
+        markChanged(pointsSize() - 1);
+    }
+    m_streamed.append(point);
+    if (m_streamed.size() > 2 * m_stream->capacity())
+    {
+        // Listeners append before dropping, so points that came and went
+        // inside one batch can be left out of both.
+        const int extra = m_streamed.size() - m_stream->capacity();
+        m_streamed.remove(0, extra);
+        m_streamDropped -= extra;
+    }
+    if (m_updateDepth > 0)
+    {
+        m_sorted = m_sorted && m_stream->sorted();
+        return;
+    }
+    flushStream();
 }
 
-void CurveLines::selectPoints()
+void CurveLines::streamPoints(const QVector<CurvePoint> &points)
 {
-    for (int i = 0; i < m_points.size(); i++)
+    CurveLinesBatch batch(*this);
+    for (int i = 0; i < points.size(); i++)
     {
-        m_points[i].drag = false;
-        m_points[i].touch = true;
-        m_points[i].drag2 = false;
-        m_points[i].touch2 = true;
+        streamPoint(points.at(i));
     }
 }
 
-void CurveLines::releasePoints()
+void CurveLines::flushStream()
+{
+    updateStats();
+    QVector<CurvePoint> points;
+    points.swap(m_streamed);
+    const int dropped = m_streamDropped;
+    m_streamDropped = 0;
+    emit appendCurve(points, dropped);
+}
+
+float CurveLines::getValue(float x)
 {
-    for (int i = 0; i < m_points.size(); i++)
+    int i = findSegment(x);
+    if (i > 0)
+    {
+        return segmentValue(i, x);
+    }
+    if (pointsSize() == 1 && pointX(0) == x)
     {
-        m_points[i].drag = false;
-        m_points[i].touch = false;
-        m_points[i].drag2 = false;
-        m_points[i].touch2 = false;
+        return pointAt(0).pos.y();
     }
+    return 0;
 }
 
-void CurveLines::updatePoints()
+void CurveLines::getValues(const float *xs, float *ys, int count)
 {
-    if(m_points.size())
+    if (!m_sorted || pointsSize() < 2)
     {
-        float min = FLT_MAX;
-        float max = -FLT_MAX;
-        float average = 0;
-        for (int i = 0; i < m_points.size(); i++)
+        for (int k = 0; k < count; k++)
         {
-            min = qMin(min, m_points[i].pos.y());
-            max = qMax(max, m_points[i].pos.y());
-            average += m_points[i].pos.y();
+            ys[k] = getValue(xs[k]);
         }
-        m_min = min;
-        m_max = max;
-        m_average = average / m_points.size();
+        return;
     }
-    emit updateCurve(m_points);
-}
 
-float CurveLines::getValue(float x)
-{
-    for (int i = 0; i < m_points.size(); i++)
+    // Sorted curve: walk a segment cursor forward and only fall back to a
+    // binary search when the sample grid steps backwards.
+    const int n = pointsSize();
+    const float first = pointX(0);
+    const float last = pointX(n - 1);
+    int i = 1;
+    float cursor = first;
+    for (int k = 0; k < count; k++)
     {
-        if ((m_points[i].pos.x() - x) <= 0.01f)
+        float x = xs[k];
+        if (!(x >= first && x <= last))
         {
-            return m_points[i].pos.y();
+            ys[k] = 0;
+            continue;
         }
-        if (i > 0)
+        if (x < cursor)
         {
-            const CurvePoint& point = currentPoint(i);
-            const CurvePoint& pointd = evaluatePoint(i);
-            if (point.pos.x() < x && pointd.pos.x() > x)
-            {
-                float ox = point.pos.x() - pointd.pos.x();
-                float t = (x - pointd.pos.x()) / ox;
-                return evaluate(i, t).y();
-            }
+            i = findSegment(x);
+        }
+        cursor = x;
+        while (i < n - 1 && pointX(i) < x)
+        {
+            i++;
         }
+        ys[k] = segmentValue(i, x);
     }
-    return 0;
+}
+
+QVector<float> CurveLines::getValues(const QVector<float> &xs)
+{
+    QVector<float> ys(xs.size());
+    getValues(xs.constData(), ys.data(), xs.size());
+    return ys;
 }
 
 float CurveLines::getMinValue()
@@ -168,19 +1466,83 @@ float CurveLines::getAverageValue()
     return m_average;
 }
 
+double CurveLines::integral(float x0, float x1)
+{
+    return cumulativeArea(x1) - cumulativeArea(x0);
+}
+
+double CurveLines::cumulativeArea(float x)
+{
+    const int n = pointsSize();
+    if (n < 2)
+    {
+        return 0;
+    }
+    updateAreas();
+    if (!m_sorted)
+    {
+        // Along the path: each segment adds the part of its sweep that lies
+        // left of x, signed by the direction it runs in.
+        double area = 0;
+        for (int i = 1; i < n; i++)
+        {
+            const float a = pointX(i - 1);
+            const float b = pointX(i);
+            if (x <= qMin(a, b))
+            {
+                continue;
+            }
+            if (x >= qMax(a, b))
+            {
+                area += m_segmentAreas.at(i);
+            }
+            else
+            {
+                const double part = segmentArea(x, pointAt(i), pointAt(i - 1));
+                area += a < b ? part : m_segmentAreas.at(i) - part;
+            }
+        }
+        return area;
+    }
+    if (!(x > pointX(0)))
+    {
+        return 0;
+    }
+    if (x >= pointX(n - 1))
+    {
+        return prefixArea(n - 1);
+    }
+    int i = findSegment(x);
+    return prefixArea(i - 1) + segmentArea(x, pointAt(i), pointAt(i - 1));
+}
+
+QVector<float> CurveLines::crossings(float y, int limit)
+{
+    QVector<float> xs;
+    if (pointsSize() < 2 || limit <= 0)
+    {
+        return xs;
+    }
+    updateBounds();
+    findCrossings(1, y, limit, xs);
+    return xs;
+}
+
 int CurveLines::touchPoints(const QRectF &rect)
 {
+    m_editSealed = true;
     int count = 0;
-    for (int i = 0; i < m_points.size(); i++)
+    for (int i = nextInside(0, rect); i < pointsSize(); i = nextInside(i + 1, rect))
     {
-        if(rect.contains(m_points[i].pos.toPointF()))
+        CurvePoint point = pointAt(i);
+        if(rect.contains(point.pos.toPointF()))
         {
-            m_points[i].touch = true;
+            pointRef(i).touch = true;
             count++;
         }
-        if(rect.contains(m_points[i].pos2.toPointF()))
+        if(rect.contains(point.pos2.toPointF()))
         {
-            m_points[i].touch2 = true;
+            pointRef(i).touch2 = true;
             count++;
         }
     }
@@ -198,53 +1560,73 @@ int CurveLines::touchPoints(const QVector2D &pos, float scale)
 
 void CurveLines::findTouchPoint(const QVector2D &pos)
 {
+    m_editSealed = true;
     int index = 0;
     float min = FLT_MAX;
-    for (int i = 0; i < m_points.size(); i++)
+    for (int i = nextEdited(-1); i < pointsSize(); i = nextEdited(i))
     {
-        m_points[i].touch = false;
-        QVector2D d = pos - m_points[i].pos;
+        pointRef(i).touch = false;
+    }
+    for (int i = 0; i < pointsSize(); i++)
+    {
+        QVector2D d = pos - pointAt(i).pos;
         if(min > d.length())
         {
             min = d.length();
             index = i;
         }
     }
-    if(index < m_points.size())
+    if(index < pointsSize())
+    {
+        pointRef(index).touch = true;
+    }
+}
+
+bool CurveLines::touchRange(float &from, float &to)
+{
+    bool found = false;
+    for (int i = nextEdited(-1); i < pointsSize(); i = nextEdited(i))
     {
-        m_points[index].touch = true;
+        const CurvePoint point = pointAt(i);
+        if (point.touch || point.touch2)
+        {
+            from = found ? qMin(from, point.pos.x()) : point.pos.x();
+            to = found ? qMax(to, point.pos.x()) : point.pos.x();
+            found = true;
+        }
     }
+    return found;
 }
 
 void CurveLines::leftTouchPoint(CurveLines::TouchType type)
 {
     switch (type) {
     case Touch_Move:
-        for (int i = 1; i < m_points.size(); i++)
+        for (int i = nextEdited(0); i < pointsSize(); i = nextEdited(i))
         {
-            if(m_points[i].touch)
+            if(pointRef(i).touch)
             {
-                m_points[i].touch = false;
-                m_points[i-1].touch = true;
+                pointRef(i).touch = false;
+                pointRef(i-1).touch = true;
             }
         }
         break;
     case Touch_Add:
-        for (int i = 1; i < m_points.size(); i++)
+        for (int i = nextEdited(0); i < pointsSize(); i = nextEdited(i))
         {
-            if(m_points[i].touch)
+            if(pointRef(i).touch)
             {
-                m_points[i-1].touch = true;
+                pointRef(i-1).touch = true;
             }
         }
         break;
     case Touch_Take:
         bool flag = true;
-        for (int i = 0; i < m_points.size(); i++)
+        for (int i = nextEdited(-1); i < pointsSize(); i = nextEdited(i))
         {
-            if(m_points[i].touch)
+            if(pointRef(i).touch)
             {
-                m_points[i].touch = flag;
+                pointRef(i).touch = flag;
                 flag = false;
             }
         }
@@ -256,31 +1638,31 @@ void CurveLines::rightTouchPoint(CurveLines::TouchType type)
 {
     switch (type) {
     case Touch_Move:
-        for (int i = m_points.size() - 1; i > 0; i--)
+        for (int i = previousEdited(pointsSize() - 1); i >= 0; i = previousEdited(i))
         {
-            if(m_points[i-1].touch)
+            if(pointRef(i).touch)
             {
-                m_points[i-1].touch = false;
-                m_points[i].touch = true;
+                pointRef(i).touch = false;
+                pointRef(i+1).touch = true;
             }
         }
         break;
     case Touch_Add:
-        for (int i = m_points.size() - 1; i > 0; i--)
+        for (int i = previousEdited(pointsSize() - 1); i >= 0; i = previousEdited(i))
         {
-            if(m_points[i-1].touch)
+            if(pointRef(i).touch)
             {
-                m_points[i].touch = true;
+                pointRef(i+1).touch = true;
             }
         }
         break;
     case Touch_Take:
         bool flag = true;
-        for (int i = m_points.size() - 1; i >= 0; i--)
+        for (int i = previousEdited(pointsSize()); i >= 0; i = previousEdited(i))
         {
-            if(m_points[i].touch)
+            if(pointRef(i).touch)
             {
-                m_points[i].touch = flag;
+                pointRef(i).touch = flag;
                 flag = false;
             }
         }
@@ -290,154 +1672,286 @@ void CurveLines::rightTouchPoint(CurveLines::TouchType type)
 
 int CurveLines::deleteTouchPoint()
 {
+    Edit edit(Edit::Edit_Remove);
     int count = 0;
-    for (int i = 0; i < m_points.size(); i++)
+    for (int i = nextEdited(-1); i < pointsSize(); i = nextEdited(i))
     {
-        if(m_points[i].touch)
+        if(pointRef(i).touch)
         {
-            m_points.removeAt(i--);
+            edit.fields.append(i + count);
+            edit.points.append(pointAt(i));
+            removePoint(i--);
             count++;
         }
     }
+    recordEdit(edit);
     updatePoints();
     return count;
 }
 
 int CurveLines::ceilTouchPoint(CurveLines::MoveType type)
 {
+    Edit edit(Edit::Edit_Move);
     int count = 0;
-    for (int i = 0; i < m_points.size(); i++)
+    for (int i = nextEdited(-1); i < pointsSize(); i = nextEdited(i))
     {
-        if(m_points[i].touch)
+        CurvePoint& point = pointRef(i);
+        if(point.touch)
         {
+            edit.fields.append(i << 1);
+            edit.values.append(point.pos);
             switch (type) {
             case X_Axis:
-                m_points[i].pos.setX(ceilf(m_points[i].pos.x()));
+                point.pos.setX(ceilf(point.pos.x()));
                 break;
             case Y_Axis:
-                m_points[i].pos.setY(ceilf(m_points[i].pos.y()));
+                point.pos.setY(ceilf(point.pos.y()));
                 break;
             default:
-                m_points[i].pos.setX(ceilf(m_points[i].pos.x()));
-                m_points[i].pos.setY(ceilf(m_points[i].pos.y()));
+                point.pos.setX(ceilf(point.pos.x()));
+                point.pos.setY(ceilf(point.pos.y()));
                 break;
             }
             count++;
         }
     }
+    recordEdit(edit);
     updatePoints();
     return count;
 }
 
 int CurveLines::floorTouchPoint(CurveLines::MoveType type)
 {
+    Edit edit(Edit::Edit_Move);
     int count = 0;
-    for (int i = 0; i < m_points.size(); i++)
+    for (int i = nextEdited(-1); i < pointsSize(); i = nextEdited(i))
     {
-        if(m_points[i].touch)
+        CurvePoint& point = pointRef(i);
+        if(point.touch)
         {
+            edit.fields.append(i << 1);
+            edit.values.append(point.pos);
             switch (type) {
             case X_Axis:
-                m_points[i].pos.setX(floorf(m_points[i].pos.x()));
+                point.pos.setX(floorf(point.pos.x()));
                 break;
             case Y_Axis:
-                m_points[i].pos.setY(floorf(m_points[i].pos.y()));
+                point.pos.setY(floorf(point.pos.y()));
                 break;
             default:
-                m_points[i].pos.setX(floorf(m_points[i].pos.x()));
-                m_points[i].pos.setY(floorf(m_points[i].pos.y()));
+                point.pos.setX(floorf(point.pos.x()));
+                point.pos.setY(floorf(point.pos.y()));
                 break;
             }
             count++;
         }
     }
+    recordEdit(edit);
     updatePoints();
     return count;
 }
 
 int CurveLines::moveTouchPoint(const QVector2D &offset, CurveLines::MoveType type)
 {
+    Edit edit(Edit::Edit_Move);
     int count = 0;
-    for (int i = 0; i < m_points.size(); i++)
+    for (int i = nextEdited(-1); i < pointsSize(); i = nextEdited(i))
     {
-        if(m_points[i].touch)
+        CurvePoint& point = pointRef(i);
+        if(point.touch)
         {
+            edit.fields.append(i << 1);
+            edit.values.append(point.pos);
             switch (type) {
             case X_Axis:
-                m_points[i].pos.setX(m_points[i].pos.x() + offset.x());
+                point.pos.setX(point.pos.x() + offset.x());
                 break;
             case Y_Axis:
-                m_points[i].pos.setY(m_points[i].pos.y() + offset.y());
+                point.pos.setY(point.pos.y() + offset.y());
                 break;
             default:
-                m_points[i].pos += offset;
+                point.pos += offset;
                 break;
             }
             count++;
         }
-        if(m_points[i].touch2)
+        if(point.touch2)
         {
-            m_points[i].pos2 += offset;
+            edit.fields.append(i << 1 | 1);
+            edit.values.append(point.pos2);
+            point.pos2 += offset;
             count++;
         }
     }
+    recordEdit(edit);
     updatePoints();
     return count;
 }
 
 int CurveLines::moveDragPoint(const QVector2D &offset, CurveLines::MoveType type)
 {
+    Edit edit(Edit::Edit_Move);
+    edit.drag = true;
     int count = 0;
-    for (int i = 0; i < m_points.size(); i++)
+    for (int i = nextEdited(-1); i < pointsSize(); i = nextEdited(i))
     {
-        if(m_points[i].drag)
+        CurvePoint& point = pointRef(i);
+        if(point.drag)
         {
+            edit.fields.append(i << 1);
+            edit.values.append(point.pos);
             switch (type) {
             case X_Axis:
-                m_points[i].pos.setX(m_points[i].pos.x() + offset.x());
+                point.pos.setX(point.pos.x() + offset.x());
                 break;
             case Y_Axis:
-                m_points[i].pos.setY(m_points[i].pos.y() + offset.y());
+                point.pos.setY(point.pos.y() + offset.y());
                 break;
             default:
-                m_points[i].pos += offset;
+                point.pos += offset;
                 break;
             }
             count++;
         }
-        if(m_points[i].drag2)
+        if(point.drag2)
         {
-            m_points[i].pos2 += offset;
+            edit.fields.append(i << 1 | 1);
+            edit.values.append(point.pos2);
+            point.pos2 += offset;
             count++;
         }
     }
+    recordEdit(edit);
     updatePoints();
     return count;
 }
 
+int CurveLines::transformPoints(const QVector2D &scale, const QVector2D &pivot, const QVector2D &offset)
+{
+    Transform transform;
+    transform.scale = scale;
+    transform.shift = pivot - pivot * scale + offset;
+    return transformSelection(transform);
+}
+
+int CurveLines::quantizePoints(const QVector2D &grid, const QVector2D &origin)
+{
+    Transform transform;
+    transform.step = QVector2D(qMax(0.0f, grid.x()), qMax(0.0f, grid.y()));
+    transform.origin = origin;
+    return transformSelection(transform);
+}
+
+int CurveLines::clampPoints(const QRectF &rect)
+{
+    Transform transform;
+    const QRectF bounds = rect.normalized();
+    transform.low = QVector2D(static_cast<float>(bounds.left()), static_cast<float>(bounds.top()));
+    transform.high = QVector2D(static_cast<float>(bounds.right()), static_cast<float>(bounds.bottom()));
+    return transformSelection(transform);
+}
+
+int CurveLines::transformSelection(const CurveLines::Transform &transform)
+{
+    // Gather the selected fields into one x and one y array, transform
+    // those in blocks, then keep the old value of every field that moved
+    // as a single undo step.
+    QVector<qint32> fields;
+    QVector<float> xs;
+    QVector<float> ys;
+    for (int i = nextEdited(-1); i < pointsSize(); i = nextEdited(i))
+    {
+        const CurvePoint point = pointAt(i);
+        if (point.touch)
+        {
+            fields.append(i << 1);
+            xs.append(point.pos.x());
+            ys.append(point.pos.y());
+        }
+        if (point.touch || point.touch2)
+        {
+            fields.append(i << 1 | 1);
+            xs.append(point.pos2.x());
+            ys.append(point.pos2.y());
+        }
+    }
+    if (fields.isEmpty())
+    {
+        return 0;
+    }
+    const QVector<float> oldXs = xs;
+    const QVector<float> oldYs = ys;
+
+    // The in-memory points are written back by the blocks themselves; the
+    // other storages go through pointRef() below.
+    CurvePoint* points = nullptr;
+    if (!m_mapped && !m_streaming)
+    {
+        markChanged(fields.first() >> 1, fields.last() >> 1);
+        points = m_points.data();
+    }
+    const int count = fields.size();
+    const int blocks = (count + TransformBlock - 1) / TransformBlock;
+    const int workers = count < TransformParallelMin ? 0 : qMin(QThread::idealThreadCount() - 1, blocks - 1);
+    std::atomic<int> next(0);
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, workers));
+    for (int t = 0; t < workers; t++)
+    {
+        pool.start(new TransformTask(transform, fields.constData(), xs.data(), ys.data(), count, points, next));
+    }
+    TransformTask(transform, fields.constData(), xs.data(), ys.data(), count, points, next).run();
+    pool.waitForDone();
+
+    Edit edit(Edit::Edit_Move);
+    for (int k = 0; k < count; k++)
+    {
+        if (xs.at(k) == oldXs.at(k) && ys.at(k) == oldYs.at(k))
+        {
+            continue;
+        }
+        edit.fields.append(fields.at(k));
+        edit.values.append(QVector2D(oldXs.at(k), oldYs.at(k)));
+        if (!points)
+        {
+            CurvePoint& point = pointRef(fields.at(k) >> 1);
+            ((fields.at(k) & 1) ? point.pos2 : point.pos) = QVector2D(xs.at(k), ys.at(k));
+        }
+    }
+    const int changed = edit.fields.size();
+    recordEdit(edit);
+    updatePoints();
+    return changed;
+}
+
+CurvePoint CurveLines::pointAt(int i)
+{
+    return m_mapped ? m_overlay->point(i) : m_streaming ? m_stream->at(i) : m_points.at(i);
+}
+
 CurvePoint &CurveLines::firstPoint()
 {
-    return m_points.first();
+    return pointRef(0);
 }
 
 CurvePoint &CurveLines::lastPoint()
 {
-    return m_points.last();
+    return pointRef(pointsSize() - 1);
 }
 
 CurvePoint &CurveLines::currentPoint(int i)
 {
-    return m_points[i];
+    return pointRef(i);
 }
 
 CurvePoint &CurveLines::evaluatePoint(int i)
 {
-    return m_points[i-1];
+    return pointRef(i-1);
 }
 
 QVector2D CurveLines::evaluate(int i, float t)
 {
-    return evaluate(t, currentPoint(i), evaluatePoint(i));
+    return evaluate(t, pointAt(i), pointAt(i-1));
 }
 
 QVector2D CurveLines::evaluate(float t, const CurvePoint &point, const CurvePoint &pointd)
@@ -476,3 +1990,229 @@ QVector2D CurveLines::evaluate(float t, const CurvePoint &point, const CurvePoin
 
 
 
+
+int CurveLines::findSegment(float x)
+{
+    const int n = pointsSize();
+    if (n < 2)
+    {
+        return -1;
+    }
+    if (m_sorted)
+    {
+        if (!(x >= pointX(0) && x <= pointX(n - 1)))
+        {
+            return -1;
+        }
+        int low = 1;
+        int high = n - 1;
+        while (low < high)
+        {
+            int mid = (low + high) / 2;
+            if (pointX(mid) < x)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        return low;
+    }
+    for (int i = 1; i < n; i++)
+    {
+        float x0 = pointX(i-1);
+        float x1 = pointX(i);
+        if (qMin(x0, x1) <= x && x <= qMax(x0, x1))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+float CurveLines::segmentValue(int i, float x)
+{
+    return segmentValue(x, pointAt(i), pointAt(i-1));
+}
+
+float CurveLines::segmentValue(float x, const CurvePoint &point, const CurvePoint &pointd)
+{
+    if (point.type == CurvePoint::Line)
+    {
+        float ox = pointd.pos.x() - point.pos.x();
+        if (ox == 0.0f)
+        {
+            return point.pos.y();
+        }
+        return evaluate((x - point.pos.x()) / ox, point, pointd).y();
+    }
+    else if (point.type == CurvePoint::Curve)
+    {
+        return evaluate(curveParameter(x, point, pointd), point, pointd).y();
+    }
+    return point.pos.y();
+}
+
+double CurveLines::segmentArea(float x, const CurvePoint &point, const CurvePoint &pointd)
+{
+    const double x0 = pointd.pos.x();
+    if (point.type == CurvePoint::Line)
+    {
+        if (point.pos.x() == pointd.pos.x())
+        {
+            return 0;
+        }
+        return (x - x0) * (static_cast<double>(pointd.pos.y()) + segmentValue(x, point, pointd)) / 2;
+    }
+    else if (point.type == CurvePoint::Curve)
+    {
+        // evaluate() runs from point at t = 0 to pointd at t = 1.
+        return curveArea(curveParameter(x, point, pointd), point, pointd) - curveArea(1.0f, point, pointd);
+    }
+    return (x - x0) * point.pos.y();
+}
+
+double CurveLines::curveArea(float t, const CurvePoint &point, const CurvePoint &pointd)
+{
+    // Integral of y(t) x'(t) from 0 to t for the cubic in evaluate(); with
+    // both control points at pos2 the coefficients are as below.
+    const double ax = point.pos.x();
+    const double bx = pointd.pos.x();
+    const double cx = point.pos2.x();
+    const double ay = point.pos.y();
+    const double by = pointd.pos.y();
+    const double cy = point.pos2.y();
+    const double y[4] = { ay, 3 * (cy - ay), 3 * (ay - cy), by - ay };
+    const double dx[3] = { 3 * (cx - ax), 6 * (ax - cx), 3 * (bx - ax) };
+    double c[6] = { 0, 0, 0, 0, 0, 0 };
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            c[i + j] += y[i] * dx[j];
+        }
+    }
+    double area = 0;
+    for (int k = 5; k >= 0; k--)
+    {
+        area = (area + c[k] / (k + 1)) * t;
+    }
+    return area;
+}
+
+float CurveLines::curveParameter(float x, const CurvePoint &point, const CurvePoint &pointd)
+{
+    // x(t) = a3 t^3 + a2 t^2 + a1 t + a0 for the cubic in evaluate(),
+    // solved for t by Newton steps kept inside a bisection bracket.
+    const float A = point.pos.x();
+    const float B = pointd.pos.x();
+    const float C = point.pos2.x();
+    const float a3 = B - A;
+    const float a2 = 3.0f * (A - C);
+    const float a1 = 3.0f * (C - A);
+    const float a0 = A - x;
+    float low = 0.0f;
+    float high = 1.0f;
+    float flow = a0;
+    float t = (B != A) ? qBound(0.0f, (x - A) / (B - A), 1.0f) : 0.0f;
+    for (int k = 0; k < 32; k++)
+    {
+        float f = ((a3 * t + a2) * t + a1) * t + a0;
+        if (f == 0.0f)
+        {
+            break;
+        }
+        if ((f < 0) == (flow < 0))
+        {
+            low = t;
+            flow = f;
+        }
+        else
+        {
+            high = t;
+        }
+        float df = (3.0f * a3 * t + 2.0f * a2) * t + a1;
+        float next = (df != 0.0f) ? t - f / df : low;
+        if (next <= low || next >= high)
+        {
+            next = (low + high) * 0.5f;
+        }
+        if (qAbs(next - t) <= 1e-7f)
+        {
+            t = next;
+            break;
+        }
+        t = next;
+    }
+    return t;
+}
+
+float CurveLines::mappedX(int i)
+{
+    return m_overlay->x(i);
+}
+
+float CurveLines::streamX(int i)
+{
+    return m_stream->x(i);
+}
+
+CurvePoint &CurveLines::pointRef(int i)
+{
+    markChanged(i, i);
+    return m_mapped ? m_overlay->edit(i) : m_streaming ? m_stream->ref(i) : m_points[i];
+}
+
+int CurveLines::nextEdited(int i)
+{
+    return m_mapped ? m_overlay->nextCopied(i) : i + 1;
+}
+
+int CurveLines::previousEdited(int i)
+{
+    return m_mapped ? m_overlay->previousCopied(i) : i - 1;
+}
+
+int CurveLines::nextInside(int i, const QRectF &rect)
+{
+    return m_mapped ? m_overlay->nextInside(i, rect) : i;
+}
+
+void CurveLines::appendPoint(const CurvePoint &point)
+{
+    markChanged(pointsSize());
+    if (m_mapped)
+    {
+        m_overlay->insert(pointsSize(), point);
+    }
+    else if (m_streaming)
+    {
+        if (m_stream->append(point))
+        {
+            markChanged(0);
+        }
+    }
+    else
+    {
+        m_points.append(point);
+    }
+}
+
+void CurveLines::removePoint(int i)
+{
+    markChanged(i);
+    if (m_mapped)
+    {
+        m_overlay->remove(i);
+    }
+    else if (m_streaming)
+    {
+        m_stream->remove(i);
+    }
+    else
+    {
+        m_points.removeAt(i);
+    }
+}
@@ -3,10 +3,14 @@
 
 #include <cmath>
 #include <float.h>
+#include <limits.h>
 #include <QVector2D>
 #include <QRectF>
 #include <QVector>
+#include <QList>
 #include <QObject>
+#include <QScopedPointer>
+#include <memory>
 
 class CurvePoint
 {
@@ -64,6 +68,12 @@ public:
     QVector2D pos2;
 };
 
+class CurveOverlay;
+class CurveSnapshot;
+class CurveStream;
+
+typedef std::shared_ptr<const CurveSnapshot> CurveSnapshotPtr;
+
 class CurveLines : public QObject
 {
     Q_OBJECT
@@ -85,7 +95,12 @@ public:
     ~CurveLines();
 
 signals:
+    // Not emitted for mapped curves; read those in place through pointAt().
     void updateCurve(const QVector<CurvePoint> &data);
+    // A mapped curve was opened, saved or edited.
+    void updateMapped();
+    // Streaming mode: append points, then drop the oldest dropped ones.
+    void appendCurve(const QVector<CurvePoint> &points, int dropped);
 
 public slots:
     void onCurve(const QVector<CurvePoint>& points);
@@ -94,23 +109,107 @@ public:
     int pointsSize();
     int pointsTouchSize();
     int pointsDragSize();
+    bool pointsSorted();
+    bool pointsMapped();
+    bool pointsStreaming();
+
+    bool open(const QString& path);
+    bool save(const QString& path);
+    QString fileName();
+    QString errorString();
 
+    void setPoints(const QVector<CurvePoint>& points);
     void insertPoint(const CurvePoint& point);
     void selectPoints();
     void releasePoints();
     void updatePoints();
 
+    // Mutators inside a beginUpdate()/endUpdate() pair skip the stats pass
+    // and the updateCurve emission; the outermost endUpdate() does both
+    // once. Pairs nest.
+    void beginUpdate();
+    void endUpdate();
+    bool updating();
+
+    // Undo history of the mutators above, kept as deltas: moved fields with
+    // their other value, inserted and removed indices. Consecutive
+    // moveDragPoint() calls on one selection merge into a single step, a
+    // beginUpdate()/endUpdate() batch undoes as a whole, and the oldest
+    // steps are dropped once the history outgrows undoLimit() bytes.
+    bool undo();
+    bool redo();
+    bool canUndo();
+    bool canRedo();
+    void clearUndo();
+    void setUndoLimit(qint64 bytes);
+    qint64 undoLimit();
+    qint64 undoSize();
+
+    // publishSnapshot() freezes the current points and, from then on, the
+    // stats pass after every change publishes the next version; chunks that
+    // did not change stay shared with the previous one. snapshot() returns
+    // the latest published version (null before the first) and may be
+    // called from any thread. Batches publish once, at endUpdate().
+    CurveSnapshotPtr publishSnapshot();
+    CurveSnapshotPtr snapshot() const;
+
+    // Streaming keeps only the newest capacity points in a ring; 0 goes
+    // back to a plain vector. streamPoint() appends in O(1) with the stats
+    // kept incrementally, records no undo, and emits appendCurve() instead
+    // of the whole curve (once per batch inside beginUpdate()/endUpdate()).
+    // The other mutators still work on a streaming curve. Dropping a point
+    // renumbers the rest, so a published snapshot is rebuilt whole on each
+    // flush; batch the appends when both are in use.
+    void setStreaming(int capacity);
+    int streamCapacity();
+    void streamPoint(const CurvePoint& point);
+    void streamPoints(const QVector<CurvePoint>& points);
+
 public:
     float getValue(float x);
+    void getValues(const float *xs, float *ys, int count);
+    QVector<float> getValues(const QVector<float>& xs);
     float getMinValue();
     float getMaxValue();
     float getAverageValue();
 
+    // Signed area under the curve from x0 to x1, counting 0 outside the
+    // points as getValue() does. Every segment type integrates exactly, and
+    // the per-segment areas sit in a Fenwick tree: on a sorted curve a
+    // query is O(log n), and the next query after an edit refreshes only
+    // the segments it touched. Unsorted curves sum every segment.
+    double integral(float x0, float x1);
+    double cumulativeArea(float x);
+
+    // Every x where the curve reaches y, in segment order (ascending on a
+    // sorted curve), at most limit of them. A Default point that jumps
+    // across y counts at the jump, and a flat run at y counts where it
+    // starts. A tree of segment bounds skips every run of segments
+    // that cannot reach y, so the cost follows the number of crossings
+    // rather than the size of the curve.
+    QVector<float> crossings(float y, int limit = INT_MAX);
+
+    // Nearest point of the curve to pos, no farther than distance: returns
+    // the segment it lies on (0 when none is that close), the parameter for
+    // evaluate() and the point itself. On a step, t is the fraction of the
+    // run from the point back to the previous one. The same bounds tree
+    // narrows the search to the segments whose boxes come close enough,
+    // and each of those is then solved exactly.
+    int hitSegment(const QVector2D& pos, float distance, float& t, QVector2D& nearest);
+    // Inserts a point at t on segment i. Line and step halves follow the
+    // old segment exactly. Curve halves are an approximation: each keeps
+    // its ends, its midpoint and the outer tangent, but a point carries
+    // only one control point, so the path between them moves slightly.
+    // Returns the new point's index, or -1 if there is no segment i. The
+    // split undoes as one step.
+    int splitSegment(int i, float t);
+
 public:
     int touchPoints(const QRectF& rect);
     int touchPoints(const QVector2D& pos, float scale);
 
     void findTouchPoint(const QVector2D& pos);
+    bool touchRange(float& from, float& to);
     void leftTouchPoint(TouchType type);
     void rightTouchPoint(TouchType type);
 
@@ -121,7 +220,20 @@ public:
     int moveTouchPoint(const QVector2D& offset, MoveType type);
     int moveDragPoint(const QVector2D& offset, MoveType type);
 
+    // Whole-selection transforms: a touched point moves its anchor and its
+    // control point together, a touched control point alone moves by
+    // itself. Each call runs over the selection in blocks, on several
+    // threads once it is large, and lands as a single undo step. They
+    // return how many anchors and control points changed.
+    // p' = pivot + (p - pivot) * scale + offset
+    int transformPoints(const QVector2D& scale, const QVector2D& pivot, const QVector2D& offset = QVector2D());
+    // Snaps to the nearest multiple of grid counted from origin; a 0 grid
+    // step leaves that axis alone.
+    int quantizePoints(const QVector2D& grid, const QVector2D& origin = QVector2D());
+    int clampPoints(const QRectF& rect);
+
 public:
+    CurvePoint pointAt(int i);
     CurvePoint& firstPoint();
     CurvePoint& lastPoint();
 
@@ -129,13 +241,179 @@ public:
     CurvePoint& evaluatePoint(int i);
 
     QVector2D evaluate(int i, float t);
-    QVector2D evaluate(float t, const CurvePoint& point, const CurvePoint& pointd);
+    static QVector2D evaluate(float t, const CurvePoint& point, const CurvePoint& pointd);
+
+    int findSegment(float x);
+    float segmentValue(int i, float x);
+    static float segmentValue(float x, const CurvePoint& point, const CurvePoint& pointd);
+    // Area from pointd to x along the segment.
+    static double segmentArea(float x, const CurvePoint& point, const CurvePoint& pointd);
+
+private:
+    class Edit
+    {
+    public:
+        enum EditType{
+            Edit_Move = 0x00,
+            Edit_Insert = 0x01,
+            Edit_Remove = 0x02,
+        };
+
+    public:
+        Edit(EditType t = Edit_Move) : type(t), group(0), drag(false) {}
+        qint64 bytes() const;
+
+    public:
+        EditType type;
+        quint32 group;
+        bool drag;
+        // Edit_Move: index << 1 | 1 for pos2; otherwise ascending indices.
+        QVector<qint32> fields;
+        // Edit_Move: the value each field does not have right now.
+        QVector<QVector2D> values;
+        // Edit_Remove: the points that go back in.
+        QVector<CurvePoint> points;
+    };
+
+    // Per axis: v * scale + shift, then snapped to step from origin when
+    // step is set, then bounded to [low, high].
+    class Transform
+    {
+    public:
+        Transform() :
+            scale(1, 1), step(0, 0), low(-FLT_MAX, -FLT_MAX), high(FLT_MAX, FLT_MAX) {}
+
+    public:
+        QVector2D scale;
+        QVector2D shift;
+        QVector2D step;
+        QVector2D origin;
+        QVector2D low;
+        QVector2D high;
+    };
+    class TransformTask;
+
+    int transformSelection(const Transform& transform);
+
+    void recordEdit(Edit& edit);
+    void applyEdit(Edit& edit);
+    void trimEdits();
+    void insertPoints(const QVector<qint32>& indices, const QVector<CurvePoint>& points);
+    void removePoints(const QVector<qint32>& indices);
+
+    void updateStats();
+    // Min, max, sum and order breaks of a run of points.
+    class Stats
+    {
+    public:
+        Stats() : min(FLT_MAX), max(-FLT_MAX), sum(0), unsorted(0) {}
+        void unite(const Stats& stats);
+
+    public:
+        float min;
+        float max;
+        double sum;
+        int unsorted;
+    };
+
+    void updateStatsTree();
+    void updateAreas();
+    // Box around a run of segments; empty until united with one.
+    class Bounds
+    {
+    public:
+        Bounds() : left(FLT_MAX), right(-FLT_MAX), low(FLT_MAX), high(-FLT_MAX) {}
+        void unite(const Bounds& bounds);
+        float distance(const QVector2D& pos) const;
+
+    public:
+        float left;
+        float right;
+        float low;
+        float high;
+    };
+
+    void updateBounds();
+    void findCrossings(int node, float y, int limit, QVector<float>& xs);
+    void segmentCrossings(int i, float y, QVector<float>& xs);
+    void findHit(int node, const QVector2D& pos, float& distance, int& segment, float& t, QVector2D& nearest);
+    static float segmentHit(const QVector2D& pos, const CurvePoint& point, const CurvePoint& pointd, float& t, QVector2D& nearest);
+    static Bounds segmentBounds(const CurvePoint& point, const CurvePoint& pointd);
+    double prefixArea(int i);
+    double segmentArea(int i);
+    static float curveParameter(float x, const CurvePoint& point, const CurvePoint& pointd);
+    static double curveArea(float t, const CurvePoint& point, const CurvePoint& pointd);
+    void flushStream();
+    void markChanged(int from, int to = INT_MAX);
+    void buildSnapshot();
+
+    // Point access shared by the in-memory and the mapped storage. Only
+    // pointRef() copies a mapped page; the loops over touch and drag flags
+    // step with nextEdited()/previousEdited(), since untouched mapped pages
+    // cannot carry any. pointX() and pointAt() never detach or copy, so the
+    // evaluation paths may run on several threads at once.
+    float pointX(int i) { return m_mapped ? mappedX(i) : m_streaming ? streamX(i) : m_points.at(i).pos.x(); }
+    float mappedX(int i);
+    float streamX(int i);
+    CurvePoint& pointRef(int i);
+    int nextEdited(int i);
+    int previousEdited(int i);
+    int nextInside(int i, const QRectF& rect);
+    void appendPoint(const CurvePoint& point);
+    void removePoint(int i);
 
 private:
+    int m_updateDepth;
+    bool m_updatePending;
+    QList<Edit> m_undo;
+    QList<Edit> m_redo;
+    qint64 m_undoBytes;
+    qint64 m_undoLimit;
+    quint32 m_editGroup;
+    quint32 m_batchGroup;
+    bool m_editSealed;
+    CurveSnapshotPtr m_snapshot;
+    quint64 m_snapshotVersion;
+    int m_changedFrom;
+    int m_changedTo;
+    QVector<double> m_areas;
+    QVector<double> m_segmentAreas;
+    int m_areaFrom;
+    int m_areaTo;
+    QVector<Stats> m_stats;
+    int m_statsLeaves;
+    int m_statsPoints;
+    int m_statsFrom;
+    int m_statsTo;
+    QVector<Bounds> m_bounds;
+    int m_boundsLeaves;
+    int m_boundsSegments;
+    int m_boundsFrom;
+    int m_boundsTo;
+    bool m_mapped;
+    QScopedPointer<CurveOverlay> m_overlay;
+    bool m_streaming;
+    QScopedPointer<CurveStream> m_stream;
+    QVector<CurvePoint> m_streamed;
+    int m_streamDropped;
+    QString m_error;
+    bool m_sorted;
     float m_min;
     float m_max;
     float m_average;
     QVector<CurvePoint> m_points;
 };
 
+// Scoped beginUpdate()/endUpdate() pair.
+class CurveLinesBatch
+{
+public:
+    explicit CurveLinesBatch(CurveLines& lines) : m_lines(lines) { m_lines.beginUpdate(); }
+    ~CurveLinesBatch() { m_lines.endUpdate(); }
+
+private:
+    Q_DISABLE_COPY(CurveLinesBatch)
+    CurveLines& m_lines;
+};
+
 #endif // CURVELINES_H
@@ -0,0 +1,308 @@
+#include "curveoverlay.h"
+
+CurveOverlay::CurveOverlay() : m_size(0), m_lastPage(0)
+{
+
+}
+
+bool CurveOverlay::open(const QString &path)
+{
+    close();
+    if (!m_file.open(path))
+    {
+        m_error = m_file.errorString();
+        return false;
+    }
+    m_size = m_file.count();
+    m_pages.resize(m_file.pageCount());
+    for (int p = 0; p < m_pages.size(); p++)
+    {
+        Page& page = m_pages[p];
+        page.start = p * CurveFile::PageSize;
+        page.first = page.start;
+        page.count = qMin(static_cast<int>(CurveFile::PageSize), m_size - page.start);
+        page.summary = m_file.page(p);
+    }
+    return true;
+}
+
+void CurveOverlay::close()
+{
+    m_file.close();
+    m_error.clear();
+    m_pages.clear();
+    m_size = 0;
+    m_lastPage = 0;
+}
+
+bool CurveOverlay::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+QString CurveOverlay::fileName() const
+{
+    return m_file.fileName();
+}
+
+QString CurveOverlay::errorString() const
+{
+    return m_error;
+}
+
+bool CurveOverlay::save(const QString &path)
+{
+    QString error;
+    bool ok = CurveFile::write(path, m_size, [this](int first, int count, CurvePoint *out)
+    {
+        for (int k = 0; k < count; k++)
+        {
+            out[k] = point(first + k);
+        }
+    }, &error);
+    if (!ok)
+    {
+        m_error = error;
+        return false;
+    }
+    // Reopening drops every copied page: the new file is the compacted curve.
+    return open(path);
+}
+
+int CurveOverlay::size() const
+{
+    return m_size;
+}
+
+int CurveOverlay::copiedPages() const
+{
+    int count = 0;
+    for (const Page& page : m_pages)
+    {
+        count += page.copied;
+    }
+    return count;
+}
+
+CurvePoint CurveOverlay::point(int i) const
+{
+    const Page& page = m_pages[pageOf(i)];
+    if (page.copied)
+    {
+        return page.points[i - page.start];
+    }
+    return m_file.point(page.first + i - page.start);
+}
+
+float CurveOverlay::x(int i) const
+{
+    const Page& page = m_pages[pageOf(i)];
+    if (page.copied)
+    {
+        return page.points[i - page.start].pos.x();
+    }
+    return m_file.x(page.first + i - page.start);
+}
+
+CurvePoint &CurveOverlay::edit(int i)
+{
+    Page& page = copyPage(pageOf(i));
+    page.dirty = true;
+    return page.points[i - page.start];
+}
+
+void CurveOverlay::insert(int i, const CurvePoint &point)
+{
+    if (m_pages.isEmpty())
+    {
+        m_pages.append(Page());
+        m_pages.last().copied = true;
+    }
+    int p = (i >= m_size) ? m_pages.size() - 1 : pageOf(i);
+    Page& page = copyPage(p);
+    // QVector::insert() shifts by assignment, which would leave the touch
+    // and drag flags of the later points behind.
+    const int k = i - page.start;
+    if (k == page.points.size())
+    {
+        page.points.append(point);
+    }
+    else
+    {
+        QVector<CurvePoint> points;
+        points.reserve(page.points.size() + 1);
+        points += page.points.mid(0, k);
+        points.append(point);
+        points += page.points.mid(k);
+        page.points = points;
+    }
+    page.count++;
+    page.dirty = true;
+    m_size++;
+
+    if (page.count > 2 * CurveFile::PageSize)
+    {
+        Page tail;
+        tail.copied = true;
+        tail.dirty = true;
+        tail.points = page.points.mid(CurveFile::PageSize);
+        tail.count = tail.points.size();
+        page.points.resize(CurveFile::PageSize);
+        page.count = CurveFile::PageSize;
+        m_pages.insert(p + 1, tail);
+    }
+    renumber(p + 1);
+}
+
+void CurveOverlay::remove(int i)
+{
+    int p = pageOf(i);
+    Page& page = copyPage(p);
+    page.points.remove(i - page.start);
+    page.count--;
+    page.dirty = true;
+    m_size--;
+    if (page.count == 0)
+    {
+        m_pages.remove(p);
+    }
+    renumber(p);
+}
+
+int CurveOverlay::nextCopied(int i) const
+{
+    int j = qMax(0, i + 1);
+    if (j >= m_size)
+    {
+        return m_size;
+    }
+    for (int p = pageOf(j); p < m_pages.size(); p++)
+    {
+        if (m_pages[p].copied)
+        {
+            return qMax(j, m_pages[p].start);
+        }
+    }
+    return m_size;
+}
+
+int CurveOverlay::previousCopied(int i) const
+{
+    int j = qMin(i - 1, m_size - 1);
+    if (j < 0)
+    {
+        return -1;
+    }
+    for (int p = pageOf(j); p >= 0; p--)
+    {
+        if (m_pages[p].copied)
+        {
+            return qMin(j, m_pages[p].start + m_pages[p].count - 1);
+        }
+    }
+    return -1;
+}
+
+int CurveOverlay::nextInside(int i, const QRectF &rect) const
+{
+    if (i >= m_size)
+    {
+        return m_size;
+    }
+    const QRectF r = rect.normalized();
+    for (int p = pageOf(qMax(0, i)); p < m_pages.size(); p++)
+    {
+        // Copied pages may have moved since their summary was taken.
+        const Page& page = m_pages[p];
+        const CurveFilePage& s = page.summary;
+        if (page.copied || (s.right >= r.left() && s.left <= r.right()
+                            && s.high >= r.top() && s.low <= r.bottom()))
+        {
+            return qMax(i, page.start);
+        }
+    }
+    return m_size;
+}
+
+void CurveOverlay::stats(float &min, float &max, double &sum, bool &sorted)
+{
+    min = FLT_MAX;
+    max = -FLT_MAX;
+    sum = 0;
+    sorted = true;
+    for (int p = 0; p < m_pages.size(); p++)
+    {
+        Page& page = m_pages[p];
+        if (page.copied && page.dirty)
+        {
+            page.summary = CurveFile::summarize(page.points.constData(), page.count);
+            page.dirty = false;
+        }
+        const CurveFilePage& s = page.summary;
+        min = qMin(min, s.minY);
+        max = qMax(max, s.maxY);
+        sum += s.sum;
+        if (!s.sorted || (p > 0 && m_pages[p - 1].summary.lastX > s.firstX))
+        {
+            sorted = false;
+        }
+    }
+    if (!m_size)
+    {
+        min = max = 0;
+    }
+}
+
+int CurveOverlay::pageOf(int i) const
+{
+    int p = m_lastPage.load(std::memory_order_relaxed);
+    if (p < m_pages.size() && i >= m_pages[p].start && i < m_pages[p].start + m_pages[p].count)
+    {
+        return p;
+    }
+    int low = 0;
+    int high = m_pages.size() - 1;
+    while (low < high)
+    {
+        int mid = (low + high + 1) / 2;
+        if (m_pages[mid].start <= i)
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+    m_lastPage.store(low, std::memory_order_relaxed);
+    return low;
+}
+
+CurveOverlay::Page &CurveOverlay::copyPage(int p)
+{
+    Page& page = m_pages[p];
+    if (!page.copied)
+    {
+        page.points.reserve(page.count);
+        for (int k = 0; k < page.count; k++)
+        {
+            page.points.append(m_file.point(page.first + k));
+        }
+        page.copied = true;
+        page.dirty = true;
+    }
+    return page;
+}
+
+void CurveOverlay::renumber(int from)
+{
+    if (!m_pages.isEmpty())
+    {
+        m_pages[0].start = 0;
+    }
+    for (int p = qMax(1, from); p < m_pages.size(); p++)
+    {
+        m_pages[p].start = m_pages[p - 1].start + m_pages[p - 1].count;
+    }
+    m_lastPage = 0;
+}
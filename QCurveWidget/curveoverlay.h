@@ -0,0 +1,67 @@
+#ifndef CURVEOVERLAY_H
+#define CURVEOVERLAY_H
+
+#include <atomic>
+#include "curvefile.h"
+
+// Point sequence over a mapped CurveFile. Pages keep reading straight from
+// the mapping until they are edited; the first edit copies that one page
+// into memory, and save() writes everything back as a compacted file.
+class CurveOverlay
+{
+public:
+    CurveOverlay();
+
+public:
+    bool open(const QString& path);
+    void close();
+    bool isOpen() const;
+    QString fileName() const;
+    QString errorString() const;
+    bool save(const QString& path);
+
+    int size() const;
+    int copiedPages() const;
+    CurvePoint point(int i) const;
+    float x(int i) const;
+
+    CurvePoint& edit(int i);
+    void insert(int i, const CurvePoint& point);
+    void remove(int i);
+
+    int nextCopied(int i) const;
+    int previousCopied(int i) const;
+    int nextInside(int i, const QRectF& rect) const;
+
+    void stats(float& min, float& max, double& sum, bool& sorted);
+
+private:
+    class Page
+    {
+    public:
+        Page() : start(0), first(0), count(0), copied(false), dirty(false), summary() {}
+
+    public:
+        int start;
+        int first;
+        int count;
+        bool copied;
+        bool dirty;
+        QVector<CurvePoint> points;
+        CurveFilePage summary;
+    };
+
+    int pageOf(int i) const;
+    Page& copyPage(int p);
+    void renumber(int from);
+
+private:
+    CurveFile m_file;
+    QString m_error;
+    QVector<Page> m_pages;
+    int m_size;
+    // Lookup cache; atomic so concurrent readers may share the overlay.
+    mutable std::atomic<int> m_lastPage;
+};
+
+#endif // CURVEOVERLAY_H
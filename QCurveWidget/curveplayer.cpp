@@ -0,0 +1,371 @@
+#include "curveplayer.h"
+#include "curvesnapshot.h"
+#include <cmath>
+#include <cstring>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QtEndian>
+#include <QtAlgorithms>
+
+const int DrainInterval = 10;
+const int DrainBatch = 4096;
+const qint64 SpinNs = 200000;
+const qint64 SleepNs = 10000000;
+const qint64 StatsNs = 100000000;
+const int RecordSize = 24;
+
+CurveSampleRing::CurveSampleRing(int capacity) :
+    m_head(0), m_tail(0)
+{
+    int size = 1;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+    m_samples.resize(size);
+    m_data = m_samples.data();
+    m_mask = static_cast<quint64>(size - 1);
+}
+
+bool CurveSampleRing::push(const CurveSample &sample)
+{
+    const quint64 head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) > m_mask)
+    {
+        return false;
+    }
+    m_data[head & m_mask] = sample;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+int CurveSampleRing::pop(CurveSample *samples, int count)
+{
+    const quint64 tail = m_tail.load(std::memory_order_relaxed);
+    const int n = static_cast<int>(qMin<quint64>(count, m_head.load(std::memory_order_acquire) - tail));
+    for (int k = 0; k < n; k++)
+    {
+        samples[k] = m_data[(tail + k) & m_mask];
+    }
+    m_tail.store(tail + n, std::memory_order_release);
+    return n;
+}
+
+int CurveSampleRing::size() const
+{
+    return static_cast<int>(m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire));
+}
+
+void CurveSampleRing::clear()
+{
+    m_head.store(0);
+    m_tail.store(0);
+}
+
+CurveDeviceSink::CurveDeviceSink(QIODevice *device, CurveDeviceSink::Format format) :
+    m_device(device), m_format(format)
+{
+
+}
+
+void CurveDeviceSink::write(const CurveSample *samples, int count)
+{
+    if (!m_device || !m_device->isWritable())
+    {
+        return;
+    }
+    m_buffer.clear();
+    if (m_format == Binary)
+    {
+        m_buffer.resize(count * RecordSize);
+        uchar* out = reinterpret_cast<uchar*>(m_buffer.data());
+        for (int k = 0; k < count; k++, out += RecordSize)
+        {
+            quint32 x;
+            quint32 y;
+            memcpy(&x, &samples[k].x, sizeof(x));
+            memcpy(&y, &samples[k].y, sizeof(y));
+            qToLittleEndian(samples[k].tick, out);
+            qToLittleEndian(samples[k].time, out + 8);
+            qToLittleEndian(x, out + 16);
+            qToLittleEndian(y, out + 20);
+        }
+    }
+    else
+    {
+        for (int k = 0; k < count; k++)
+        {
+            m_buffer += QByteArray::number(samples[k].tick) + ',' + QByteArray::number(samples[k].time) + ','
+                    + QByteArray::number(samples[k].x, 'g', 9) + ',' + QByteArray::number(samples[k].y, 'g', 9) + '\n';
+        }
+    }
+    m_device->write(m_buffer);
+}
+
+CurveFileSink::CurveFileSink(const QString &path, CurveDeviceSink::Format format) :
+    CurveDeviceSink(&m_file, format), m_file(path)
+{
+    m_file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+}
+
+bool CurveFileSink::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+CurveCallbackSink::CurveCallbackSink(std::function<void (const CurveSample &)> callback) :
+    m_callback(callback)
+{
+
+}
+
+void CurveCallbackSink::write(const CurveSample *samples, int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        m_callback(samples[k]);
+    }
+}
+
+class CurvePlayerThread : public QThread
+{
+public:
+    CurvePlayerThread(CurveLines* lines, int capacity) :
+        m_lines(lines), m_ring(capacity), m_rate(0), m_speed(0), m_from(0), m_to(0),
+        m_loop(false), m_stop(false) {}
+
+public:
+    void run() override;
+
+public:
+    CurveLines* m_lines;
+    CurveSampleRing m_ring;
+    int m_rate;
+    double m_speed;
+    double m_from;
+    double m_to;
+    bool m_loop;
+    std::atomic<bool> m_stop;
+    QMutex m_mutex;
+    CurvePlayerStats m_stats;
+};
+
+void CurvePlayerThread::run()
+{
+    // Deadlines are kept on the nominal grid tick * period, so a late tick
+    // does not push the later ones back. Far from a deadline the thread
+    // sleeps; the last SpinNs it yields in a loop, which is what keeps the
+    // jitter below the scheduler's timer slack.
+    const qint64 period = 1000000000LL / m_rate;
+    const double span = m_to - m_from;
+    const double origin = m_speed >= 0 ? m_from : m_to;
+    CurvePlayerStats stats;
+    CurveCursor cursor;
+    QElapsedTimer clock;
+    clock.start();
+    qint64 published = 0;
+    qint64 tick = 0;
+    bool end = false;
+    while (!end && !m_stop.load(std::memory_order_relaxed))
+    {
+        qint64 deadline = tick * period;
+        qint64 now = clock.nsecsElapsed();
+        while (now < deadline && !m_stop.load(std::memory_order_relaxed))
+        {
+            if (deadline - now > SpinNs)
+            {
+                QThread::usleep(static_cast<unsigned long>(qMin(deadline - now - SpinNs, SleepNs) / 1000));
+            }
+            else
+            {
+                QThread::yieldCurrentThread();
+            }
+            now = clock.nsecsElapsed();
+        }
+        if (now - deadline >= period)
+        {
+            const qint64 missed = (now - deadline) / period;
+            stats.overruns += missed;
+            tick += missed;
+            deadline = tick * period;
+        }
+        stats.jitter.add(now - deadline);
+        stats.ticks++;
+
+        // Edits reach playback as the editor publishes them; between
+        // versions the cursor keeps its segment.
+        CurveSnapshotPtr curve = m_lines->snapshot();
+        if (curve.get() != cursor.curve())
+        {
+            cursor.reset(curve);
+            stats.versions++;
+        }
+        double x = span > 0 ? origin + m_speed * tick / m_rate : m_from;
+        if (x > m_to || x < m_from)
+        {
+            if (m_loop)
+            {
+                x = m_from + std::fmod(x - m_from, span);
+                x += x < m_from ? span : 0;
+            }
+            else
+            {
+                x = qBound(m_from, x, m_to);
+                end = true;
+            }
+        }
+        const float px = static_cast<float>(x);
+        if (!m_ring.push(CurveSample(tick, now, px, cursor.value(px))))
+        {
+            stats.dropped++;
+        }
+        tick++;
+
+        if (end || now - published >= StatsNs)
+        {
+            QMutexLocker locker(&m_mutex);
+            stats.delivered = m_stats.delivered;
+            m_stats = stats;
+            published = now;
+        }
+    }
+    QMutexLocker locker(&m_mutex);
+    stats.delivered = m_stats.delivered;
+    m_stats = stats;
+}
+
+CurvePlayer::CurvePlayer(CurveLines *lines, QObject *parent) :
+    QObject(parent), m_lines(lines), m_rate(1000), m_speed(1), m_from(0), m_to(0),
+    m_loop(false), m_capacity(DefaultCapacity)
+{
+    QObject::connect(&m_drain, &QTimer::timeout, this, &CurvePlayer::onDrain);
+}
+
+CurvePlayer::~CurvePlayer()
+{
+    stop();
+    clearSinks();
+}
+
+void CurvePlayer::setRate(int hz)
+{
+    m_rate = qBound<int>(MinRate, hz, MaxRate);
+}
+
+int CurvePlayer::rate()
+{
+    return m_rate;
+}
+
+void CurvePlayer::setSpeed(float speed)
+{
+    m_speed = speed;
+}
+
+float CurvePlayer::speed()
+{
+    return m_speed;
+}
+
+void CurvePlayer::setRange(float from, float to)
+{
+    m_from = qMin(from, to);
+    m_to = qMax(from, to);
+}
+
+void CurvePlayer::setLoop(bool loop)
+{
+    m_loop = loop;
+}
+
+void CurvePlayer::setCapacity(int samples)
+{
+    m_capacity = qMax(2, samples);
+}
+
+void CurvePlayer::addSink(CurveSampleSink *sink)
+{
+    m_sinks.append(sink);
+}
+
+void CurvePlayer::clearSinks()
+{
+    qDeleteAll(m_sinks);
+    m_sinks.clear();
+}
+
+bool CurvePlayer::start()
+{
+    stop();
+    CurveSnapshotPtr curve = m_lines->publishSnapshot();
+    m_thread.reset(new CurvePlayerThread(m_lines, m_capacity));
+    m_thread->m_rate = m_rate;
+    m_thread->m_speed = m_speed;
+    m_thread->m_from = m_from;
+    m_thread->m_to = m_to;
+    m_thread->m_loop = m_loop;
+    if (m_from == m_to && curve->size() > 1)
+    {
+        m_thread->m_from = qMin(curve->pointX(0), curve->pointX(curve->size() - 1));
+        m_thread->m_to = qMax(curve->pointX(0), curve->pointX(curve->size() - 1));
+    }
+    m_thread->start(QThread::TimeCriticalPriority);
+    m_drain.start(DrainInterval);
+    return m_thread->isRunning() || m_thread->isFinished();
+}
+
+void CurvePlayer::stop()
+{
+    if (!m_thread)
+    {
+        return;
+    }
+    m_thread->m_stop.store(true);
+    m_thread->wait();
+    onDrain();
+}
+
+bool CurvePlayer::isRunning()
+{
+    return m_thread && m_thread->isRunning();
+}
+
+CurvePlayerStats CurvePlayer::stats()
+{
+    if (!m_thread)
+    {
+        return CurvePlayerStats();
+    }
+    QMutexLocker locker(&m_thread->m_mutex);
+    return m_thread->m_stats;
+}
+
+void CurvePlayer::onDrain()
+{
+    if (!m_thread)
+    {
+        m_drain.stop();
+        return;
+    }
+    const bool done = m_thread->isFinished();
+    m_drained.resize(DrainBatch);
+    int total = 0;
+    int n;
+    while ((n = m_thread->m_ring.pop(m_drained.data(), DrainBatch)) > 0)
+    {
+        for (int k = 0; k < m_sinks.size(); k++)
+        {
+            m_sinks[k]->write(m_drained.constData(), n);
+        }
+        total += n;
+    }
+    {
+        QMutexLocker locker(&m_thread->m_mutex);
+        m_thread->m_stats.delivered += total;
+    }
+    if (done && m_drain.isActive())
+    {
+        m_drain.stop();
+        emit finished();
+    }
+}
@@ -0,0 +1,178 @@
+#ifndef CURVEPLAYER_H
+#define CURVEPLAYER_H
+
+#include <atomic>
+#include <functional>
+#include <QObject>
+#include <QTimer>
+#include <QMutex>
+#include <QFile>
+#include <QScopedPointer>
+#include "curvelines.h"
+#include "curvehistogram.h"
+
+class CurveSample
+{
+public:
+    CurveSample(qint64 tk = 0, qint64 t = 0, float px = 0, float py = 0) :
+        tick(tk), time(t), x(px), y(py) {}
+
+public:
+    qint64 tick;
+    qint64 time;
+    float x;
+    float y;
+};
+
+class CurvePlayerStats
+{
+public:
+    CurvePlayerStats() :
+        ticks(0), overruns(0), dropped(0), delivered(0), versions(0) {}
+
+public:
+    qint64 ticks;
+    qint64 overruns;
+    qint64 dropped;
+    qint64 delivered;
+    qint64 versions;
+    // Lateness of each tick against its deadline, in nanoseconds.
+    CurveHistogram jitter;
+};
+
+// Single producer, single consumer queue between the playback thread and
+// the thread draining it; neither side ever blocks.
+class CurveSampleRing
+{
+public:
+    explicit CurveSampleRing(int capacity);
+
+public:
+    bool push(const CurveSample& sample);
+    int pop(CurveSample* samples, int count);
+    int size() const;
+    void clear();
+
+private:
+    QVector<CurveSample> m_samples;
+    CurveSample* m_data;
+    quint64 m_mask;
+    std::atomic<quint64> m_head;
+    std::atomic<quint64> m_tail;
+};
+
+class CurveSampleSink
+{
+public:
+    virtual ~CurveSampleSink() {}
+    virtual void write(const CurveSample* samples, int count) = 0;
+};
+
+// Binary records are little-endian tick (int64), time (int64), x and y
+// (float32); Csv writes "tick,time,x,y" lines.
+class CurveDeviceSink : public CurveSampleSink
+{
+public:
+    enum Format{
+        Binary = 0x00,
+        Csv = 0x01,
+    };
+
+public:
+    CurveDeviceSink(QIODevice* device, Format format = Binary);
+
+public:
+    void write(const CurveSample* samples, int count) override;
+
+private:
+    QIODevice* m_device;
+    Format m_format;
+    QByteArray m_buffer;
+};
+
+class CurveFileSink : public CurveDeviceSink
+{
+public:
+    CurveFileSink(const QString& path, Format format = Csv);
+
+public:
+    bool isOpen() const;
+
+private:
+    QFile m_file;
+};
+
+class CurveCallbackSink : public CurveSampleSink
+{
+public:
+    explicit CurveCallbackSink(std::function<void(const CurveSample&)> callback);
+
+public:
+    void write(const CurveSample* samples, int count) override;
+
+private:
+    std::function<void(const CurveSample&)> m_callback;
+};
+
+class CurvePlayerThread;
+
+// Samples the curve at a fixed rate on a time-critical thread. Each tick
+// evaluates the latest published snapshot through a cursor and queues the
+// sample; the owning thread drains the queue into the sinks, so a slow
+// sink or a busy GUI costs dropped samples rather than late ones. Ticks
+// that are missed entirely are skipped and counted as overruns.
+class CurvePlayer : public QObject
+{
+    Q_OBJECT
+public:
+    enum {
+        MinRate = 1,
+        MaxRate = 10000,
+        DefaultCapacity = 1 << 16,
+    };
+
+public:
+    explicit CurvePlayer(CurveLines* lines, QObject* parent = nullptr);
+    ~CurvePlayer();
+
+signals:
+    void finished();
+
+public:
+    // Settings take effect at the next start(). Without a range the whole
+    // curve plays; speed is in curve x units per second.
+    void setRate(int hz);
+    int rate();
+    void setSpeed(float speed);
+    float speed();
+    void setRange(float from, float to);
+    void setLoop(bool loop);
+    void setCapacity(int samples);
+
+    // Sinks are owned by the player and called on its thread.
+    void addSink(CurveSampleSink* sink);
+    void clearSinks();
+
+    bool start();
+    void stop();
+    bool isRunning();
+    CurvePlayerStats stats();
+
+protected slots:
+    void onDrain();
+
+private:
+    CurveLines* m_lines;
+    int m_rate;
+    float m_speed;
+    float m_from;
+    float m_to;
+    bool m_loop;
+    int m_capacity;
+    QList<CurveSampleSink*> m_sinks;
+    QVector<CurveSample> m_drained;
+    QTimer m_drain;
+    QScopedPointer<CurvePlayerThread> m_thread;
+};
+
+#endif // CURVEPLAYER_H
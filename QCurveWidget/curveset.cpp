@@ -0,0 +1,251 @@
+#include "curveset.h"
+#include "curvesnapshot.h"
+#include <atomic>
+#include <QThread>
+#include <QRunnable>
+
+const int BlockSize = 1 << 14;
+const qint64 ParallelMin = 1 << 15;
+
+// Pulls (channel, block) units off a shared counter until none are left.
+class CurveSetTask : public QRunnable
+{
+public:
+    CurveSetTask(const QVector<CurveSnapshotPtr>& curves, const float* xs, int count, float* ys,
+                 std::atomic<int>& next) :
+        m_curves(curves), m_xs(xs), m_count(count), m_ys(ys), m_next(next) {}
+
+public:
+    void run() override
+    {
+        const int blocks = (m_count + BlockSize - 1) / BlockSize;
+        const int units = m_curves.size() * blocks;
+        int unit;
+        while ((unit = m_next.fetch_add(1, std::memory_order_relaxed)) < units)
+        {
+            const int c = unit / blocks;
+            const int first = (unit % blocks) * BlockSize;
+            const int n = qMin(BlockSize, m_count - first);
+            // Rows without a snapshot are left to the caller.
+            if (m_curves.at(c))
+            {
+                m_curves.at(c)->getValues(m_xs + first, m_ys + static_cast<qint64>(c) * m_count + first, n);
+            }
+        }
+    }
+
+private:
+    const QVector<CurveSnapshotPtr>& m_curves;
+    const float* m_xs;
+    int m_count;
+    float* m_ys;
+    std::atomic<int>& m_next;
+};
+
+CurveSet::CurveSet(QObject *parent) : QObject(parent),
+    m_domain(false), m_from(0), m_to(0)
+{
+    m_pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+CurveSet::~CurveSet()
+{
+    clear();
+}
+
+int CurveSet::addChannel(const QString &name)
+{
+    return attach(name, new CurveLines, true);
+}
+
+int CurveSet::addChannel(const QString &name, CurveLines *lines)
+{
+    return attach(name, lines, false);
+}
+
+int CurveSet::attach(const QString &name, CurveLines *lines, bool owned)
+{
+    Channel channel;
+    channel.name = name;
+    channel.lines = lines;
+    channel.owned = owned;
+    channel.connection = QObject::connect(lines, &CurveLines::updateCurve, this,
+                                          [this, name](const QVector<CurvePoint>& points)
+    {
+        emit updateChannel(name, points);
+    });
+    channel.mappedConnection = QObject::connect(lines, &CurveLines::updateMapped, this,
+                                                [this, name, lines]()
+    {
+        emit updateMapped(name, lines);
+    });
+    m_channels.append(channel);
+    return m_channels.size() - 1;
+}
+
+void CurveSet::removeChannel(int index)
+{
+    if (index < 0 || index >= m_channels.size())
+    {
+        return;
+    }
+    Channel channel = m_channels.takeAt(index);
+    QObject::disconnect(channel.connection);
+    QObject::disconnect(channel.mappedConnection);
+    if (channel.owned)
+    {
+        delete channel.lines.data();
+    }
+}
+
+void CurveSet::clear()
+{
+    while (!m_channels.isEmpty())
+    {
+        removeChannel(m_channels.size() - 1);
+    }
+}
+
+int CurveSet::channelCount() const
+{
+    return m_channels.size();
+}
+
+CurveLines *CurveSet::channel(int index) const
+{
+    return m_channels.at(index).lines.data();
+}
+
+QString CurveSet::channelName(int index) const
+{
+    return m_channels.at(index).name;
+}
+
+int CurveSet::indexOf(const QString &name) const
+{
+    for (int i = 0; i < m_channels.size(); i++)
+    {
+        if (m_channels.at(i).name == name)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void CurveSet::setDomain(float from, float to)
+{
+    m_domain = true;
+    m_from = qMin(from, to);
+    m_to = qMax(from, to);
+}
+
+void CurveSet::clearDomain()
+{
+    m_domain = false;
+}
+
+bool CurveSet::domain(float &from, float &to)
+{
+    if (m_domain)
+    {
+        from = m_from;
+        to = m_to;
+        return true;
+    }
+    bool found = false;
+    for (int i = 0; i < m_channels.size(); i++)
+    {
+        float low;
+        float high;
+        if (extent(i, low, high))
+        {
+            from = found ? qMin(from, low) : low;
+            to = found ? qMax(to, high) : high;
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool CurveSet::extent(int index, float &from, float &to)
+{
+    CurveLines* lines = m_channels.at(index).lines.data();
+    if (!lines || !lines->pointsSize())
+    {
+        return false;
+    }
+    float first = lines->pointAt(0).pos.x();
+    float last = lines->pointAt(lines->pointsSize() - 1).pos.x();
+    from = qMin(first, last);
+    to = qMax(first, last);
+    return true;
+}
+
+void CurveSet::setThreads(int threads)
+{
+    m_pool.setMaxThreadCount(threads > 0 ? threads : QThread::idealThreadCount());
+}
+
+int CurveSet::threads() const
+{
+    return m_pool.maxThreadCount();
+}
+
+QVector<float> CurveSet::evaluate(float x)
+{
+    return evaluate(QVector<float>(1, x));
+}
+
+QVector<float> CurveSet::evaluate(const QVector<float> &xs)
+{
+    // A snapshot of a mapped channel would copy the whole file, so those
+    // are read in place on this thread instead.
+    QVector<CurveSnapshotPtr> curves;
+    QVector<int> mapped;
+    curves.reserve(m_channels.size());
+    for (int i = 0; i < m_channels.size(); i++)
+    {
+        CurveLines* lines = m_channels.at(i).lines.data();
+        if (lines && lines->pointsMapped())
+        {
+            mapped.append(i);
+        }
+        curves.append(lines && !lines->pointsMapped() ? lines->publishSnapshot() : CurveSnapshotPtr());
+    }
+    QVector<float> ys(curves.size() * xs.size());
+    std::atomic<int> next(0);
+    CurveSetTask task(curves, xs.constData(), xs.size(), ys.data(), next);
+    const qint64 work = static_cast<qint64>(curves.size()) * xs.size();
+    const int workers = work < ParallelMin ? 0 : qMin(m_pool.maxThreadCount() - 1, curves.size() * ((xs.size() + BlockSize - 1) / BlockSize) - 1);
+    for (int t = 0; t < workers; t++)
+    {
+        CurveSetTask* helper = new CurveSetTask(curves, xs.constData(), xs.size(), ys.data(), next);
+        helper->setAutoDelete(true);
+        m_pool.start(helper);
+    }
+    for (int c : mapped)
+    {
+        m_channels.at(c).lines->getValues(xs.constData(), ys.data() + static_cast<qint64>(c) * xs.size(), xs.size());
+    }
+    // The calling thread takes units too, so small batches never wait on
+    // the pool.
+    task.run();
+    m_pool.waitForDone();
+    return ys;
+}
+
+QVector<float> CurveSet::evaluate(float from, float to, int count)
+{
+    QVector<float> xs(qMax(0, count));
+    const double step = count > 1 ? (static_cast<double>(to) - from) / (count - 1) : 0;
+    for (int k = 0; k < xs.size(); k++)
+    {
+        xs[k] = static_cast<float>(from + step * k);
+    }
+    if (count > 1)
+    {
+        xs[count - 1] = to;
+    }
+    return evaluate(xs);
+}
@@ -0,0 +1,76 @@
+#ifndef CURVESET_H
+#define CURVESET_H
+
+#include <QObject>
+#include <QPointer>
+#include <QThreadPool>
+#include "curvelines.h"
+
+// Named channels over one x-domain. Channels are either created and owned
+// by the set or borrowed from elsewhere; every change a channel publishes
+// is forwarded as updateChannel(), or as updateMapped() for a mapped
+// channel, which is never copied out. The evaluate() calls read each channel
+// through a fresh snapshot and split channels and x blocks across the
+// set's thread pool once the batch is large enough to pay for it. Mapped
+// channels skip the snapshot and are read in place by the calling thread.
+class CurveSet : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CurveSet(QObject *parent = nullptr);
+    ~CurveSet();
+
+signals:
+    void updateChannel(const QString& name, const QVector<CurvePoint>& points);
+    void updateMapped(const QString& name, CurveLines* lines);
+
+public:
+    int addChannel(const QString& name);
+    int addChannel(const QString& name, CurveLines* lines);
+    void removeChannel(int index);
+    void clear();
+
+    int channelCount() const;
+    CurveLines* channel(int index) const;
+    QString channelName(int index) const;
+    int indexOf(const QString& name) const;
+
+    // Without an explicit domain it is the union of the channels' extents.
+    void setDomain(float from, float to);
+    void clearDomain();
+    bool domain(float& from, float& to);
+    bool extent(int index, float& from, float& to);
+
+    void setThreads(int threads);
+    int threads() const;
+
+    // Results are channel-major: ys[channel * xs.size() + k].
+    QVector<float> evaluate(float x);
+    QVector<float> evaluate(const QVector<float>& xs);
+    QVector<float> evaluate(float from, float to, int count);
+
+private:
+    class Channel
+    {
+    public:
+        Channel() : owned(false) {}
+
+    public:
+        QString name;
+        QPointer<CurveLines> lines;
+        bool owned;
+        QMetaObject::Connection connection;
+        QMetaObject::Connection mappedConnection;
+    };
+
+    int attach(const QString& name, CurveLines* lines, bool owned);
+
+private:
+    QVector<Channel> m_channels;
+    bool m_domain;
+    float m_from;
+    float m_to;
+    QThreadPool m_pool;
+};
+
+#endif // CURVESET_H
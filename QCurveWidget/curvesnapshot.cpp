@@ -0,0 +1,212 @@
+#include "curvesnapshot.h"
+
+const int CursorSteps = 8;
+
+CurveSnapshot::CurveSnapshot() :
+    m_version(0), m_size(0), m_sorted(true), m_min(0), m_max(0), m_average(0)
+{
+
+}
+
+quint64 CurveSnapshot::version() const
+{
+    return m_version;
+}
+
+int CurveSnapshot::size() const
+{
+    return m_size;
+}
+
+bool CurveSnapshot::sorted() const
+{
+    return m_sorted;
+}
+
+int CurveSnapshot::chunks() const
+{
+    return m_chunks.size();
+}
+
+int CurveSnapshot::sharedChunks(const CurveSnapshot &other) const
+{
+    int count = 0;
+    for (int c = 0; c < qMin(m_chunks.size(), other.m_chunks.size()); c++)
+    {
+        if (m_chunks.at(c).constData() == other.m_chunks.at(c).constData())
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+CurvePoint CurveSnapshot::pointAt(int i) const
+{
+    return m_chunks.at(i >> ChunkShift).at(i & (ChunkSize - 1));
+}
+
+float CurveSnapshot::pointX(int i) const
+{
+    return m_chunks.at(i >> ChunkShift).at(i & (ChunkSize - 1)).pos.x();
+}
+
+float CurveSnapshot::getValue(float x) const
+{
+    int i = findSegment(x);
+    if (i > 0)
+    {
+        return segmentValue(i, x);
+    }
+    if (m_size == 1 && pointX(0) == x)
+    {
+        return pointAt(0).pos.y();
+    }
+    return 0;
+}
+
+void CurveSnapshot::getValues(const float *xs, float *ys, int count) const
+{
+    if (!m_sorted || m_size < 2)
+    {
+        for (int k = 0; k < count; k++)
+        {
+            ys[k] = getValue(xs[k]);
+        }
+        return;
+    }
+
+    // Same segment cursor as CurveLines::getValues().
+    const float first = pointX(0);
+    const float last = pointX(m_size - 1);
+    int i = 1;
+    float cursor = first;
+    for (int k = 0; k < count; k++)
+    {
+        float x = xs[k];
+        if (!(x >= first && x <= last))
+        {
+            ys[k] = 0;
+            continue;
+        }
+        if (x < cursor)
+        {
+            i = findSegment(x);
+        }
+        cursor = x;
+        while (i < m_size - 1 && pointX(i) < x)
+        {
+            i++;
+        }
+        ys[k] = segmentValue(i, x);
+    }
+}
+
+float CurveSnapshot::getMinValue() const
+{
+    return m_min;
+}
+
+float CurveSnapshot::getMaxValue() const
+{
+    return m_max;
+}
+
+float CurveSnapshot::getAverageValue() const
+{
+    return m_average;
+}
+
+int CurveSnapshot::findSegment(float x) const
+{
+    if (m_size < 2)
+    {
+        return -1;
+    }
+    if (m_sorted)
+    {
+        if (!(x >= pointX(0) && x <= pointX(m_size - 1)))
+        {
+            return -1;
+        }
+        int low = 1;
+        int high = m_size - 1;
+        while (low < high)
+        {
+            int mid = (low + high) / 2;
+            if (pointX(mid) < x)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        return low;
+    }
+    for (int i = 1; i < m_size; i++)
+    {
+        float x0 = pointX(i-1);
+        float x1 = pointX(i);
+        if (qMin(x0, x1) <= x && x <= qMax(x0, x1))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+float CurveSnapshot::segmentValue(int i, float x) const
+{
+    return CurveLines::segmentValue(x, pointAt(i), pointAt(i-1));
+}
+
+CurveCursor::CurveCursor() :
+    m_segment(1)
+{
+
+}
+
+void CurveCursor::reset(const CurveSnapshotPtr &curve)
+{
+    m_curve = curve;
+    m_segment = 1;
+}
+
+const CurveSnapshot *CurveCursor::curve() const
+{
+    return m_curve.get();
+}
+
+float CurveCursor::value(float x)
+{
+    const CurveSnapshot* curve = m_curve.get();
+    if (!curve || !curve->sorted() || curve->size() < 2)
+    {
+        return curve ? curve->getValue(x) : 0;
+    }
+    const int n = curve->size();
+    if (!(x >= curve->pointX(0) && x <= curve->pointX(n - 1)))
+    {
+        return 0;
+    }
+    // findSegment() answers the first i with pointX(i) >= x; stepping keeps
+    // to the same segment, ties included.
+    int i = m_segment;
+    int steps = 0;
+    while (i < n - 1 && curve->pointX(i) < x && steps++ < CursorSteps)
+    {
+        i++;
+    }
+    while (i > 1 && curve->pointX(i - 1) >= x && steps++ < CursorSteps)
+    {
+        i--;
+    }
+    if (curve->pointX(i) < x || (i > 1 && curve->pointX(i - 1) >= x))
+    {
+        i = curve->findSegment(x);
+    }
+    m_segment = i;
+    return curve->segmentValue(i, x);
+}
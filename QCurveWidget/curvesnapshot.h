@@ -0,0 +1,73 @@
+#ifndef CURVESNAPSHOT_H
+#define CURVESNAPSHOT_H
+
+#include <memory>
+#include "curvelines.h"
+
+// Frozen copy of a CurveLines point sequence. The points are split into
+// fixed chunks of implicitly shared vectors, so a new version only copies
+// the chunks that changed and keeps referencing the rest. Nothing here is
+// ever modified after publication, which lets any number of threads
+// evaluate one snapshot without locking.
+class CurveSnapshot
+{
+public:
+    enum {
+        ChunkShift = 12,
+        ChunkSize = 1 << ChunkShift,
+    };
+
+public:
+    CurveSnapshot();
+
+public:
+    quint64 version() const;
+    int size() const;
+    bool sorted() const;
+    int chunks() const;
+    int sharedChunks(const CurveSnapshot& other) const;
+
+    CurvePoint pointAt(int i) const;
+    float pointX(int i) const;
+
+    float getValue(float x) const;
+    void getValues(const float* xs, float* ys, int count) const;
+    float getMinValue() const;
+    float getMaxValue() const;
+    float getAverageValue() const;
+
+    int findSegment(float x) const;
+    float segmentValue(int i, float x) const;
+
+private:
+    friend class CurveLines;
+
+    quint64 m_version;
+    int m_size;
+    bool m_sorted;
+    float m_min;
+    float m_max;
+    float m_average;
+    QVector<QVector<CurvePoint>> m_chunks;
+};
+
+// Sequential lookups on one snapshot. The cursor keeps the segment of the
+// last query and steps from there, so a sweep in either direction costs
+// O(1) per sample on a sorted curve; long jumps fall back to the binary
+// search. Values match CurveSnapshot::getValue() exactly.
+class CurveCursor
+{
+public:
+    CurveCursor();
+
+public:
+    void reset(const CurveSnapshotPtr& curve);
+    const CurveSnapshot* curve() const;
+    float value(float x);
+
+private:
+    CurveSnapshotPtr m_curve;
+    int m_segment;
+};
+
+#endif // CURVESNAPSHOT_H
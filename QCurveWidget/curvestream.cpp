@@ -0,0 +1,246 @@
+#include "curvestream.h"
+
+static void copyPoint(CurvePoint& target, const CurvePoint& point)
+{
+    // CurvePoint::operator= leaves the flags behind; a ring slot is reused,
+    // so they are carried over here.
+    target = point;
+    target.drag = point.drag;
+    target.touch = point.touch;
+    target.drag2 = point.drag2;
+    target.touch2 = point.touch2;
+}
+
+CurveStream::CurveStream(int capacity) :
+    m_capacity(0), m_first(0), m_size(0), m_appended(0),
+    m_sum(0), m_summed(0), m_inversions(0), m_dirty(false)
+{
+    setCapacity(capacity);
+}
+
+void CurveStream::setCapacity(int capacity)
+{
+    QVector<CurvePoint> keep = points();
+    m_capacity = qMax(0, capacity);
+    assign(keep);
+}
+
+int CurveStream::capacity() const
+{
+    return m_capacity;
+}
+
+int CurveStream::size() const
+{
+    return m_size;
+}
+
+void CurveStream::clear()
+{
+    m_points = QVector<CurvePoint>(m_capacity);
+    m_min.items.resize(m_capacity);
+    m_max.items.resize(m_capacity);
+    m_first = 0;
+    m_size = 0;
+    m_appended = 0;
+    m_min.head = m_min.count = 0;
+    m_max.head = m_max.count = 0;
+    m_sum = 0;
+    m_summed = 0;
+    m_inversions = 0;
+    m_dirty = false;
+}
+
+void CurveStream::assign(const QVector<CurvePoint> &points)
+{
+    clear();
+    m_dirty = true;
+    for (int i = qMax(0, points.size() - m_capacity); i < points.size(); i++)
+    {
+        append(points.at(i));
+    }
+    rebuild();
+}
+
+bool CurveStream::append(const CurvePoint &point)
+{
+    if (!m_capacity)
+    {
+        return false;
+    }
+    const bool evicted = m_size == m_capacity;
+    if (evicted)
+    {
+        if (!m_dirty)
+        {
+            const qint64 oldest = m_appended - m_size;
+            if (m_size > 1 && x(1) < x(0))
+            {
+                m_inversions--;
+            }
+            m_sum -= y(oldest);
+            pop(m_min, oldest);
+            pop(m_max, oldest);
+        }
+        m_first = m_first + 1 == m_capacity ? 0 : m_first + 1;
+        m_size--;
+    }
+    copyPoint(m_points[slot(m_size)], point);
+    m_size++;
+    const qint64 sequence = m_appended++;
+    if (!m_dirty)
+    {
+        if (m_size > 1 && x(m_size - 1) < x(m_size - 2))
+        {
+            m_inversions++;
+        }
+        push(m_min, sequence, false);
+        push(m_max, sequence, true);
+        // Re-add the window from scratch every capacity appends so the
+        // running sum cannot drift; amortized that is O(1) per point.
+        if (++m_summed >= m_capacity)
+        {
+            m_sum = 0;
+            for (int i = 0; i < m_size; i++)
+            {
+                m_sum += at(i).pos.y();
+            }
+            m_summed = 0;
+        }
+        else
+        {
+            m_sum += point.pos.y();
+        }
+    }
+    return evicted;
+}
+
+bool CurveStream::insert(int i, const CurvePoint &point)
+{
+    if (!m_capacity)
+    {
+        return false;
+    }
+    const bool evicted = m_size == m_capacity;
+    if (evicted)
+    {
+        m_first = m_first + 1 == m_capacity ? 0 : m_first + 1;
+        m_size--;
+        i = qMax(0, i - 1);
+    }
+    m_size++;
+    for (int k = m_size - 1; k > i; k--)
+    {
+        copyPoint(m_points[slot(k)], at(k - 1));
+    }
+    copyPoint(m_points[slot(i)], point);
+    m_appended++;
+    m_dirty = true;
+    return evicted;
+}
+
+void CurveStream::remove(int i)
+{
+    for (int k = i; k < m_size - 1; k++)
+    {
+        copyPoint(m_points[slot(k)], at(k + 1));
+    }
+    m_size--;
+    m_appended--;
+    m_dirty = true;
+}
+
+CurvePoint &CurveStream::ref(int i)
+{
+    m_dirty = true;
+    return m_points[slot(i)];
+}
+
+QVector<CurvePoint> CurveStream::points() const
+{
+    QVector<CurvePoint> points;
+    points.reserve(m_size);
+    for (int i = 0; i < m_size; i++)
+    {
+        points.append(at(i));
+    }
+    return points;
+}
+
+float CurveStream::min()
+{
+    rebuild();
+    return m_min.count ? y(m_min.items.at(m_min.head)) : 0;
+}
+
+float CurveStream::max()
+{
+    rebuild();
+    return m_max.count ? y(m_max.items.at(m_max.head)) : 0;
+}
+
+float CurveStream::average()
+{
+    rebuild();
+    return m_size ? static_cast<float>(m_sum / m_size) : 0;
+}
+
+bool CurveStream::sorted()
+{
+    rebuild();
+    return m_inversions == 0;
+}
+
+void CurveStream::push(CurveStream::Queue &queue, qint64 sequence, bool greater)
+{
+    const float value = y(sequence);
+    while (queue.count)
+    {
+        int back = queue.head + queue.count - 1;
+        back -= back >= m_capacity ? m_capacity : 0;
+        const float last = y(queue.items.at(back));
+        if (greater ? last > value : last < value)
+        {
+            break;
+        }
+        queue.count--;
+    }
+    int end = queue.head + queue.count;
+    end -= end >= m_capacity ? m_capacity : 0;
+    queue.items[end] = sequence;
+    queue.count++;
+}
+
+void CurveStream::pop(CurveStream::Queue &queue, qint64 sequence)
+{
+    if (queue.count && queue.items.at(queue.head) == sequence)
+    {
+        queue.head = queue.head + 1 == m_capacity ? 0 : queue.head + 1;
+        queue.count--;
+    }
+}
+
+void CurveStream::rebuild()
+{
+    if (!m_dirty)
+    {
+        return;
+    }
+    m_dirty = false;
+    m_min.head = m_min.count = 0;
+    m_max.head = m_max.count = 0;
+    m_sum = 0;
+    m_summed = 0;
+    m_inversions = 0;
+    const qint64 oldest = m_appended - m_size;
+    for (int i = 0; i < m_size; i++)
+    {
+        if (i > 0 && x(i) < x(i - 1))
+        {
+            m_inversions++;
+        }
+        m_sum += at(i).pos.y();
+        push(m_min, oldest + i, false);
+        push(m_max, oldest + i, true);
+    }
+}
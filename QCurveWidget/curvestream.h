@@ -0,0 +1,77 @@
+#ifndef CURVESTREAM_H
+#define CURVESTREAM_H
+
+#include "curvelines.h"
+
+// Fixed-capacity ring of the newest points. Appending is O(1), and once
+// the ring is full each append drops the oldest point. Min, max and
+// average over the window are kept up to date as points come and go.
+// ref() may change a point in place, so the next query after it rescans
+// the window once.
+class CurveStream
+{
+public:
+    explicit CurveStream(int capacity = 0);
+
+public:
+    // Keeps the newest points that still fit.
+    void setCapacity(int capacity);
+    int capacity() const;
+    int size() const;
+    void clear();
+    void assign(const QVector<CurvePoint>& points);
+
+    // Returns true when the oldest point had to make room.
+    bool append(const CurvePoint& point);
+    // Same as append() when the ring is full; a point meant to go before
+    // the oldest one takes its place.
+    bool insert(int i, const CurvePoint& point);
+    void remove(int i);
+
+    const CurvePoint& at(int i) const { return m_points.at(slot(i)); }
+    float x(int i) const { return m_points.at(slot(i)).pos.x(); }
+    CurvePoint& ref(int i);
+    QVector<CurvePoint> points() const;
+
+    float min();
+    float max();
+    float average();
+    bool sorted();
+
+private:
+    // Monotonic queue of sequence numbers; the front is the window's
+    // extreme, the back the newest candidate.
+    class Queue
+    {
+    public:
+        Queue() : head(0), count(0) {}
+
+    public:
+        QVector<qint64> items;
+        int head;
+        int count;
+    };
+
+    int slot(int i) const { return m_first + i < m_capacity ? m_first + i : m_first + i - m_capacity; }
+    float y(qint64 sequence) const { return at(static_cast<int>(sequence - (m_appended - m_size))).pos.y(); }
+    void push(Queue& queue, qint64 sequence, bool greater);
+    void pop(Queue& queue, qint64 sequence);
+    void rebuild();
+
+private:
+    QVector<CurvePoint> m_points;
+    int m_capacity;
+    int m_first;
+    int m_size;
+    // Sequence number of the next append; the oldest point has
+    // m_appended - m_size.
+    qint64 m_appended;
+    Queue m_min;
+    Queue m_max;
+    double m_sum;
+    int m_summed;
+    int m_inversions;
+    bool m_dirty;
+};
+
+#endif // CURVESTREAM_H
@@ -1,6 +1,11 @@
 #include <QApplication>
+#include <QFileInfo>
 #include "qcurveeditwidget.h"
 #include "qcurvesocketwidget.h"
+#include "curveimport.h"
+#include "curveexport.h"
+#include "curvecodegen.h"
+#include "curveplayer.h"
 
 
 int main(int argc, char *argv[])
@@ -12,10 +17,134 @@ int main(int argc, char *argv[])
     QCurveCenterData *socket = QCurveCenterData::instance();
     socket->remoteConnect();
 
+    int listen = a.arguments().indexOf("--listen");
+    if(listen > 0)
+    {
+        quint16 port = static_cast<quint16>(a.arguments().value(listen + 1, "8082").toUInt());
+        socket->remoteListen(port);
+    }
+    if(a.arguments().contains("--viewport"))
+    {
+        socket->setSyncMode(QCurveCenterData::Sync_Viewport);
+    }
+
     CurveLines *line = w.getCurveLines();
+    int open = a.arguments().indexOf("--open");
+    if(open > 0 && !line->open(a.arguments().value(open + 1)))
+    {
+        qDebug() << "open failed:" << line->errorString();
+    }
+    int save = a.arguments().indexOf("--save");
+    if(save > 0)
+    {
+        w.setSavePath(a.arguments().value(save + 1));
+    }
+    else if(open > 0)
+    {
+        w.setSavePath(a.arguments().value(open + 1));
+    }
     QObject::connect(socket, &QCurveCenterData::updateCurve, line, &CurveLines::onCurve);
     QObject::connect(line, &CurveLines::updateCurve, socket, &QCurveCenterData::onCurve);
+    QObject::connect(line, &CurveLines::appendCurve, socket, &QCurveCenterData::onStream);
+    socket->setSource(line);
     QObject::connect(&w, &QCurveEditWidget::updateZoom, socket, &QCurveCenterData::onZoom);
+    QObject::connect(socket, &QCurveCenterData::updateTips, &w, &QCurveEditWidget::onTips);
+    QObject::connect(&w, &QCurveEditWidget::exportTips, socket, &QCurveCenterData::onExport);
+
+    CurveSet *channels = w.getCurveSet();
+    QObject::connect(channels, &CurveSet::updateChannel, socket, &QCurveCenterData::onChannel);
+    QObject::connect(channels, &CurveSet::updateMapped, socket, &QCurveCenterData::onMappedChannel);
+    for (int i = 1; i < a.arguments().size() - 1; i++)
+    {
+        if(a.arguments().at(i) != "--channel")
+        {
+            continue;
+        }
+        QString path = a.arguments().at(i + 1);
+        int index = channels->addChannel(QFileInfo(path).completeBaseName());
+        CurveLines *channel = channels->channel(index);
+        if(!channel->open(path))
+        {
+            qDebug() << "channel open failed:" << channel->errorString();
+            channels->removeChannel(index);
+        }
+    }
+
+    int import = a.arguments().indexOf("--import");
+    if(import > 0)
+    {
+        QString path = a.arguments().value(import + 1);
+        int simplifyIndex = a.arguments().indexOf("--simplify");
+        QString simplify = simplifyIndex > 0 ? a.arguments().value(simplifyIndex + 1) : QString();
+        int tolerance = a.arguments().indexOf("--tolerance");
+        CurveImport importer(CurveImport::formatFromName(path),
+                             simplify == "curves" ? CurveImport::Simplify_Curves :
+                             simplify == "lines" ? CurveImport::Simplify_Lines : CurveImport::Simplify_None,
+                             tolerance > 0 ? a.arguments().value(tolerance + 1).toFloat() : 0);
+        if(importer.read(path))
+        {
+            line->setPoints(importer.points());
+            qDebug() << "imported" << importer.samples() << "samples as" << importer.points().size() << "points";
+        }
+        else
+        {
+            qDebug() << "import failed:" << importer.errorString();
+        }
+    }
+
+    int exportIndex = a.arguments().indexOf("--export");
+    if(exportIndex > 0 && line->pointsSize() > 1)
+    {
+        int samples = a.arguments().indexOf("--samples");
+        qint64 count = samples > 0 ? a.arguments().value(samples + 1).toLongLong() : 1000000;
+        CurveExport::Format format = a.arguments().contains("--zlib") ? CurveExport::Zlib : CurveExport::Float32;
+        QString error;
+        if(!CurveExport::write(*line, a.arguments().value(exportIndex + 1), line->pointAt(0).pos.x(),
+                               line->pointAt(line->pointsSize() - 1).pos.x(), count, format, 0, &error))
+        {
+            qDebug() << "export failed:" << error;
+        }
+    }
+
+    int bake = a.arguments().indexOf("--bake");
+    if(bake > 0)
+    {
+        QString path = a.arguments().value(bake + 1);
+        int table = a.arguments().indexOf("--table");
+        QString error;
+        if(!CurveCodegen::write(*line, path, QFileInfo(path).completeBaseName(),
+                                table > 0 ? CurveCodegen::Table : CurveCodegen::Piecewise, 1e-4f,
+                                table > 0 ? a.arguments().value(table + 1).toInt() : CurveCodegen::DefaultSamples, &error))
+        {
+            qDebug() << "bake failed:" << error;
+        }
+    }
+
+    int stream = a.arguments().indexOf("--stream");
+    if(stream > 0)
+    {
+        int capacity = a.arguments().value(stream + 1, "100000").toInt();
+        socket->setStreaming(capacity);
+        line->setStreaming(capacity);
+        w.setFollowTail(true);
+    }
+
+    CurvePlayer player(line);
+    int play = a.arguments().indexOf("--play");
+    if(play > 0)
+    {
+        int rate = a.arguments().indexOf("--rate");
+        player.setRate(rate > 0 ? a.arguments().value(rate + 1).toInt() : 1000);
+        player.setLoop(a.arguments().contains("--loop"));
+        player.addSink(new CurveFileSink(a.arguments().value(play + 1)));
+        QObject::connect(&player, &CurvePlayer::finished, [&player]()
+        {
+            CurvePlayerStats stats = player.stats();
+            qDebug() << "played" << stats.ticks << "ticks," << stats.overruns << "overruns," << stats.dropped
+                     << "dropped, jitter p99" << stats.jitter.percentile(99) << "ns";
+        });
+        player.start();
+    }
 
     return a.exec();
 }
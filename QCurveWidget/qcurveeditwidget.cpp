@@ -4,18 +4,27 @@
 #include <QPainter>
 #include <QApplication>
 #include <QWheelEvent>
+#include <QFileDialog>
 
 const int DotSize = 3;
 const int GridWidth = 1;
+const int FollowInterval = 16;
+const int FollowMargin = 40;
+const int HitDistance = 8;
+const float StretchFactor = 1.25f;
 const QColor DotColor(255, 255, 255);
 const QColor DotEdgeColor(0, 0, 0);
 const QColor DotSelectionColor(255, 255, 255);
 const QColor DotEdgeSelectionColor(255, 0, 0);
 const QColor LineColor(237,138,63);
 const QColor Line2Color(129,52,175);
+const QColor ChannelColors[] = {
+    QColor(86,180,233), QColor(0,158,115), QColor(240,228,66), QColor(204,121,167), QColor(213,94,0),
+};
 
 QCurveEditWidget::QCurveEditWidget(QWidget *parent) :
-    QWidget(parent), m_hide(false), m_select(false), m_scale(100.0f), m_curveMove(CurveLines::XY_Axis)
+    QWidget(parent), m_hide(false), m_select(false), m_scale(100.0f),
+    m_follow(false), m_streamPending(false), m_curveMove(CurveLines::XY_Axis)
 {
     QPalette pal(palette());
     pal.setColor(QPalette::Background, QColor(38, 38, 38));
@@ -25,6 +34,13 @@ QCurveEditWidget::QCurveEditWidget(QWidget *parent) :
     setMouseTracking(true);
     setContextMenuPolicy(Qt::CustomContextMenu);
     connect(this, &QWidget::customContextMenuRequested, this, &QCurveEditWidget::showContextMenu);
+    connect(&m_curveSet, &CurveSet::updateChannel, this, [this]() { update(); });
+
+    // Streamed points repaint at most once per interval, however fast they
+    // arrive.
+    m_timer.setInterval(FollowInterval);
+    connect(&m_timer, &QTimer::timeout, this, &QCurveEditWidget::onTimer);
+    connect(&m_curveLines, &CurveLines::appendCurve, this, &QCurveEditWidget::onStream);
 }
 
 QCurveEditWidget::~QCurveEditWidget()
@@ -37,6 +53,23 @@ CurveLines *QCurveEditWidget::getCurveLines()
     return &m_curveLines;
 }
 
+CurveSet *QCurveEditWidget::getCurveSet()
+{
+    return &m_curveSet;
+}
+
+void QCurveEditWidget::addComposite(const CurveExprPtr &expr)
+{
+    m_composites.append(expr);
+    update();
+}
+
+void QCurveEditWidget::clearComposites()
+{
+    m_composites.clear();
+    update();
+}
+
 void QCurveEditWidget::addCurveLine(const CurvePoint &point)
 {
     m_curveLines.insertPoint(point);
@@ -48,6 +81,35 @@ void QCurveEditWidget::clearCurveLines()
     m_curveLines.deleteTouchPoint();
 }
 
+void QCurveEditWidget::setView(float scale, const QVector2D &centerOffset)
+{
+    m_scale = scale;
+    m_centerOffset = centerOffset;
+    updateZoom(m_scale, m_centerOffset.toPoint(), this->rect());
+    repaint();
+}
+
+void QCurveEditWidget::setFollowTail(bool follow)
+{
+    m_follow = follow;
+    onStream(QVector<CurvePoint>(), 0);
+}
+
+bool QCurveEditWidget::followTail()
+{
+    return m_follow;
+}
+
+void QCurveEditWidget::setSavePath(const QString &path)
+{
+    m_savePath = path;
+}
+
+QString QCurveEditWidget::savePath()
+{
+    return m_savePath;
+}
+
 void QCurveEditWidget::resetView()
 {
     m_centerOffset = QVector2D(size().width() / 2, size().height() / 2);
@@ -65,6 +127,11 @@ void QCurveEditWidget::hideTips()
     repaint();
 }
 
+void QCurveEditWidget::toggleFollowTail()
+{
+    setFollowTail(!m_follow);
+}
+
 void QCurveEditWidget::moveType()
 {
     switch (m_curveMove) {
@@ -115,12 +182,61 @@ void QCurveEditWidget::addPoint2()
     repaint();
 }
 
+void QCurveEditWidget::splitPoint()
+{
+    QPoint pos = this->mapFromGlobal(QCursor().pos());
+    float t;
+    QVector2D nearest;
+    int segment = m_curveLines.hitSegment(toAnalyticCoordinates(pos), HitDistance / m_scale, t, nearest);
+    if (segment)
+    {
+        m_curveLines.splitSegment(segment, t);
+        repaint();
+    }
+}
+
 void QCurveEditWidget::deletePoint()
 {
     m_curveLines.deleteTouchPoint();
     repaint();
 }
 
+void QCurveEditWidget::saveCurve()
+{
+    QString path = m_curveLines.pointsMapped() ? m_curveLines.fileName() : m_savePath;
+    if(path.isEmpty())
+    {
+        path = QFileDialog::getSaveFileName(this, tr("Save curve"), QString(), tr("Curve files (*.crv)"));
+        if(path.isEmpty())
+        {
+            qDebug() << "save: no path, start with --save <file> or pick one";
+            return;
+        }
+        m_savePath = path;
+    }
+    if(!m_curveLines.save(path))
+    {
+        qDebug() << "save" << path << "failed:" << m_curveLines.errorString();
+    }
+    repaint();
+}
+
+void QCurveEditWidget::undoEdit()
+{
+    if(m_curveLines.undo())
+    {
+        repaint();
+    }
+}
+
+void QCurveEditWidget::redoEdit()
+{
+    if(m_curveLines.redo())
+    {
+        repaint();
+    }
+}
+
 void QCurveEditWidget::upPoint()
 {
     QVector2D offset(0, 1);
@@ -193,9 +309,71 @@ void QCurveEditWidget::rightShiftPoint()
     repaint();
 }
 
-void QCurveEditWidget::onTimer()
+void QCurveEditWidget::stretchPoint(float factor)
 {
+    QPoint pos = this->mapFromGlobal(QCursor().pos());
+    QVector2D scale(m_curveMove == CurveLines::Y_Axis ? 1 : factor,
+                    m_curveMove == CurveLines::X_Axis ? 1 : factor);
+    if(m_curveLines.transformPoints(scale, toAnalyticCoordinates(pos)))
+    {
+        repaint();
+    }
+}
+
+void QCurveEditWidget::upStretchPoint()
+{
+    stretchPoint(StretchFactor);
+}
+
+void QCurveEditWidget::downStretchPoint()
+{
+    stretchPoint(1 / StretchFactor);
+}
+
+void QCurveEditWidget::quantizePoint()
+{
+    QVector2D grid(m_curveMove == CurveLines::Y_Axis ? 0 : 1,
+                   m_curveMove == CurveLines::X_Axis ? 0 : 1);
+    if(m_curveLines.quantizePoints(grid))
+    {
+        repaint();
+    }
+}
+
+void QCurveEditWidget::onTips(const QStringList &tips)
+{
+    m_remoteTips = tips;
+    update();
+}
 
+void QCurveEditWidget::onStream(const QVector<CurvePoint> &points, int dropped)
+{
+    Q_UNUSED(points);
+    Q_UNUSED(dropped);
+    m_streamPending = true;
+    if(!m_timer.isActive())
+    {
+        m_timer.start();
+    }
+}
+
+void QCurveEditWidget::onTimer()
+{
+    if(!m_streamPending)
+    {
+        m_timer.stop();
+        return;
+    }
+    m_streamPending = false;
+    if(m_follow && m_curveLines.pointsSize())
+    {
+        // Scrolling is only a new offset; the paint that follows draws
+        // just the points inside the view.
+        float x = m_curveLines.pointAt(m_curveLines.pointsSize() - 1).pos.x();
+        m_centerOffset.setX(size().width() - FollowMargin - x * m_scale);
+        updateZoom(m_scale, m_centerOffset.toPoint(), this->rect());
+    }
+    update();
 }
 
 void QCurveEditWidget::showContextMenu(const QPoint &pos)
@@ -209,6 +387,17 @@ void QCurveEditWidget::paintEvent(QPaintEvent *event)
     QPainter painter(this);
     painter.setRenderHint(QPainter::Antialiasing, false);
 
+    drawGrid(painter);
+    drawTips(painter);
+    drawCurves(painter);
+    drawDots(painter);
+    drawLabels(painter);
+
+    QWidget::paintEvent(event);
+}
+
+void QCurveEditWidget::drawGrid(QPainter &painter)
+{
     // Horizontal lines
     painter.setPen(QPen(QColor(46, 46, 46), GridWidth, Qt::SolidLine, Qt::FlatCap));
     float y = toAnalyticCoordinates(QPoint(0, 0)).y();
@@ -245,12 +434,15 @@ void QCurveEditWidget::paintEvent(QPaintEvent *event)
         painter.drawLine(p.x(), 0, p.x(), size().height());
     if (0 <= p.y() && p.y() <= size().height())
         painter.drawLine(0, p.y(), size().width(), p.y());
+}
 
+void QCurveEditWidget::drawTips(QPainter &painter)
+{
     // Tips
     double length = 0;
     if(m_curveLines.pointsSize() > 1)
     {
-        length = static_cast<double>(m_curveLines.lastPoint().pos.x()) - static_cast<double>(m_curveLines.firstPoint().pos.x());
+        length = static_cast<double>(m_curveLines.pointAt(m_curveLines.pointsSize() - 1).pos.x()) - static_cast<double>(m_curveLines.pointAt(0).pos.x());
     }
     QStringList tips;
     tips << tr("Count:%1").arg(m_curveLines.pointsSize());
@@ -258,6 +450,14 @@ void QCurveEditWidget::paintEvent(QPaintEvent *event)
     tips << tr("Max:%1").arg(static_cast<double>(m_curveLines.getMaxValue()));
     tips << tr("Min:%1").arg(static_cast<double>(m_curveLines.getMinValue()));
     tips << tr("Average:%1").arg(static_cast<double>(m_curveLines.getAverageValue()));
+    if(!m_integralTip.isEmpty())
+    {
+        tips << m_integralTip;
+    }
+    if(m_curveLines.pointsMapped())
+    {
+        tips << tr("File:%1").arg(m_curveLines.fileName());
+    }
     switch (m_curveMove) {
     case CurveLines::X_Axis:
         tips << tr("MoveType:X_Axis");
@@ -269,6 +469,7 @@ void QCurveEditWidget::paintEvent(QPaintEvent *event)
         tips << tr("MoveType:XY_Axis");
         break;
     }
+    tips << m_remoteTips;
     tips << tr("\n");
     if(m_hide)
     {
@@ -277,25 +478,97 @@ void QCurveEditWidget::paintEvent(QPaintEvent *event)
     else{
         tips << tr("Key_H:hide keys tips");
         tips << tr("Key_M:change move type");
+        tips << tr("Key_F:follow the newest point");
         tips << tr("Key_A:add line point");
         tips << tr("Key_C:add curve point");
+        tips << tr("Key_I:insert point on the curve");
+        tips << tr("Key_Q:snap selected points to the grid");
         tips << tr("Key_D:delete selected point");
         tips << tr("Key_Up:point move up");
         tips << tr("Key_Down:point move down");
         tips << tr("Key_Left:focus move left");
         tips << tr("Key_Right:focus move right");
         tips << tr("Key_Space:find near point");
+        tips << tr("Key_E:export sync latency");
+        tips << tr("Key_S:save curve file");
+        tips << tr("Key_Shift+Up:stretch selection about the cursor");
+        tips << tr("Key_Shift+Down:shrink selection about the cursor");
+        tips << tr("Key_Ctrl+Z:undo edit");
+        tips << tr("Key_Ctrl+Y:redo edit");
     }
     painter.setPen(QPen(QColor(200, 200, 200), GridWidth, Qt::SolidLine, Qt::FlatCap));
     painter.drawText(10, 10, size().width(), size().height(), Qt::AlignLeft | Qt::AlignTop, tips.join("\n"));
+}
 
+void QCurveEditWidget::drawChannels(QPainter &painter)
+{
+    // One batched evaluation per frame: every channel sampled at each pixel
+    // column, then clipped to its own extent. Composites go through their
+    // own caches, so an unchanged view reuses the last frame's values.
+    const int width = size().width();
+    const int channels = m_curveSet.channelCount();
+    if ((!channels && m_composites.isEmpty()) || width < 2)
+    {
+        return;
+    }
+    QVector<float> xs(width);
+    for (int px = 0; px < width; px++)
+    {
+        xs[px] = toAnalyticCoordinates(QPoint(px, 0)).x();
+    }
+    const int colors = static_cast<int>(sizeof(ChannelColors) / sizeof(ChannelColors[0]));
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    QPolygon polyline;
+    QVector<float> ys = m_curveSet.evaluate(xs);
+    for (int c = 0; c < channels + m_composites.size(); c++)
+    {
+        float from;
+        float to;
+        bool bounded;
+        const float* values;
+        if (c < channels)
+        {
+            if (!m_curveSet.extent(c, from, to))
+            {
+                continue;
+            }
+            bounded = true;
+            values = ys.constData() + c * width;
+        }
+        else
+        {
+            const CurveExprPtr& expr = m_composites.at(c - channels);
+            bounded = expr->domain(from, to);
+            ys.resize(width);
+            expr->evaluate(xs.constData(), ys.data(), width);
+            values = ys.constData();
+        }
+        polyline.clear();
+        for (int px = 0; px < width; px++)
+        {
+            if (!bounded || (xs.at(px) >= from && xs.at(px) <= to))
+            {
+                polyline.append(toCanvasCoordinates(QVector2D(xs.at(px), values[px])));
+            }
+        }
+        painter.setPen(QPen(ChannelColors[c % colors], 2, c < channels ? Qt::SolidLine : Qt::DashLine, Qt::FlatCap));
+        painter.drawPolyline(polyline);
+    }
+}
+
+void QCurveEditWidget::drawCurves(QPainter &painter)
+{
+    drawChannels(painter);
 
     // Curve lines
     painter.setRenderHint(QPainter::Antialiasing, true);
-    for (int i = 1; i < m_curveLines.pointsSize(); i++)
+    int first;
+    int last;
+    visibleRange(first, last);
+    for (int i = qMax(1, first); i <= last; i++)
     {
-        const CurvePoint& point = m_curveLines.currentPoint(i);
-        const CurvePoint& pointd = m_curveLines.evaluatePoint(i);
+        const CurvePoint point = m_curveLines.pointAt(i);
+        const CurvePoint pointd = m_curveLines.pointAt(i - 1);
         if (point.type == CurvePoint::Line)
         {
             painter.setPen(QPen(LineColor, 2, Qt::SolidLine, Qt::FlatCap));
@@ -339,13 +612,16 @@ void QCurveEditWidget::paintEvent(QPaintEvent *event)
         }
     }
     painter.setRenderHint(QPainter::Antialiasing, false);
+}
 
-    // Dots
-    const int spacWidth = DotSize * 8;
-    const int spacHeight = DotSize * 2;
-    for (int i = 0; i < m_curveLines.pointsSize(); i++)
+void QCurveEditWidget::drawDots(QPainter &painter)
+{
+    int first;
+    int last;
+    visibleRange(first, last);
+    for (int i = first; i <= last; i++)
     {
-        const CurvePoint& point = m_curveLines.currentPoint(i);
+        const CurvePoint point = m_curveLines.pointAt(i);
 
         QColor col = point.touch ? DotSelectionColor : DotColor;
         QColor colEdge = point.touch ? DotEdgeSelectionColor : DotEdgeColor;
@@ -355,6 +631,20 @@ void QCurveEditWidget::paintEvent(QPaintEvent *event)
 
         QPoint center = toCanvasCoordinates(point.pos);
         painter.drawRect(center.x() - DotSize, center.y() - DotSize, DotSize * 2, DotSize * 2);
+    }
+}
+
+void QCurveEditWidget::drawLabels(QPainter &painter)
+{
+    const int spacWidth = DotSize * 8;
+    const int spacHeight = DotSize * 2;
+    int first;
+    int last;
+    visibleRange(first, last);
+    for (int i = first; i <= last; i++)
+    {
+        const CurvePoint point = m_curveLines.pointAt(i);
+        QPoint center = toCanvasCoordinates(point.pos);
 
         QColor pcol = point.touch ? DotEdgeSelectionColor : DotColor;
         painter.setPen(QPen(pcol));
@@ -373,8 +663,6 @@ void QCurveEditWidget::paintEvent(QPaintEvent *event)
             }
         }
     }
-
-    QWidget::paintEvent(event);
 }
 
 void QCurveEditWidget::mousePressEvent(QMouseEvent *event)
@@ -453,6 +741,7 @@ void QCurveEditWidget::mouseReleaseEvent(QMouseEvent *event)
                 m_curveLines.releasePoints();
             }
         }
+        updateIntegral();
         repaint();
     }
     if(m_curveLines.pointsTouchSize())
@@ -530,12 +819,21 @@ void QCurveEditWidget::keyPressEvent(QKeyEvent *event)
         case Qt::Key_M:
             moveType();
             break;
+        case Qt::Key_F:
+            toggleFollowTail();
+            break;
         case Qt::Key_A:
             addPoint();
             break;
         case Qt::Key_C:
             addPoint2();
             break;
+        case Qt::Key_I:
+            splitPoint();
+            break;
+        case Qt::Key_Q:
+            quantizePoint();
+            break;
         case Qt::Key_D:
         case Qt::Key_Delete:
             deletePoint();
@@ -558,6 +856,12 @@ void QCurveEditWidget::keyPressEvent(QKeyEvent *event)
         case Qt::Key_Escape:
             releasePoint();
             break;
+        case Qt::Key_E:
+            emit exportTips();
+            break;
+        case Qt::Key_S:
+            saveCurve();
+            break;
         default:
             break;
         }
@@ -581,6 +885,12 @@ void QCurveEditWidget::keyPressEvent(QKeyEvent *event)
         case Qt::Key_Right:
             rightContorlPoint();
             break;
+        case Qt::Key_Z:
+            undoEdit();
+            break;
+        case Qt::Key_Y:
+            redoEdit();
+            break;
         default:
             break;
         }
@@ -589,6 +899,12 @@ void QCurveEditWidget::keyPressEvent(QKeyEvent *event)
     {
         switch (event->key())
         {
+        case Qt::Key_Up:
+            upStretchPoint();
+            break;
+        case Qt::Key_Down:
+            downStretchPoint();
+            break;
         case Qt::Key_Left:
             leftShiftPoint();
             break;
@@ -599,6 +915,7 @@ void QCurveEditWidget::keyPressEvent(QKeyEvent *event)
             break;
         }
     }
+    updateIntegral();
     QWidget::keyPressEvent(event);
 }
 
@@ -620,3 +937,50 @@ QVector2D QCurveEditWidget::toAnalyticCoordinates(const QPoint &canvasPos)
     float y = (-canvasPos.y() + m_centerOffset.y()) / m_scale;
     return QVector2D(x, y);
 }
+
+void QCurveEditWidget::updateIntegral()
+{
+    // Worked out when the selection or the curve changes, not per paint.
+    // Mapped, streaming and unsorted curves are skipped: the first would
+    // need an area tree over the whole file, the others a full pass.
+    m_integralTip.clear();
+    if(m_curveLines.pointsSize() < 2 || m_curveLines.pointsMapped() || m_curveLines.pointsStreaming()
+            || !m_curveLines.pointsSorted())
+    {
+        return;
+    }
+    // Over the selection when there is one, otherwise over the view.
+    float from;
+    float to;
+    if(!m_curveLines.touchRange(from, to) || from == to)
+    {
+        from = toAnalyticCoordinates(QPoint(0, 0)).x();
+        to = toAnalyticCoordinates(QPoint(size().width(), 0)).x();
+    }
+    m_integralTip = tr("Integral[%1,%2]:%3").arg(static_cast<double>(from)).arg(static_cast<double>(to))
+            .arg(m_curveLines.integral(from, to));
+}
+
+void QCurveEditWidget::visibleRange(int &first, int &last)
+{
+    const int n = m_curveLines.pointsSize();
+    first = 0;
+    last = n - 1;
+    if(n < 2 || !m_curveLines.pointsSorted())
+    {
+        return;
+    }
+    float x0 = toAnalyticCoordinates(QPoint(0, 0)).x();
+    float x1 = toAnalyticCoordinates(QPoint(size().width(), 0)).x();
+    if(x1 < m_curveLines.pointAt(0).pos.x() || x0 > m_curveLines.pointAt(n - 1).pos.x())
+    {
+        last = -1;
+        return;
+    }
+    // One extra segment on each side: a curve's control point may reach
+    // into the view from a segment whose ends are both outside it.
+    int segment = m_curveLines.findSegment(x0);
+    first = segment > 1 ? segment - 2 : 0;
+    segment = m_curveLines.findSegment(x1);
+    last = segment > 0 ? qMin(n - 1, segment + 1) : n - 1;
+}
@@ -4,8 +4,11 @@
 #include <QWidget>
 #include <QVector2D>
 #include <QTimer>
+#include <QPainter>
 #include <QDebug>
 #include "curvelines.h"
+#include "curveset.h"
+#include "curveexpr.h"
 
 class QCurveEditWidget : public QWidget
 {
@@ -16,25 +19,51 @@ public:
 
 public:
     CurveLines *getCurveLines();
+    CurveSet *getCurveSet();
+    // Composites are drawn next to the set's channels, dashed.
+    void addComposite(const CurveExprPtr& expr);
+    void clearComposites();
     void addCurveLine(const CurvePoint& point);
     void clearCurveLines();
+    void setView(float scale, const QVector2D& centerOffset);
+    // Keeps the newest point at the right edge as a streaming curve grows.
+    void setFollowTail(bool follow);
+    bool followTail();
+    // Where Key_S writes an in-memory curve; a mapped one saves over its
+    // own file. Without a path, Key_S asks for one.
+    void setSavePath(const QString& path);
+    QString savePath();
+
+public:
+    void drawGrid(QPainter& painter);
+    void drawTips(QPainter& painter);
+    void drawCurves(QPainter& painter);
+    void drawChannels(QPainter& painter);
+    void drawDots(QPainter& painter);
+    void drawLabels(QPainter& painter);
 
 signals:
     void updateZoom(float, QPoint, QRect);
     void closeWidget();
+    void exportTips();
 
 public slots:
     void resetView();
     void remoteView();
     void hideTips();
     void moveType();
+    void toggleFollowTail();
 
     void findPoint();
     void releasePoint();
 
     void addPoint();
     void addPoint2();
+    void splitPoint();
     void deletePoint();
+    void saveCurve();
+    void undoEdit();
+    void redoEdit();
 
     void upPoint();
     void downPoint();
@@ -49,6 +78,12 @@ public slots:
 
     void leftShiftPoint();
     void rightShiftPoint();
+    void upStretchPoint();
+    void downStretchPoint();
+    void quantizePoint();
+
+    void onTips(const QStringList& tips);
+    void onStream(const QVector<CurvePoint>& points, int dropped);
 
 protected slots:
     void onTimer();
@@ -69,6 +104,9 @@ protected:
 private:
     QPoint toCanvasCoordinates(const QVector2D& analyticPos);
     QVector2D toAnalyticCoordinates(const QPoint& canvasPos);
+    void visibleRange(int& first, int& last);
+    void stretchPoint(float factor);
+    void updateIntegral();
 
 private:
     QTimer m_timer;
@@ -84,7 +122,16 @@ private:
     QPoint m_dragPosition;
     QVector2D m_dragOffset;
 
+    QStringList m_remoteTips;
+    QString m_integralTip;
+
+    bool m_follow;
+    bool m_streamPending;
+    QString m_savePath;
+
     CurveLines m_curveLines;
+    CurveSet m_curveSet;
+    QVector<CurveExprPtr> m_composites;
     CurveLines::MoveType m_curveMove;
 };
 
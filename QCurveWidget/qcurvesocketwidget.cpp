@@ -1,17 +1,102 @@
 #include "qcurvesocketwidget.h"
+#include <QRandomGenerator>
+#include <QDateTime>
+#include <QFile>
 
-QCurveCenterData::QCurveCenterData(QObject *parent) : QObject(parent), m_remote(0)
+const int ReconnectMin = 250;
+const int ReconnectMax = 30000;
+const int PingInterval = 5000;
+const qint64 SubscriberWindow = 1 << 20;
+const int CompressThreshold = 4096;
+const int SampleChunk = 8192;
+const int SampleLimit = 1 << 26;
+const int SentLimit = 1024;
+const int TipsInterval = 1000;
+const int StreamInterval = 16;
+
+QCurveCenterData::QCurveCenterData(QObject *parent) : QObject(parent),
+    m_remote(Remote_Disconnected), m_reconnect(false), m_pending(false), m_backoff(ReconnectMin),
+    m_zoomScale(1), m_remoteVersion(0), m_version(0), m_syncMode(Sync_Full), m_pointsVersion(0),
+    m_pointsSeq(0), m_pointsDirty(false), m_streamDrop(0), m_deltaDrop(0), m_deltaSeq(0), m_deltaDirty(false),
+    m_viewVersion(-1), m_mapped(false),
+    m_viewFirst(0), m_viewLast(-1), m_encoding(CurveFrame::Json), m_webServer(nullptr), m_editStamp(-1)
 {
+    m_clock.start();
+
+    for (int i = 0; i < 3; i++)
+    {
+        m_frameVersions[i] = -1;
+    }
+
     m_webSocket = new QWebSocket();
 
+    m_reconnectTimer.setSingleShot(true);
+    QObject::connect(&m_reconnectTimer, &QTimer::timeout, this, &QCurveCenterData::onReconnect);
+
+    m_tipsTimer.setInterval(TipsInterval);
+    QObject::connect(&m_tipsTimer, &QTimer::timeout, this, &QCurveCenterData::onTips);
+    m_tipsTimer.start();
+
+    m_sampleTimer.setSingleShot(true);
+    QObject::connect(&m_sampleTimer, &QTimer::timeout, this, &QCurveCenterData::onSample);
+
+    m_streamTimer.setSingleShot(true);
+    QObject::connect(&m_streamTimer, &QTimer::timeout, this, &QCurveCenterData::onStreamFlush);
+
+    m_pingTimer.setInterval(PingInterval);
+    QObject::connect(&m_pingTimer, &QTimer::timeout, this, &QCurveCenterData::onPing);
+
     QObject::connect(m_webSocket, &QWebSocket::connected, [&](){
         qDebug() << "connected";
-        m_remote = 1;
+        m_remote = Remote_Connected;
+        m_backoff = ReconnectMin;
+        m_stats.connects++;
+        m_uptime.start();
+        m_pingTimer.start();
+        onPing();
+
+        m_encoding = CurveFrame::Json;
+        m_viewVersion = -1;
+        m_remoteVersion = 0;
+        QJsonObject hello;
+        hello["encodings"] = CurveFrame::encodingNames();
+        QJsonObject helloData;
+        helloData["hello"] = hello;
+        m_webSocket->sendTextMessage(QString::fromUtf8(QJsonDocument(helloData).toJson(QJsonDocument::Compact)));
+        // A restarted server holds nothing, so the latest snapshot goes out
+        // even when nothing was edited while offline.
+        m_pending = m_version > 0;
+        remoteFlush();
     });
 
     QObject::connect(m_webSocket, &QWebSocket::disconnected, [&](){
         qDebug() << "disconnected";
-        m_remote = 0;
+        if(m_uptime.isValid())
+        {
+            m_stats.disconnects++;
+        }
+        m_uptime.invalidate();
+        m_pingTimer.stop();
+        remoteRetry();
+    });
+
+    QObject::connect(m_webSocket, &QWebSocket::stateChanged, [&](QAbstractSocket::SocketState state){
+        if(state == QAbstractSocket::UnconnectedState && m_remote == Remote_Connecting)
+        {
+            remoteRetry();
+        }
+    });
+
+    QObject::connect(m_webSocket, &QWebSocket::pong, [&](quint64 elapsedTime, const QByteArray &payload){
+        Q_UNUSED(payload);
+        m_stats.rtt = static_cast<qint64>(elapsedTime);
+        if(m_stats.rttAverage < 0)
+        {
+            m_stats.rttAverage = m_stats.rtt;
+        }
+        else{
+            m_stats.rttAverage = (m_stats.rttAverage * 7 + m_stats.rtt) / 8;
+        }
     });
 
     QObject::connect(m_webSocket, &QWebSocket::textMessageReceived, [&](const QString &message){
@@ -21,11 +106,6 @@ QCurveCenterData::QCurveCenterData(QObject *parent) : QObject(parent), m_remote(
 
 void QCurveCenterData::onZoom(float scale, QPoint offset, QRect rect)
 {
-    if(!m_remote)
-    {
-        remoteConnect();
-        return;
-    }
     QJsonArray offsetData;
     offsetData.append(offset.x());
     offsetData.append(offset.y());
@@ -41,38 +121,211 @@ void QCurveCenterData::onZoom(float scale, QPoint offset, QRect rect)
     zoomData["offset"] = offsetData;
     zoomData["rect"] = rectData;
     m_msgZoom = zoomData;
+    m_zoomScale = scale;
+    m_zoomOffset = offset;
+    m_zoomRect = rect;
+    remoteEdit();
     remoteSend();
 }
 
 void QCurveCenterData::onCurve(const QVector<CurvePoint> &points)
 {
-    if(!m_remote)
+    // A streaming window lives in m_sampleLines alone.
+    m_mapped = false;
+    m_msgPoints = m_sampleLines.pointsStreaming() ? QVector<CurvePoint>() : points;
+    m_pointsVersion++;
+    m_pointsDirty = true;
+    m_deltaDirty = false;
+    m_streamAppend.clear();
+    m_streamDrop = 0;
+    m_streamTimer.stop();
+    m_sampleLines.onCurve(points);
+    remoteEdit();
+    remoteSend();
+}
+
+void QCurveCenterData::onStream(const QVector<CurvePoint> &points, int dropped)
+{
+    if(!m_sampleLines.pointsStreaming())
+    {
+        // Without setStreaming() the window size is unknown: take the
+        // whole curve again.
+        m_msgPoints += points;
+        m_msgPoints.remove(0, qMin(dropped, m_msgPoints.size()));
+        onCurve(m_msgPoints);
+        return;
+    }
+
+    // The ring drops what the source dropped, since both share a capacity.
+    m_sampleLines.streamPoints(points);
+    m_streamAppend += points;
+    m_streamDrop += dropped;
+    const int capacity = m_sampleLines.streamCapacity();
+    if(m_streamAppend.size() > 2 * capacity)
+    {
+        // Receivers append before dropping, so points that came and went
+        // before the flush can be left out of both.
+        const int extra = m_streamAppend.size() - capacity;
+        m_streamAppend.remove(0, extra);
+        m_streamDrop -= extra;
+    }
+    remoteEdit();
+    if(!m_streamTimer.isActive())
+    {
+        m_streamTimer.start(StreamInterval);
+    }
+}
+
+void QCurveCenterData::onMapped()
+{
+    if(!m_source || !m_source->pointsMapped())
     {
-        remoteConnect();
         return;
     }
-    QJsonArray pointsData;
-    for(const CurvePoint& point : points)
-    {
-        QJsonObject object;
-        object["type"] = point.type;
-        QJsonArray array;
-        array.append((double)point.pos.x());
-        array.append((double)point.pos.y());
-        object["pos"] = array;
-        QJsonArray array2;
-        array2.append((double)point.pos2.x());
-        array2.append((double)point.pos2.y());
-        object["pos2"] = array2;
-        pointsData.append(object);
-    }
-    m_msgPoints = pointsData;
+    // Whatever was mirrored before is stale now.
+    m_mapped = true;
+    m_msgPoints.clear();
+    m_sampleLines.onCurve(QVector<CurvePoint>());
+    m_streamTimer.stop();
+    m_streamAppend.clear();
+    m_streamDrop = 0;
+    m_pointsVersion++;
+    m_pointsDirty = true;
+    m_deltaDirty = false;
+    remoteEdit();
     remoteSend();
 }
 
+void QCurveCenterData::setSource(CurveLines *lines)
+{
+    if(m_source)
+    {
+        QObject::disconnect(m_source, &CurveLines::updateMapped, this, &QCurveCenterData::onMapped);
+    }
+    m_source = lines;
+    if(lines)
+    {
+        QObject::connect(lines, &CurveLines::updateMapped, this, &QCurveCenterData::onMapped);
+        onMapped();
+    }
+}
+
+void QCurveCenterData::onStreamFlush()
+{
+    if(m_streamAppend.isEmpty() && !m_streamDrop)
+    {
+        return;
+    }
+    // Only a single unversioned change can go out as a delta; anything
+    // queued behind another one is sent whole.
+    m_deltaDirty = !m_pointsDirty;
+    m_deltaPoints.clear();
+    m_deltaPoints.swap(m_streamAppend);
+    m_deltaDrop = m_streamDrop;
+    m_streamDrop = 0;
+    m_pointsVersion++;
+    m_pointsDirty = true;
+    remoteSend();
+}
+
+void QCurveCenterData::setStreaming(int capacity)
+{
+    m_streamTimer.stop();
+    m_streamAppend.clear();
+    m_streamDrop = 0;
+    m_deltaDirty = false;
+    QVector<CurvePoint> points = remotePoints(0, m_sampleLines.pointsSize());
+    m_sampleLines.setStreaming(capacity);
+    m_msgPoints = m_sampleLines.pointsStreaming() ? QVector<CurvePoint>() : points;
+    m_pointsVersion++;
+    m_pointsDirty = true;
+    remoteSend();
+}
+
+void QCurveCenterData::onChannel(const QString &name, const QVector<CurvePoint> &points)
+{
+    QCurveChannel& channel = remoteChannel(name);
+    channel.lines = nullptr;
+    channel.points = points;
+    remoteEdit();
+    remoteSend();
+}
+
+void QCurveCenterData::onMappedChannel(const QString &name, CurveLines *lines)
+{
+    // Announced by name and extent only; receivers ask for samples.
+    QCurveChannel& channel = remoteChannel(name);
+    channel.lines = lines;
+    channel.points.clear();
+    channel.base.clear();
+    remoteEdit();
+    remoteSend();
+}
+
+QCurveChannel &QCurveCenterData::remoteChannel(const QString &name)
+{
+    int index = 0;
+    while(index < m_channels.size() && m_channels[index].name != name)
+    {
+        index++;
+    }
+    if(index == m_channels.size())
+    {
+        m_channels.append(QCurveChannel(name));
+    }
+    QCurveChannel& channel = m_channels[index];
+    if(!channel.dirty)
+    {
+        channel.base = channel.points;
+        channel.baseVersion = channel.version;
+        channel.dirty = true;
+    }
+    return channel;
+}
+
 void QCurveCenterData::onSocket(const QString &data)
 {
+    QJsonObject socketData = QJsonDocument::fromJson(data.toUtf8()).object();
+    if(socketData.contains("ack"))
+    {
+        QJsonObject ack = socketData["ack"].toObject();
+        m_stats.acks++;
+        if(ack.contains("seq"))
+        {
+            qint64 seq = static_cast<qint64>(ack["seq"].toDouble());
+            int index = 0;
+            while (index < m_sentStamps.size() && m_sentStamps[index].first < seq)
+            {
+                index++;
+            }
+            if(index < m_sentStamps.size() && m_sentStamps[index].first == seq)
+            {
+                m_sendToAck.add(m_clock.nsecsElapsed() - m_sentStamps[index].second);
+                index++;
+            }
+            m_sentStamps.remove(0, index);
+        }
+        emit remoteAck(ack);
+        return;
+    }
     qDebug() << data;
+    if(socketData.contains("sample"))
+    {
+        remoteSample(m_webSocket, socketData);
+        return;
+    }
+    if(socketData.contains("encoding"))
+    {
+        CurveFrame::Encoding encoding;
+        if(CurveFrame::encodingFromName(socketData["encoding"].toString(), encoding))
+        {
+            m_encoding = encoding;
+        }
+    }
+    if(socketData.contains("sync"))
+    {
+        setSyncMode(socketData["sync"].toString() == "viewport" ? Sync_Viewport : Sync_Full);
+    }
     remoteSend();
 //    QJsonDocument doc = QJsonDocument::fromJson(data);
 //    QJsonArray socketData = doc.array();
@@ -100,23 +353,683 @@ int QCurveCenterData::remoteState()
 
 void QCurveCenterData::remoteConnect()
 {
-    m_webSocket->open(QUrl("ws://localhost:8081/curve/gui"));
+    m_reconnect = true;
+    if(m_remote == Remote_Disconnected)
+    {
+        onReconnect();
+    }
 }
 
 void QCurveCenterData::remoteDisconnect()
 {
+    m_reconnect = false;
+    m_reconnectTimer.stop();
     m_webSocket->close();
+    m_remote = Remote_Disconnected;
 }
 
 void QCurveCenterData::remoteSend()
 {
     if(m_msgZoom.size())
     {
+        m_version++;
+        m_pending = true;
+        if(m_pointsDirty)
+        {
+            m_pointsSeq = m_version;
+            m_deltaSeq = m_deltaDirty ? m_version : 0;
+            m_pointsDirty = false;
+            m_deltaDirty = false;
+        }
+        for (int i = 0; i < m_channels.size(); i++)
+        {
+            if(m_channels[i].dirty)
+            {
+                m_channels[i].version = m_version;
+                m_channels[i].dirty = false;
+            }
+        }
+    }
+    remoteFlush();
+    remotePublish();
+}
+
+void QCurveCenterData::setSyncMode(QCurveCenterData::SyncMode mode)
+{
+    m_syncMode = mode;
+    m_viewVersion = -1;
+}
+
+int QCurveCenterData::syncMode()
+{
+    return m_syncMode;
+}
+
+bool QCurveCenterData::remoteListen(quint16 port)
+{
+    if(!m_webServer)
+    {
+        m_webServer = new QWebSocketServer(QStringLiteral("QCurveWidget"), QWebSocketServer::NonSecureMode, this);
+        QObject::connect(m_webServer, &QWebSocketServer::newConnection, [&](){
+            while (m_webServer->hasPendingConnections())
+            {
+                QWebSocket *socket = m_webServer->nextPendingConnection();
+                QObject::connect(socket, &QWebSocket::disconnected, [this, socket](){
+                    int index = remoteSubscriber(socket);
+                    if(index >= 0)
+                    {
+                        m_subscribers.removeAt(index);
+                    }
+                    socket->deleteLater();
+                });
+                QObject::connect(socket, &QWebSocket::bytesWritten, [this, socket](qint64 bytes){
+                    int index = remoteSubscriber(socket);
+                    if(index >= 0)
+                    {
+                        QCurveSubscriber& subscriber = m_subscribers[index];
+                        subscriber.pending = qMax<qint64>(0, subscriber.pending - bytes);
+                        remotePublish(subscriber);
+                    }
+                });
+                QObject::connect(socket, &QWebSocket::textMessageReceived, [this, socket](const QString &message){
+                    int index = remoteSubscriber(socket);
+                    QJsonObject socketData = QJsonDocument::fromJson(message.toUtf8()).object();
+                    if(socketData.contains("sample"))
+                    {
+                        remoteSample(socket, socketData);
+                    }
+                    else if(index >= 0 && socketData.contains("hello"))
+                    {
+                        remoteHello(m_subscribers[index], socketData);
+                    }
+                });
+                m_subscribers.append(QCurveSubscriber(socket));
+                remotePublish(m_subscribers.last());
+            }
+        });
+    }
+    if(m_webServer->isListening())
+    {
+        m_webServer->close();
+    }
+    return m_webServer->listen(QHostAddress::Any, port);
+}
+
+void QCurveCenterData::remoteClose()
+{
+    if(m_webServer)
+    {
+        m_webServer->close();
+    }
+    for(const QCurveSubscriber& subscriber : m_subscribers)
+    {
+        subscriber.socket->disconnect();
+        subscriber.socket->close();
+        subscriber.socket->deleteLater();
+    }
+    m_subscribers.clear();
+}
+
+QCurveRemoteStats QCurveCenterData::remoteStats()
+{
+    QCurveRemoteStats stats = m_stats;
+    stats.uptime = m_uptime.isValid() ? m_uptime.elapsed() : 0;
+    stats.subscribers = m_subscribers.size();
+    return stats;
+}
+
+qint64 QCurveCenterData::remoteSeq()
+{
+    // The "seq" of the last frame sent upstream, which its ack echoes.
+    return m_remoteVersion;
+}
+
+void QCurveCenterData::onReconnect()
+{
+    if(m_remote == Remote_Connected || m_remote == Remote_Connecting)
+    {
+        return;
+    }
+    m_remote = Remote_Connecting;
+    m_stats.attempts++;
+    m_webSocket->open(QUrl("ws://localhost:8081/curve/gui"));
+}
+
+void QCurveCenterData::onPing()
+{
+    m_webSocket->ping();
+}
+
+void QCurveCenterData::remoteRetry()
+{
+    if(m_reconnectTimer.isActive())
+    {
+        return;
+    }
+    m_remote = Remote_Disconnected;
+    if(!m_reconnect)
+    {
+        return;
+    }
+
+    // Jitter keeps several editors from reconnecting in lockstep
+    int delay = m_backoff / 2 + QRandomGenerator::global()->bounded(m_backoff / 2 + 1);
+    m_backoff = qMin(m_backoff * 2, ReconnectMax);
+
+    m_remote = Remote_Waiting;
+    m_reconnectTimer.start(delay);
+}
+
+void QCurveCenterData::remoteHello(QCurveSubscriber &subscriber, const QJsonObject &socketData)
+{
+    CurveFrame::Encoding encoding = CurveFrame::Json;
+    QJsonArray encodings = socketData["hello"].toObject()["encodings"].toArray();
+    for(const QJsonValue& item : encodings)
+    {
+        if(CurveFrame::encodingFromName(item.toString(), encoding))
+        {
+            break;
+        }
+    }
+    subscriber.encoding = encoding;
+    subscriber.version = 0;
+
+    QJsonObject reply;
+    reply["encoding"] = CurveFrame::encodingName(encoding);
+    subscriber.socket->sendTextMessage(QString::fromUtf8(QJsonDocument(reply).toJson(QJsonDocument::Compact)));
+    remotePublish(subscriber);
+}
+
+void QCurveCenterData::remoteSample(QWebSocket *socket, const QJsonObject &socketData)
+{
+    QJsonObject sample = socketData["sample"].toObject();
+    QCurveSampleRequest request(socket);
+    request.id = static_cast<qint64>(sample["id"].toDouble());
+    if(sample.contains("x"))
+    {
+        QJsonArray xs = sample["x"].toArray();
+        request.count = qMin(xs.size(), SampleLimit);
+        request.xs.reserve(request.count);
+        for (int i = 0; i < request.count; i++)
+        {
+            request.xs.append(static_cast<float>(xs[i].toDouble()));
+        }
+    }
+    else
+    {
+        QJsonArray range = sample["range"].toArray();
+        request.x0 = static_cast<float>(range[0].toDouble());
+        request.x1 = static_cast<float>(range[1].toDouble());
+        request.count = qBound(0, sample["count"].toInt(), SampleLimit);
+    }
+    request.channel = sample["channel"].toString();
+    m_samples.append(request);
+    if(!m_sampleTimer.isActive())
+    {
+        m_sampleTimer.start(0);
+    }
+}
+
+void QCurveCenterData::onSample()
+{
+    if(m_samples.isEmpty())
+    {
+        return;
+    }
+
+    // One chunk per event loop turn, rotating through the pipelined
+    // requests so a large one cannot starve the GUI or the others.
+    QCurveSampleRequest request = m_samples.takeFirst();
+    if(request.socket)
+    {
+        // A channel that is gone or not mapped ends the request empty.
+        CurveLines* lines = remoteSampleLines(request.channel);
+        if(!lines)
+        {
+            request.count = request.offset;
+        }
+        int count = qMin(SampleChunk, request.count - request.offset);
+        QVector<float> xs(count);
+        if(request.xs.size())
+        {
+            for (int i = 0; i < count; i++)
+            {
+                xs[i] = request.xs[request.offset + i];
+            }
+        }
+        else
+        {
+            float step = request.count > 1 ? (request.x1 - request.x0) / (request.count - 1) : 0.0f;
+            for (int i = 0; i < count; i++)
+            {
+                xs[i] = request.x0 + step * (request.offset + i);
+            }
+        }
+        QVector<float> ys = lines ? lines->getValues(xs) : QVector<float>();
+
+        QJsonArray values;
+        for(float y : ys)
+        {
+            values.append((double)y);
+        }
+        QJsonObject samples;
+        samples["id"] = request.id;
+        samples["version"] = m_version;
+        samples["offset"] = request.offset;
+        samples["count"] = request.count;
+        samples["y"] = values;
+        samples["done"] = request.offset + count >= request.count;
+        QJsonObject samplesData;
+        samplesData["samples"] = samples;
+        request.socket->sendTextMessage(QString::fromUtf8(QJsonDocument(samplesData).toJson(QJsonDocument::Compact)));
+
+        request.offset += count;
+        if(request.offset < request.count)
+        {
+            m_samples.append(request);
+        }
+    }
+    if(!m_samples.isEmpty())
+    {
+        m_sampleTimer.start(0);
+    }
+}
+
+QByteArray QCurveCenterData::remoteFrame(CurveFrame::Encoding encoding, qint64 since)
+{
+    // The main curve only goes out when it changed after since: "curve"
+    // says whether the frame's points start with it. A streamed change a
+    // receiver that kept up can apply goes out as "append" points followed
+    // by a "drop" count instead. The cached frame is built for a receiver
+    // that kept up, and serves anyone it would give the same content.
+    const qint64 latest = m_version - 1;
+    const bool delta = m_deltaSeq == m_version;
+    bool cached = since == latest
+            || (m_channels.isEmpty() && (m_pointsSeq <= since || (m_pointsSeq > latest && !delta)));
+    if(!cached || m_frameVersions[encoding] != m_version)
+    {
+        const qint64 base = cached ? latest : since;
+        const bool changed = m_pointsSeq > base;
+        QVector<CurvePoint> points;
         QJsonObject socketData;
+        socketData["seq"] = m_version;
+        socketData["stamp"] = m_clock.nsecsElapsed();
+        socketData["time"] = QDateTime::currentMSecsSinceEpoch();
         socketData["zoom"] = m_msgZoom;
-        socketData["points"] = m_msgPoints;
-        QJsonDocument doc;
-        doc.setObject(socketData);
-        m_webSocket->sendBinaryMessage(doc.toJson(QJsonDocument::Compact));
+        if(changed && delta && base == latest)
+        {
+            points = m_deltaPoints;
+            socketData["curve"] = false;
+            socketData["append"] = m_deltaPoints.size();
+            socketData["drop"] = m_deltaDrop;
+        }
+        else
+        {
+            if(changed && m_mapped)
+            {
+                socketData["mapped"] = remoteMapped(remoteLines());
+            }
+            else if(changed)
+            {
+                points = m_sampleLines.pointsStreaming() ? remotePoints(0, m_sampleLines.pointsSize()) : m_msgPoints;
+            }
+            socketData["curve"] = changed && !m_mapped;
+        }
+        if(!m_channels.isEmpty())
+        {
+            socketData["channels"] = remoteChannels(base, points);
+        }
+        QByteArray frame = CurveFrame::encode(socketData, points, encoding, CompressThreshold);
+        if(!cached)
+        {
+            return frame;
+        }
+        m_frames[encoding] = frame;
+        m_frameVersions[encoding] = m_version;
+    }
+    return m_frames[encoding];
+}
+
+QJsonArray QCurveCenterData::remoteChannels(qint64 since, QVector<CurvePoint> &points)
+{
+    // Each channel changed after since is appended to the frame's points,
+    // after the main curve when the frame carries it. A receiver holding
+    // the channel's previous content gets a splice: the run between the
+    // common prefix and suffix replaces "remove" points at "at". Anyone
+    // else gets the whole channel.
+    QJsonArray channels;
+    for (const QCurveChannel& channel : m_channels)
+    {
+        if(channel.version <= since)
+        {
+            continue;
+        }
+        QJsonObject entry;
+        entry["name"] = channel.name;
+        entry["version"] = channel.version;
+        entry["offset"] = points.size();
+        if(channel.lines)
+        {
+            entry["reset"] = true;
+            entry["count"] = 0;
+            entry["mapped"] = remoteMapped(*channel.lines);
+        }
+        else if(since > 0 && since >= channel.baseVersion && channel.baseVersion > 0)
+        {
+            const QVector<CurvePoint>& base = channel.base;
+            const int limit = qMin(base.size(), channel.points.size());
+            int prefix = 0;
+            while(prefix < limit && base.at(prefix).type == channel.points.at(prefix).type
+                  && base.at(prefix).pos == channel.points.at(prefix).pos
+                  && base.at(prefix).pos2 == channel.points.at(prefix).pos2)
+            {
+                prefix++;
+            }
+            int suffix = 0;
+            while(suffix < limit - prefix)
+            {
+                const CurvePoint& a = base.at(base.size() - 1 - suffix);
+                const CurvePoint& b = channel.points.at(channel.points.size() - 1 - suffix);
+                if(a.type != b.type || a.pos != b.pos || a.pos2 != b.pos2)
+                {
+                    break;
+                }
+                suffix++;
+            }
+            const int count = channel.points.size() - prefix - suffix;
+            entry["at"] = prefix;
+            entry["remove"] = base.size() - prefix - suffix;
+            entry["count"] = count;
+            points += channel.points.mid(prefix, count);
+        }
+        else
+        {
+            entry["reset"] = true;
+            entry["count"] = channel.points.size();
+            points += channel.points;
+        }
+        channels.append(entry);
+    }
+    return channels;
+}
+
+QByteArray QCurveCenterData::remoteViewFrame()
+{
+    int first = 0;
+    int last = -1;
+    remoteView(first, last);
+
+    // The consumer keeps the slices it already has for this points version,
+    // so a pan only ships the range that just scrolled into view.
+    QVector<QPair<int, int>> ranges;
+    bool reset = m_viewVersion != m_pointsVersion || m_viewFirst > m_viewLast;
+    if(reset)
+    {
+        ranges.append(qMakePair(first, last));
+        m_viewFirst = first;
+        m_viewLast = last;
+        m_viewVersion = m_pointsVersion;
+    }
+    else if(first <= last)
+    {
+        if(first < m_viewFirst)
+        {
+            ranges.append(qMakePair(first, qMin(last, m_viewFirst - 1)));
+        }
+        if(last > m_viewLast)
+        {
+            ranges.append(qMakePair(qMax(first, m_viewLast + 1), last));
+        }
+        m_viewFirst = qMin(m_viewFirst, first);
+        m_viewLast = qMax(m_viewLast, last);
     }
+
+    QJsonArray slices;
+    QVector<CurvePoint> points;
+    for(const QPair<int, int>& range : ranges)
+    {
+        if(range.first > range.second)
+        {
+            continue;
+        }
+        QJsonArray slice;
+        slice.append(range.first);
+        slice.append(range.second - range.first + 1);
+        slices.append(slice);
+        points += remotePoints(range.first, range.second - range.first + 1);
+    }
+
+    QJsonObject view;
+    view["reset"] = reset;
+    view["count"] = remoteLines().pointsSize();
+    view["slices"] = slices;
+
+    QJsonObject socketData;
+    socketData["seq"] = m_version;
+    socketData["stamp"] = m_clock.nsecsElapsed();
+    socketData["time"] = QDateTime::currentMSecsSinceEpoch();
+    socketData["zoom"] = m_msgZoom;
+    socketData["view"] = view;
+    if(!m_channels.isEmpty())
+    {
+        socketData["channels"] = remoteChannels(m_remoteVersion, points);
+    }
+    return CurveFrame::encode(socketData, points, m_encoding, CompressThreshold);
+}
+
+bool QCurveCenterData::remoteView(int &first, int &last)
+{
+    CurveLines& lines = remoteLines();
+    const int n = lines.pointsSize();
+    first = 0;
+    last = n - 1;
+    if(n < 2 || !lines.pointsSorted() || m_zoomScale <= 0)
+    {
+        return false;
+    }
+
+    // Same mapping as QCurveEditWidget::toAnalyticCoordinates
+    float x0 = (m_zoomRect.left() - m_zoomOffset.x()) / m_zoomScale;
+    float x1 = (m_zoomRect.left() + m_zoomRect.width() - m_zoomOffset.x()) / m_zoomScale;
+    if(x1 < lines.pointAt(0).pos.x() || x0 > lines.pointAt(n - 1).pos.x())
+    {
+        last = -1;
+        return true;
+    }
+
+    // findSegment(x) is the segment [i-1, i] holding x: its ends are the
+    // neighbours just outside the viewport.
+    int segment = lines.findSegment(x0);
+    first = segment > 0 ? segment - 1 : 0;
+    segment = lines.findSegment(x1);
+    last = segment > 0 ? segment : n - 1;
+    return true;
+}
+
+QVector<CurvePoint> QCurveCenterData::remotePoints(int first, int count)
+{
+    if(!m_mapped && !m_sampleLines.pointsStreaming())
+    {
+        return m_msgPoints.mid(first, count);
+    }
+    CurveLines& lines = remoteLines();
+    QVector<CurvePoint> points;
+    points.reserve(count);
+    for (int i = first; i < first + count; i++)
+    {
+        points.append(lines.pointAt(i));
+    }
+    return points;
+}
+
+CurveLines &QCurveCenterData::remoteLines()
+{
+    return m_mapped && m_source ? *m_source : m_sampleLines;
+}
+
+QJsonObject QCurveCenterData::remoteMapped(CurveLines& lines)
+{
+    // Enough for a receiver to size its view and ask for samples.
+    const int n = lines.pointsSize();
+    QJsonArray range;
+    range.append(n ? static_cast<double>(lines.pointAt(0).pos.x()) : 0.0);
+    range.append(n ? static_cast<double>(lines.pointAt(n - 1).pos.x()) : 0.0);
+    QJsonObject mapped;
+    mapped["file"] = lines.fileName();
+    mapped["count"] = n;
+    mapped["range"] = range;
+    mapped["sorted"] = lines.pointsSorted();
+    return mapped;
+}
+
+CurveLines *QCurveCenterData::remoteSampleLines(const QString &channel)
+{
+    if(channel.isEmpty())
+    {
+        return &remoteLines();
+    }
+    for (const QCurveChannel& entry : m_channels)
+    {
+        if(entry.name == channel)
+        {
+            return entry.lines.data();
+        }
+    }
+    return nullptr;
+}
+
+void QCurveCenterData::remoteFlush()
+{
+    if(m_pending && m_version && m_remote == Remote_Connected)
+    {
+        QByteArray frame = m_syncMode == Sync_Viewport ? remoteViewFrame() : remoteFrame(m_encoding, m_remoteVersion);
+        m_webSocket->sendBinaryMessage(frame);
+        m_remoteVersion = m_version;
+        m_stats.frames++;
+        m_stats.bytes += frame.size();
+        m_pending = false;
+
+        qint64 stamp = m_clock.nsecsElapsed();
+        if(m_editStamp >= 0)
+        {
+            m_editToSend.add(stamp - m_editStamp);
+            m_editStamp = -1;
+        }
+        if(m_sentStamps.size() >= SentLimit)
+        {
+            m_sentStamps.removeFirst();
+        }
+        m_sentStamps.append(qMakePair(m_version, stamp));
+    }
+}
+
+void QCurveCenterData::remotePublish()
+{
+    for (int i = 0; i < m_subscribers.size(); i++)
+    {
+        remotePublish(m_subscribers[i]);
+    }
+}
+
+void QCurveCenterData::remotePublish(QCurveSubscriber &subscriber)
+{
+    if(subscriber.version == m_version || !m_version)
+    {
+        return;
+    }
+    if(subscriber.pending > SubscriberWindow)
+    {
+        // Slow consumer: bytesWritten sends whatever is newest once it drains
+        return;
+    }
+    if(subscriber.version)
+    {
+        m_stats.skipped += m_version - subscriber.version - 1;
+    }
+    QByteArray frame = remoteFrame(subscriber.encoding, subscriber.version);
+    subscriber.socket->sendBinaryMessage(frame);
+    subscriber.pending += frame.size();
+    subscriber.version = m_version;
+    m_stats.published++;
+}
+
+int QCurveCenterData::remoteSubscriber(QWebSocket *socket)
+{
+    for (int i = 0; i < m_subscribers.size(); i++)
+    {
+        if(m_subscribers[i].socket == socket)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void QCurveCenterData::remoteEdit()
+{
+    if(m_editStamp < 0)
+    {
+        m_editStamp = m_clock.nsecsElapsed();
+    }
+}
+
+QStringList QCurveCenterData::remoteTips()
+{
+    QStringList tips;
+    switch (m_remote) {
+    case Remote_Connected:
+        tips << tr("Remote:connected");
+        break;
+    case Remote_Connecting:
+        tips << tr("Remote:connecting");
+        break;
+    case Remote_Waiting:
+        tips << tr("Remote:retry in %1ms").arg(m_reconnectTimer.remainingTime());
+        break;
+    default:
+        tips << tr("Remote:disconnected");
+        break;
+    }
+    if(m_stats.rtt >= 0)
+    {
+        tips << tr("RTT:%1ms").arg(m_stats.rtt);
+    }
+    if(m_editToSend.count())
+    {
+        tips << tr("Edit>Send p50:%1ms p99:%2ms")
+                .arg(m_editToSend.percentile(50) / 1e6, 0, 'f', 2)
+                .arg(m_editToSend.percentile(99) / 1e6, 0, 'f', 2);
+    }
+    if(m_sendToAck.count())
+    {
+        tips << tr("Send>Ack p50:%1ms p99:%2ms")
+                .arg(m_sendToAck.percentile(50) / 1e6, 0, 'f', 2)
+                .arg(m_sendToAck.percentile(99) / 1e6, 0, 'f', 2);
+    }
+    return tips;
+}
+
+bool QCurveCenterData::exportLatency(const QString &path)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        qDebug() << "export failed" << path << file.errorString();
+        return false;
+    }
+    QTextStream stream(&file);
+    stream << "histogram,value_ns,percentile,count\n";
+    m_editToSend.write(stream, "edit_to_send");
+    m_sendToAck.write(stream, "send_to_ack");
+    return true;
+}
+
+void QCurveCenterData::onExport()
+{
+    exportLatency(QString("curve-latency-%1.csv").arg(QDateTime::currentMSecsSinceEpoch()));
+}
+
+void QCurveCenterData::onTips()
+{
+    emit updateTips(remoteTips());
 }
@@ -2,16 +2,106 @@
 #define QCURVESOCKETWIDGET_H
 
 #include <QWidget>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QPointer>
 #include <QWebSocket>
 #include <QWebSocketServer>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 #include "curvelines.h"
+#include "curveframe.h"
+#include "curvehistogram.h"
+
+class QCurveRemoteStats
+{
+public:
+    QCurveRemoteStats() :
+        attempts(0), connects(0), disconnects(0), frames(0), bytes(0),
+        rtt(-1), rttAverage(-1), uptime(0),
+        subscribers(0), published(0), skipped(0), acks(0) {}
+
+public:
+    qint64 attempts;
+    qint64 connects;
+    qint64 disconnects;
+    qint64 frames;
+    qint64 bytes;
+    qint64 rtt;
+    qint64 rttAverage;
+    qint64 uptime;
+    qint64 subscribers;
+    qint64 published;
+    qint64 skipped;
+    qint64 acks;
+};
+
+class QCurveSubscriber
+{
+public:
+    QCurveSubscriber(QWebSocket *s = nullptr) :
+        socket(s), version(0), pending(0), encoding(CurveFrame::Json) {}
+
+public:
+    QWebSocket *socket;
+    qint64 version;
+    qint64 pending;
+    CurveFrame::Encoding encoding;
+};
+
+class QCurveSampleRequest
+{
+public:
+    QCurveSampleRequest(QWebSocket *s = nullptr) :
+        socket(s), id(0), x0(0), x1(0), count(0), offset(0) {}
+
+public:
+    QPointer<QWebSocket> socket;
+    qint64 id;
+    float x0;
+    float x1;
+    int count;
+    QVector<float> xs;
+    int offset;
+    // Empty for the main curve, else a mapped channel's name.
+    QString channel;
+};
+
+class QCurveChannel
+{
+public:
+    QCurveChannel(const QString& n = QString()) :
+        name(n), version(0), baseVersion(0), dirty(false) {}
+
+public:
+    QString name;
+    QVector<CurvePoint> points;
+    // What receivers at or after baseVersion, but before version, hold.
+    QVector<CurvePoint> base;
+    qint64 version;
+    qint64 baseVersion;
+    bool dirty;
+    // Set for a mapped channel, which is described instead of copied.
+    QPointer<CurveLines> lines;
+};
 
 class QCurveCenterData : public QObject
 {
     Q_OBJECT
+public:
+    enum RemoteState{
+        Remote_Disconnected = 0x00,
+        Remote_Connected = 0x01,
+        Remote_Connecting = 0x02,
+        Remote_Waiting = 0x03,
+    };
+
+    enum SyncMode{
+        Sync_Full = 0x00,
+        Sync_Viewport = 0x01,
+    };
+
 public:
     static QCurveCenterData *instance()
     {
@@ -24,11 +114,25 @@ public:
 
 signals:
     void updateCurve(const QVector<CurvePoint> &data);
+    void remoteAck(const QJsonObject &ack);
+    void updateTips(const QStringList &tips);
 
 public slots:
     void onZoom(float scale, QPoint offset, QRect rect);
     void onCurve(const QVector<CurvePoint>& points);
+    void onStream(const QVector<CurvePoint>& points, int dropped);
+    void onMapped();
+    void onChannel(const QString& name, const QVector<CurvePoint>& points);
+    void onMappedChannel(const QString& name, CurveLines* lines);
     void onSocket(const QString& data);
+    void onExport();
+
+protected slots:
+    void onReconnect();
+    void onStreamFlush();
+    void onPing();
+    void onSample();
+    void onTips();
 
 public:
     int remoteState();
@@ -36,11 +140,101 @@ public:
     void remoteDisconnect();
     void remoteSend();
 
+    void setSyncMode(SyncMode mode);
+    int syncMode();
+
+    // Mirrors CurveLines::setStreaming() of the curve whose appendCurve()
+    // feeds onStream(): the window is kept as a ring and receivers that
+    // kept up get only the appended points and the drop count.
+    void setStreaming(int capacity);
+
+    // The curve behind updateCurve(). Once it is mapped it is not
+    // mirrored: frames describe it under "mapped", and samples and
+    // viewport slices are read from it in place.
+    void setSource(CurveLines* lines);
+
+    bool remoteListen(quint16 port);
+    void remoteClose();
+
+    QCurveRemoteStats remoteStats();
+    qint64 remoteSeq();
+    QStringList remoteTips();
+    bool exportLatency(const QString& path);
+
+private:
+    void remoteRetry();
+    void remoteEdit();
+    void remoteHello(QCurveSubscriber& subscriber, const QJsonObject& socketData);
+    void remoteSample(QWebSocket *socket, const QJsonObject& socketData);
+    QByteArray remoteFrame(CurveFrame::Encoding encoding, qint64 since);
+    QJsonArray remoteChannels(qint64 since, QVector<CurvePoint>& points);
+    QByteArray remoteViewFrame();
+    bool remoteView(int& first, int& last);
+    QVector<CurvePoint> remotePoints(int first, int count);
+    CurveLines& remoteLines();
+    QJsonObject remoteMapped(CurveLines& lines);
+    CurveLines* remoteSampleLines(const QString& channel);
+    QCurveChannel& remoteChannel(const QString& name);
+    void remoteFlush();
+    void remotePublish();
+    void remotePublish(QCurveSubscriber& subscriber);
+    int remoteSubscriber(QWebSocket *socket);
+
 private:
     int m_remote;
+    bool m_reconnect;
+    bool m_pending;
+    int m_backoff;
     QJsonObject    m_msgZoom;
-    QJsonArray      m_msgPoints;
+    QVector<CurvePoint> m_msgPoints;
+    float m_zoomScale;
+    QPoint m_zoomOffset;
+    QRect m_zoomRect;
     QWebSocket  *m_webSocket;
+    qint64 m_remoteVersion;
+    QVector<QCurveChannel> m_channels;
+
+    qint64 m_version;
+    SyncMode m_syncMode;
+    qint64 m_pointsVersion;
+    // m_version at which the main curve last changed.
+    qint64 m_pointsSeq;
+    bool m_pointsDirty;
+    // Streamed appends and drops not yet flushed, and the last flushed
+    // ones, which went out as version m_deltaSeq.
+    QVector<CurvePoint> m_streamAppend;
+    int m_streamDrop;
+    QTimer m_streamTimer;
+    QVector<CurvePoint> m_deltaPoints;
+    int m_deltaDrop;
+    qint64 m_deltaSeq;
+    bool m_deltaDirty;
+    qint64 m_viewVersion;
+    int m_viewFirst;
+    int m_viewLast;
+    CurveFrame::Encoding m_encoding;
+    QByteArray m_frames[3];
+    qint64 m_frameVersions[3];
+    QWebSocketServer *m_webServer;
+    QVector<QCurveSubscriber> m_subscribers;
+
+    CurveLines m_sampleLines;
+    QPointer<CurveLines> m_source;
+    bool m_mapped;
+    QVector<QCurveSampleRequest> m_samples;
+    QTimer m_sampleTimer;
+
+    QElapsedTimer m_clock;
+    qint64 m_editStamp;
+    QVector<QPair<qint64, qint64>> m_sentStamps;
+    CurveHistogram m_editToSend;
+    CurveHistogram m_sendToAck;
+    QTimer m_tipsTimer;
+
+    QTimer m_reconnectTimer;
+    QTimer m_pingTimer;
+    QElapsedTimer m_uptime;
+    QCurveRemoteStats m_stats;
 };
 
 #endif // QCURVESOCKETWIDGET_H